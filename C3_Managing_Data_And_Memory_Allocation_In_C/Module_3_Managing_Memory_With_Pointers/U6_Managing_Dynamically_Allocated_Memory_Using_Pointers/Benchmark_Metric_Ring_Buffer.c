@@ -0,0 +1,340 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "Metric_Ring_Buffer.h"
+
+/*
+    How well do metrics stream through a ring buffer?
+
+    One thread "pours", logging metrics as fast as it can, and a sender
+    thread pops them off in batches of up to BENCH_BATCH and "sends" them
+    (adds up the power used). We run this for a few ring buffer capacities,
+    and once more the old way, where the pour keeps every metric in a
+    growing array and they are only sent once it is over.
+
+    For each we report:
+
+        -   Metrics/s: Sustained throughput, from the first metric logged to
+            the last one sent.
+
+        -   p50 / p99 / Max us: End to end latency, from a metric being
+            logged to it being sent. Every BENCH_SAMPLE_EVERY'th metric is
+            timed.
+
+        -   Buffer KB: The memory the metrics took up on their way through.
+
+    Pass a number of metrics as the first argument to change how long the
+    benchmark runs (defaults to BENCH_METRICS).
+
+    On a single core the two threads have to take turns, so the latency is
+    mostly how long the pour runs before the sender gets a go. A bigger ring
+    buffer then means fewer turns (more throughput) but longer waits.
+
+    Finally, we slow the sender down to BENCH_SLOW_SEND_NS per metric (a
+    sender stuck behind a slow network) and compare the ring buffer's
+    overflow policies. "Pour ns" is what logging one metric costs the pour,
+    and "Dropped" how many metrics the policy threw away to keep it that
+    low.
+*/
+
+#define BENCH_METRICS 10000000L
+#define BENCH_BATCH 256
+#define BENCH_SAMPLE_EVERY 1024
+#define BENCH_SLOW_CAPACITY 1024
+#define BENCH_SLOW_SEND_NS 200
+#define BENCH_SLOW_SAMPLE_EVERY 8
+
+typedef struct BenchRun
+{
+    MetricRingBuffer *ring;
+    long int metrics;
+
+    //  When each sampled metric was logged, and how long it took to send.
+    int64_t *loggedAt;
+    double *latencies;
+    long int latencyCount;
+
+    double powerSent;
+    int64_t sendNanoseconds;
+} BenchRun;
+
+static int64_t NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static int CompareDoubles(const void *left, const void *right)
+{
+    double a = *(const double*) left;
+    double b = *(const double*) right;
+
+    return (a > b) - (a < b);
+}
+
+/*
+    "Sends" a batch of metrics, timing the sampled ones. The pour writes
+    "loggedAt" before pushing a metric, so the ring buffer's release and
+    acquire make sure the sender sees the time.
+*/
+static void SendBatch(BenchRun *run, const Metric *metrics, size_t count)
+{
+    int64_t now = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        run -> powerSent += metrics[i].powerUsed;
+
+        if (metrics[i].sequenceNumber % BENCH_SAMPLE_EVERY == 0)
+        {
+            if (now == 0)
+            {
+                now = NowNanoseconds();
+            }
+
+            long int sample = metrics[i].sequenceNumber / BENCH_SAMPLE_EVERY;
+            run -> latencies[run -> latencyCount++] = (double)(now - run -> loggedAt[sample]);
+        }
+    }
+}
+
+static void* Sender(void *arg)
+{
+    BenchRun *run = (BenchRun*) arg;
+    Metric batch[BENCH_BATCH];
+    size_t popped;
+
+    while ((popped = MetricRingPop(run -> ring, batch, BENCH_BATCH)) > 0)
+    {
+        SendBatch(run, batch, popped);
+
+        //  A slow sender: wait out BENCH_SLOW_SEND_NS per metric.
+        if (run -> sendNanoseconds > 0)
+        {
+            int64_t until = NowNanoseconds() + run -> sendNanoseconds * (int64_t) popped;
+
+            while (NowNanoseconds() < until)
+            {
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void LogMetric(BenchRun *run, Metric *metric, long int sequenceNumber)
+{
+    metric -> sequenceNumber = (int) sequenceNumber;
+    metric -> powerUsed = 4.4f;
+
+    if (sequenceNumber % BENCH_SAMPLE_EVERY == 0)
+    {
+        run -> loggedAt[sequenceNumber / BENCH_SAMPLE_EVERY] = NowNanoseconds();
+    }
+}
+
+static double RunRing(BenchRun *run, size_t capacity)
+{
+    if (MetricRingInit(&run -> ring, capacity))
+    {
+        return 0;
+    }
+
+    pthread_t sender;
+    int64_t begin = NowNanoseconds();
+
+    pthread_create(&sender, NULL, Sender, run);
+
+    for (long int i = 0; i < run -> metrics; i++)
+    {
+        Metric metric;
+        LogMetric(run, &metric, i);
+        MetricRingPush(run -> ring, metric);
+    }
+
+    MetricRingClose(run -> ring);
+    pthread_join(sender, NULL);
+
+    double elapsed = (double)(NowNanoseconds() - begin);
+
+    MetricRingDestroy(run -> ring);
+    run -> ring = NULL;
+
+    return elapsed;
+}
+
+/*
+    Pours into a BENCH_SLOW_CAPACITY ring buffer with the given overflow
+    policy whilst the sender crawls along, and reports what it cost the
+    pour and how many metrics were lost.
+*/
+static void RunSlowSender(BenchRun *run, const char *name, MetricRingOverflow overflow)
+{
+    if (MetricRingInit(&run -> ring, BENCH_SLOW_CAPACITY) ||
+        MetricRingSetOverflow(run -> ring, overflow, BENCH_SLOW_SAMPLE_EVERY))
+    {
+        MetricRingDestroy(run -> ring);
+        run -> ring = NULL;
+        return;
+    }
+
+    MetricRingBuffer *ring = run -> ring;
+    pthread_t sender;
+    int64_t begin = NowNanoseconds();
+
+    run -> sendNanoseconds = BENCH_SLOW_SEND_NS;
+    pthread_create(&sender, NULL, Sender, run);
+
+    for (long int i = 0; i < run -> metrics; i++)
+    {
+        Metric metric;
+        LogMetric(run, &metric, i);
+        MetricRingPush(ring, metric);
+    }
+
+    int64_t poured = NowNanoseconds();
+
+    MetricRingClose(ring);
+    pthread_join(sender, NULL);
+
+    printf("%14s %12.1f %12ld %12zu\n", name, (double)(poured - begin) / run -> metrics,
+           MetricRingDropped(ring), MetricRingPeakCount(ring));
+
+    run -> sendNanoseconds = 0;
+    run -> latencyCount = 0;
+    MetricRingDestroy(ring);
+    run -> ring = NULL;
+}
+
+/*
+    The old way: keep every metric in an array that doubles when it fills
+    up, and send them all once the pour is over.
+*/
+static double RunAccumulate(BenchRun *run, size_t *peakCapacity)
+{
+    size_t capacity = 64;
+    size_t count = 0;
+    Metric *metrics = (Metric*) malloc(capacity * sizeof(Metric));
+    int64_t begin = NowNanoseconds();
+
+    for (long int i = 0; i < run -> metrics && metrics != NULL; i++)
+    {
+        if (count == capacity)
+        {
+            Metric *grown = (Metric*) realloc(metrics, capacity * 2 * sizeof(Metric));
+
+            if (grown == NULL)
+            {
+                break;
+            }
+
+            metrics = grown;
+            capacity *= 2;
+        }
+
+        LogMetric(run, &metrics[count++], i);
+    }
+
+    for (size_t sent = 0; sent < count; sent += BENCH_BATCH)
+    {
+        size_t batch = count - sent < BENCH_BATCH ? count - sent : BENCH_BATCH;
+        SendBatch(run, metrics + sent, batch);
+    }
+
+    double elapsed = (double)(NowNanoseconds() - begin);
+
+    free(metrics);
+    *peakCapacity = capacity;
+
+    return elapsed;
+}
+
+static void PrintRun(const char *name, BenchRun *run, double elapsed, size_t bufferBytes)
+{
+    if (run -> latencyCount == 0)
+    {
+        return;
+    }
+
+    qsort(run -> latencies, run -> latencyCount, sizeof(double), CompareDoubles);
+
+    double p50 = run -> latencies[run -> latencyCount / 2];
+    double p99 = run -> latencies[run -> latencyCount * 99 / 100];
+    double max = run -> latencies[run -> latencyCount - 1];
+
+    printf("%14s %14.0f %12.1f %12.1f %12.1f %12zu\n", name,
+           (double) run -> metrics / (elapsed / 1e9), p50 / 1e3, p99 / 1e3, max / 1e3,
+           bufferBytes / 1024);
+
+    run -> latencyCount = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long int metrics = argc > 1 ? strtol(argv[1], NULL, 10) : BENCH_METRICS;
+
+    if (metrics < BENCH_SAMPLE_EVERY || metrics > INT32_MAX)
+    {
+        printf("The Number Of Metrics Must Be Between %d And %d\n", BENCH_SAMPLE_EVERY,
+               INT32_MAX);
+        return 1;
+    }
+
+    long int samples = metrics / BENCH_SAMPLE_EVERY + 1;
+    BenchRun run = { NULL, metrics, NULL, NULL, 0, 0, 0 };
+
+    run.loggedAt = (int64_t*) malloc(samples * sizeof(int64_t));
+    run.latencies = (double*) malloc(samples * sizeof(double));
+
+    if (run.loggedAt == NULL || run.latencies == NULL)
+    {
+        printf("Unable To Allocate Memory For The Latency Samples\n");
+        free(run.loggedAt);
+        free(run.latencies);
+        return 1;
+    }
+
+    printf("%ld Metrics, Sent In Batches Of Up To %d\n", metrics, BENCH_BATCH);
+    printf("%14s %14s %12s %12s %12s %12s\n", "", "Metrics/s", "p50 us", "p99 us", "Max us",
+           "Buffer KB");
+
+    size_t capacities[] = { 256, 4096, 65536 };
+
+    for (size_t i = 0; i < sizeof(capacities) / sizeof(capacities[0]); i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "ring %zu", capacities[i]);
+
+        double elapsed = RunRing(&run, capacities[i]);
+
+        if (elapsed > 0)
+        {
+            PrintRun(name, &run, elapsed, capacities[i] * sizeof(Metric));
+        }
+    }
+
+    size_t peakCapacity = 0;
+    double elapsed = RunAccumulate(&run, &peakCapacity);
+
+    PrintRun("send at end", &run, elapsed, peakCapacity * sizeof(Metric));
+
+    printf("\nSender Taking %d ns Per Metric, Ring Of %d\n", BENCH_SLOW_SEND_NS,
+           BENCH_SLOW_CAPACITY);
+    printf("%14s %12s %12s %12s\n", "", "Pour ns", "Dropped", "Peak Depth");
+
+    RunSlowSender(&run, "block", METRIC_RING_BLOCK);
+    RunSlowSender(&run, "drop-oldest", METRIC_RING_DROP_OLDEST);
+    RunSlowSender(&run, "sample", METRIC_RING_SAMPLE);
+
+    free(run.loggedAt);
+    free(run.latencies);
+
+    return 0;
+}
@@ -1,7 +1,22 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Metric_Ring_Buffer.h"
+#include "Metric_Sink.h"
+#include "Work_Stealing_Pool.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
 
 /*
     We'll finish this section off with a demo!
@@ -18,13 +33,6 @@
     But first, let's get an overview of the program and see what it does.
 */
 
-/*
-    Globals
-*/
-
-int metricCount = 0;
-
-
 /*
     Function/Structure Declerations
 */
@@ -35,16 +43,59 @@ int metricCount = 0;
     we want in future.). 
     
     The sequence number identifies the order in which the metric was logged and
-    is generated in conjunction with the "metricCount" counter. 
-
-    Each coffee machine will be represented by a CoffeeMachine structure. This will
-    track an array of metrics via a pointer to a Metric pointer.
+    is generated in conjunction with the machine's "metricCount" counter. (This
+    used to be a single global counter, but a fleet of machines pouring on
+    different threads at once would all be fighting over it.)
+
+    Originally, every metric was its own malloc'd Metric structure, tracked
+    through an array of Metric pointers. A long pour then meant millions of
+    tiny heap objects, and reading them back meant chasing a pointer to a
+    different part of the heap for every single one.
+
+    Instead, each coffee machine now owns a single MetricStore. Rather than
+    an array of structures (one Metric after another), it is a "structure of
+    arrays": one array (a "column") per field, with metric "i" made up of
+    the "i"th entry of every column. Both columns live in one block of
+    memory, the sequence numbers first and the power readings straight after
+    them:
+
+        [ seq 0 | seq 1 | ... | seq n-1 | power 0 | power 1 | ... | power n-1 ]
+
+    Code that only needs one field (such as totalling the power used) then
+    reads nothing but that field, packed tightly together.
+
+    "count" is how many metrics are stored and "capacity" how many fit. When
+    the store is full it doubles its capacity, so storing "n" metrics only
+    grows the store about log2(n) times, and reserving room up front (see
+    ReserveMetrics) means it never has to grow at all.
+
+    Metrics no longer wait in the store until the pour is over, though. The
+    store only ever holds one batch of up to METRIC_SEND_BATCH metrics,
+    which is written to the machine's sink (see "Metric_Sink.h") as soon
+    as it is full.
+
+    On its own, the pour fills the store and writes each batch to the sink
+    itself, so the pour stops whilst the batch goes out. A machine can
+    instead start a background sender thread (see StartMetricSender). The
+    pour then only pushes each metric into a ring buffer of
+    METRIC_RING_CAPACITY metrics (see "Metric_Ring_Buffer.h"), and the
+    sender takes them off the other end, fills the store and writes to the
+    sink whilst the pour carries on. Either way, the memory a pour needs no
+    longer depends on how long it lasts.
 */
-typedef struct Metric 
+typedef struct MetricStore
 {
-    int sequenceNumber;
-    float powerUsed;
-} Metric;
+    void *block;
+    int *sequenceNumbers;
+    float *powerUsed;
+    size_t count;
+    size_t capacity;
+} MetricStore;
+
+#define METRIC_STORE_MIN_CAPACITY 64
+#define METRIC_RING_CAPACITY 1024
+#define METRIC_SEND_BATCH 256
+#define METRIC_SAMPLE_EVERY 8
 
 
 /*
@@ -57,20 +108,21 @@ typedef struct Metric
           handle the call to "pour" will be dynamically assignable by the user
           via command line arguments.
 
-        - A pointer to a set of metrics that are logging for the current call
-          to a pour method. This will act as a dynamically allocated array, 
-          with it's size based on the "duration" of the pour provided by the 
-          user via the command line. 
+        - The metrics that are logged for the current call to a pour method.
           
           As each pour runs, the duration will be represented by the number of
           iterations through a while loop (this is to simulate time passing).
 
-          For each run of the loop a metric is created and added to the 
-          metrics block of memory using pointer arithmetic.
-          
-          When the pour is finished, the metrics are sent off to another 
-          metrics API that is still a work in progress by the Wired Brain
-          dev team.
+          For each run of the loop a metric is recorded in the machine's
+          MetricStore, and each full batch written to the machine's "sink".
+          If the machine's "sender" thread is running, the metric is pushed
+          into the machine's "stream" ring buffer instead, and the sender
+          pops them off in batches, collects each batch in the store and
+          writes it to the sink, all whilst the pour is still running.
+          The sink packs the metrics into binary frames and sends
+          them on to the terminal, a file, or another process listening on
+          a socket (standing in for the metrics API that is still a work in
+          progress by the Wired Brain dev team).
 
         - Pour duration is a value which simulates the passing of time as the 
           machine carries out a pour and will be used to simulate how long a
@@ -83,12 +135,20 @@ typedef struct Metric
 
           Pour duration is defined by the user as part of the command line 
           arguments.         
+
+        - How many metrics the machine has logged, which numbers each new
+          metric.
 */
 typedef struct CoffeeMachine 
 {
     int (*pour) (int, struct CoffeeMachine*);
-    Metric **metrics;
+    MetricStore metrics;
+    MetricRingBuffer *stream;
+    MetricSink *sink;
+    pthread_t sender;
+    bool senderRunning;
     int pourDuration;
+    int metricCount;
 
 } CoffeeMachine;
 
@@ -102,11 +162,63 @@ int PourClassic(int, CoffeeMachine*);
 int PourRich(int, CoffeeMachine*);
 
 //  Metric API
-Metric* CreateMetric(float);
-int SendMetrics(Metric**, size_t metricSize);
+int ReserveMetrics(MetricStore*, size_t capacity);
+int RecordMetric(CoffeeMachine*, float powerUsed);
+int SendMetrics(MetricSink*, MetricStore*);
+int ConnectMetricSink(CoffeeMachine*, const char *destination);
+int StartMetricSender(CoffeeMachine*, MetricRingOverflow overflow);
+void StopMetricSender(CoffeeMachine*);
+size_t MetricQueueDepth(CoffeeMachine*);
+long int MetricsDropped(CoffeeMachine*);
+
+/*
+    Fleet mode. Rather than one machine driven from main, a whole fleet of
+    machines with a mix of pour modes and durations, their pours run as
+    tasks on a work-stealing thread pool (see "Work_Stealing_Pool.h").
+
+    Each machine sends its metrics to a tally sink of its own, and the
+    fleet adds them all up at the end. For each machine we record:
+
+        -   Wait: How long its pour sat in a queue before a worker got to it.
+        -   Pour: How long it took to pour and send every metric.
+        -   Done: How long after the fleet started its last metric was sent.
+
+    and report the fleet's throughput (metrics sent per second) along with
+    the spread of those times across the fleet.
+*/
+#define FLEET_DEFAULT_MACHINES 200
+#define FLEET_MIN_DURATION 1000
+#define FLEET_MAX_DURATION 200000
+
+typedef struct FleetMachine
+{
+    WorkTask task;
+    WorkPool *pool;
+    CoffeeMachine *machine;
+    const char *pourMode;
+    int worker;
+
+    int64_t submittedAt;
+    int64_t startedAt;
+    int64_t finishedAt;
+} FleetMachine;
+
+//  Fleet API
+int RunFleet(int machineCount, int workerCount, uint64_t seed);
 
 int main(int argc, char *argv[])
 {
+    // 'fleet' runs a fleet of machines instead, optionally followed by how many machines, how
+    // many worker threads (defaults to one per core) and a random seed.
+    if (argc > 1 && !strcmp("fleet", argv[1]))
+    {
+        int machineCount = argc > 2 ? (int) strtol(argv[2], NULL, 10) : FLEET_DEFAULT_MACHINES;
+        int workerCount = argc > 3 ? (int) strtol(argv[3], NULL, 10) : 0;
+        uint64_t seed = argc > 4 ? strtoull(argv[4], NULL, 10) : 1;
+
+        return RunFleet(machineCount, workerCount, seed);
+    }
+
     // Instantiate a test coffee machine
     CoffeeMachine *myMachine;
     if (InitCoffeeMachine(&myMachine)) 
@@ -118,6 +230,9 @@ int main(int argc, char *argv[])
     printf("\nMachine Activated\n");
 
     // A pour mode (one of 'decaf', 'rich', or 'classic') is required along with a pour duration.
+    // Optionally, a third argument picks where the metrics go (see ConnectMetricSink), and a
+    // fourth what to do when the sender falls behind: 'block' (the default), 'drop-oldest',
+    // 'sample', or 'sync' to send from the pour itself with no sender thread.
     if (argc > 2) 
     {
         char *userPourMode = argv[1];
@@ -141,12 +256,48 @@ int main(int argc, char *argv[])
             myMachine->pour = PourClassic;
         }
 
+        if (ConnectMetricSink(myMachine, argc > 3 ? argv[3] : "print"))
+        {
+            printf("Unable To Connect The Metric Sink\n");
+            CleanupMachine(myMachine);
+            return 1;
+        }
+
+        char *userOverflow = argc > 4 ? argv[4] : "block";
+        MetricRingOverflow overflow = METRIC_RING_BLOCK;
+
+        if (!strcmp("drop-oldest", userOverflow))
+        {
+            overflow = METRIC_RING_DROP_OLDEST;
+        }
+
+        else if (!strcmp("sample", userOverflow))
+        {
+            overflow = METRIC_RING_SAMPLE;
+        }
+
+        if (strcmp("sync", userOverflow) && StartMetricSender(myMachine, overflow))
+        {
+            printf("Unable To Start Sending Metrics\n");
+            CleanupMachine(myMachine);
+            return 1;
+        }
+
         printf("\nBeginning Pour With Duration: %d\n", duration);
 
         myMachine->pour(duration, myMachine);
 
-        printf("\nPour Complete. Sending Metrics...\n");
-        SendMetrics(myMachine->metrics, duration);
+        printf("\nPour Complete. Sending Any Remaining Metrics...\n");
+        printf("Metrics Still Queued: %zu\n", MetricQueueDepth(myMachine));
+        StopMetricSender(myMachine);
+
+        if (myMachine->stream != NULL)
+        {
+            printf("Peak Queue Depth: %zu Of %zu\n", MetricRingPeakCount(myMachine->stream),
+                   myMachine->stream->capacity);
+        }
+
+        printf("Metrics Dropped: %ld\n", MetricsDropped(myMachine));
 
         printf("\nPerforming Cleanup...\n");
         CleanupMachine(myMachine);
@@ -174,12 +325,22 @@ int main(int argc, char *argv[])
     machine, assign the value of our pointer to pointer as the
     pointer to our new block of memory and return 0 to signal a
     success
+
+    calloc zeroes the machine, so its MetricStore starts off empty. We then
+    give the store room for a whole batch, so it never has to allocate once
+    pouring starts.
 */
 int InitCoffeeMachine(CoffeeMachine **machine) 
 {
 
-    if (*machine = (CoffeeMachine*) malloc(sizeof(CoffeeMachine)))
+    if (*machine = (CoffeeMachine*) calloc(1, sizeof(CoffeeMachine)))
     {
+        if (ReserveMetrics(&(*machine) -> metrics, METRIC_SEND_BATCH))
+        {
+            free(*machine);
+            return 1;
+        }
+
         return 0;
     }
     else
@@ -192,24 +353,12 @@ int InitCoffeeMachine(CoffeeMachine **machine)
 int PourDecaf(int duration, CoffeeMachine *machine) 
 {
     int start = 0;
-    Metric **metricsPtr = (Metric**) malloc(duration * sizeof(Metric));
-
-    machine -> metrics = metricsPtr;
 
     while (start < duration)
     {
         //  Do some processing of pouring here...
         float powerUsed = 4.4;
-        Metric *metric = CreateMetric(powerUsed);
-
-        /*
-            Add the newly created metric to our array of metrics using pointer
-            arithmetic. The offset will be how many times start has been 
-            incremented which should start as 0 and always be lower than the 
-            duration thus ensuring we stay in the bounds of the dynamic
-            memory.
-        */
-        *(metricsPtr + start) = metric;
+        RecordMetric(machine, powerUsed);
         start++;
     }
     return 0;
@@ -218,15 +367,11 @@ int PourDecaf(int duration, CoffeeMachine *machine)
 // Pours a classic cup of coffee - Highest power draw.
 int PourClassic(int duration, CoffeeMachine *machine) {
     int start = 0;
-    Metric **metrics_ptr = (Metric**) malloc(duration * sizeof(Metric));
-    machine->metrics = metrics_ptr;
 
     while (start < duration) {
         // Do some processing of pouring here....
         float power_used = 5.6;
-
-        Metric *metric = CreateMetric(power_used);
-        *(metrics_ptr + start) = metric;
+        RecordMetric(machine, power_used);
         start++;
     }
 
@@ -237,44 +382,609 @@ int PourClassic(int duration, CoffeeMachine *machine) {
 int PourRich(int duration, CoffeeMachine *machine)
 {
     int start = 0;
-    Metric **metrics_ptr = (Metric**) malloc(duration * sizeof(Metric));
-    machine->metrics = metrics_ptr;
 
     while (start < duration) {
         // Do some processing of pouring here....
         float power_used = 3.7;
-        Metric *metric = CreateMetric(power_used);
-        *(metrics_ptr + start) = metric;
+        RecordMetric(machine, power_used);
 
         start++;
     }
     return 0;
 }
 
-Metric* CreateMetric(float powerUsed)
+/*
+    Makes sure the store has room for at least "capacity" metrics, growing
+    it if need be. The store at least doubles each time it grows, so adding
+    metrics one at a time only allocates every so often ("amortized" O(1)
+    per metric).
+
+    Both columns share one block, with the power column starting right after
+    the last sequence number. Growing therefore allocates a new, bigger
+    block and copies each column into place, as the power column has to
+    move further along when there are more sequence numbers in front of it.
+
+    Returns 0 on success, or 1 (leaving the store as it was) if there isn't
+    enough memory.
+*/
+int ReserveMetrics(MetricStore *store, size_t capacity)
+{
+    if (capacity <= store -> capacity)
+    {
+        return 0;
+    }
+
+    size_t newCapacity = store -> capacity * 2;
+
+    if (newCapacity < METRIC_STORE_MIN_CAPACITY)
+    {
+        newCapacity = METRIC_STORE_MIN_CAPACITY;
+    }
+
+    if (newCapacity < capacity)
+    {
+        newCapacity = capacity;
+    }
+
+    if (newCapacity > SIZE_MAX / (sizeof(int) + sizeof(float)))
+    {
+        return 1;
+    }
+
+    void *block = malloc(newCapacity * (sizeof(int) + sizeof(float)));
+
+    if (block == NULL)
+    {
+        return 1;
+    }
+
+    int *sequenceNumbers = (int*) block;
+    float *powerUsed = (float*)(sequenceNumbers + newCapacity);
+
+    if (store -> count > 0)
+    {
+        memcpy(sequenceNumbers, store -> sequenceNumbers, store -> count * sizeof(int));
+        memcpy(powerUsed, store -> powerUsed, store -> count * sizeof(float));
+    }
+
+    free(store -> block);
+
+    store -> block = block;
+    store -> sequenceNumbers = sequenceNumbers;
+    store -> powerUsed = powerUsed;
+    store -> capacity = newCapacity;
+
+    return 0;
+}
+
+/*
+    Logs a metric for the machine's current pour.
+
+    With the sender running, all the pour does is push the metric into the
+    machine's ring buffer. If the sender has fallen a whole ring buffer
+    behind, the buffer's overflow policy decides whether the pour waits for
+    it or a metric is dropped (see "Metric_Ring_Buffer.h").
+
+    Otherwise, the metric goes at the end of the store's columns, and the
+    pour sends the batch itself once the store is full.
+
+    A machine with no sink has nowhere to send its metrics, so nothing is
+    recorded and we return 1.
+*/
+int RecordMetric(CoffeeMachine *machine, float powerUsed)
+{
+    if (machine -> sink == NULL)
+    {
+        return 1;
+    }
+
+    Metric metric = { ++machine -> metricCount, powerUsed };
+
+    if (machine -> senderRunning)
+    {
+        MetricRingPush(machine -> stream, metric);
+        return 0;
+    }
+
+    MetricStore *store = &machine -> metrics;
+
+    store -> sequenceNumbers[store -> count] = metric.sequenceNumber;
+    store -> powerUsed[store -> count] = metric.powerUsed;
+    store -> count++;
+
+    if (store -> count >= METRIC_SEND_BATCH)
+    {
+        return SendMetrics(machine -> sink, store);
+    }
+
+    return 0;
+}
+
+/*
+    The sender thread. Pops up to a batch of metrics at a time off the
+    machine's ring buffer, lays them out in the store's columns and sends
+    them, until the ring buffer is closed and empty. Whilst it runs, the
+    sender is the only thread that touches the store and the sink.
+*/
+static void* MetricSender(void *arg)
+{
+    CoffeeMachine *machine = (CoffeeMachine*) arg;
+    MetricStore *store = &machine -> metrics;
+    Metric batch[METRIC_SEND_BATCH];
+
+    while (true)
+    {
+        bool closed = MetricRingIsClosed(machine -> stream);
+        size_t popped = MetricRingTryPop(machine -> stream, batch, METRIC_SEND_BATCH);
+
+        if (popped > 0)
+        {
+            for (size_t i = 0; i < popped; i++)
+            {
+                store -> sequenceNumbers[i] = batch[i].sequenceNumber;
+                store -> powerUsed[i] = batch[i].powerUsed;
+            }
+
+            store -> count = popped;
+            SendMetrics(machine -> sink, store);
+        }
+        else if (closed)
+        {
+            break;
+        }
+        else
+        {
+            //  Nothing to send, so give the sink a chance to flush metrics that
+            //  have been waiting too long, and the pour a chance to run.
+            MetricSinkPoll(machine -> sink);
+            sched_yield();
+        }
+    }
+
+    MetricSinkFlush(machine -> sink);
+    return NULL;
+}
+
+/*
+    Chooses where the machine's metrics go:
+
+        print           Printed to the terminal, one at a time.
+        file:<path>     Appended to the file at <path> as binary frames.
+        socket:<path>   Sent as binary frames to whatever is listening on
+                        the Unix domain socket at <path>.
+        tally           Sent nowhere, just added up (see "Metric_Sink.h").
+
+    Returns 0 on success, 1 if the destination isn't one of these or the
+    sink can't be opened.
+*/
+int ConnectMetricSink(CoffeeMachine *machine, const char *destination)
+{
+    MetricSinkConfig config;
+    MetricSinkDefaultConfig(&config);
+
+    if (!strcmp("print", destination))
+    {
+        return MetricSinkOpenPrinter(&machine -> sink, stdout, &config);
+    }
+
+    else if (!strncmp("file:", destination, 5))
+    {
+        return MetricSinkOpenFile(&machine -> sink, destination + 5, &config);
+    }
+
+    else if (!strncmp("socket:", destination, 7))
+    {
+        return MetricSinkOpenSocket(&machine -> sink, destination + 7, &config);
+    }
+
+    else if (!strcmp("tally", destination))
+    {
+        return MetricSinkOpenTally(&machine -> sink, &config);
+    }
+
+    printf("Unknown Metric Destination: %s\n", destination);
+    return 1;
+}
+
+/*
+    Starts a background sender thread for the machine, along with the ring
+    buffer it takes metrics from. "overflow" decides what the pour does
+    when the sender falls behind and the ring buffer fills up:
+
+        METRIC_RING_BLOCK         The pour waits for the sender.
+        METRIC_RING_DROP_OLDEST   The oldest queued metric is dropped.
+        METRIC_RING_SAMPLE        Only one in METRIC_SAMPLE_EVERY metrics
+                                  is queued until the sender catches up.
+
+    The machine must have a sink (see ConnectMetricSink), and can only run
+    one sender at a time. Returns 0 on success, 1 otherwise.
+*/
+int StartMetricSender(CoffeeMachine *machine, MetricRingOverflow overflow)
+{
+    if (machine -> sink == NULL || machine -> senderRunning)
+    {
+        return 1;
+    }
+
+    //  Send anything the pour logged before the sender existed first.
+    SendMetrics(machine -> sink, &machine -> metrics);
+    MetricRingDestroy(machine -> stream);
+    machine -> stream = NULL;
+
+    if (MetricRingInit(&machine -> stream, METRIC_RING_CAPACITY) ||
+        MetricRingSetOverflow(machine -> stream, overflow, METRIC_SAMPLE_EVERY))
+    {
+        return 1;
+    }
+
+    if (pthread_create(&machine -> sender, NULL, MetricSender, machine) != 0)
+    {
+        return 1;
+    }
+
+    machine -> senderRunning = true;
+    return 0;
+}
+
+/*
+    Sends every metric the pour has logged so far. If the sender thread is
+    running, it is told no more metrics are coming, and we wait for it to
+    send the ones that are left. Otherwise, whatever is in the store is
+    sent from here. Either way, the sink is flushed.
+
+    The ring buffer (and its counts) are kept until the sender is started
+    again or the machine is cleaned up.
+*/
+void StopMetricSender(CoffeeMachine *machine)
+{
+    if (machine -> senderRunning)
+    {
+        MetricRingClose(machine -> stream);
+        pthread_join(machine -> sender, NULL);
+        machine -> senderRunning = false;
+        return;
+    }
+
+    SendMetrics(machine -> sink, &machine -> metrics);
+    MetricSinkFlush(machine -> sink);
+}
+
+/*
+    How many metrics are queued for the sender thread, 0 if it has never
+    been started.
+*/
+size_t MetricQueueDepth(CoffeeMachine *machine)
 {
-    Metric *metric = (Metric*) malloc(sizeof(Metric));
-    metric -> sequenceNumber = ++metricCount;
-    metric -> powerUsed = powerUsed;
+    return machine -> stream != NULL ? MetricRingCount(machine -> stream) : 0;
+}
 
-    return metric;
+//  How many metrics the sender thread's overflow policy has thrown away.
+long int MetricsDropped(CoffeeMachine *machine)
+{
+    return machine -> stream != NULL ? MetricRingDropped(machine -> stream) : 0;
 }
 
-int SendMetrics(Metric **metrics, size_t metricCount)
+/*
+    Writes every metric in the store to "sink", handing it the store's
+    columns as they are, then empties the store. Its memory is kept for the
+    next batch. The sink decides when the metrics actually go out.
+
+    The store is emptied even if there is no sink to send to (and 1
+    returned), so it can never fill up past its capacity.
+*/
+int SendMetrics(MetricSink *sink, MetricStore *metrics)
 {
     if (metrics == NULL)
     {
         return 1;
     }
 
-    for (int i = 0; i < metricCount; i++)
+    int result = 1;
+
+    if (sink != NULL)
+    {
+        result = MetricSinkWrite(sink, metrics -> sequenceNumbers, metrics -> powerUsed,
+                                 metrics -> count);
+    }
+
+    metrics -> count = 0;
+    return result;
+}
+
+/*
+    Fleet Functions
+*/
+
+static int64_t NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+//  A small xorshift generator, so a seed always builds the same fleet.
+static uint64_t NextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int CompareTimes(const void *left, const void *right)
+{
+    int64_t a = *(const int64_t*) left;
+    int64_t b = *(const int64_t*) right;
+
+    return (a > b) - (a < b);
+}
+
+/*
+    Gives a fleet machine a random pour mode and duration. The duration is
+    picked from a range that is itself picked at random, doubling from
+    FLEET_MIN_DURATION up to FLEET_MAX_DURATION, so most pours are short
+    but a few are very long (just the mix that leaves workers idle when the
+    machines are shared out evenly).
+*/
+static void ChoosePour(CoffeeMachine *machine, const char **pourMode, uint64_t *state)
+{
+    int range = FLEET_MIN_DURATION;
+    int doublings = (int)(NextRandom(state) % 9);
+
+    for (int i = 0; i < doublings && range * 2 <= FLEET_MAX_DURATION; i++)
+    {
+        range *= 2;
+    }
+
+    machine -> pourDuration = FLEET_MIN_DURATION + (int)(NextRandom(state) % (uint64_t) range);
+
+    switch (NextRandom(state) % 3)
+    {
+        case 0:
+            machine -> pour = PourDecaf;
+            *pourMode = "decaf";
+            break;
+
+        case 1:
+            machine -> pour = PourRich;
+            *pourMode = "rich";
+            break;
+
+        default:
+            machine -> pour = PourClassic;
+            *pourMode = "classic";
+            break;
+    }
+}
+
+/*
+    A fleet machine's task: runs its pour, then sends whatever metrics are
+    left. There is no sender thread per machine (the pool's workers are the
+    only threads), so the pour sends each batch itself as it fills up.
+*/
+static void FleetPour(void *arg)
+{
+    FleetMachine *fleetMachine = (FleetMachine*) arg;
+    CoffeeMachine *machine = fleetMachine -> machine;
+
+    fleetMachine -> startedAt = NowNanoseconds();
+    fleetMachine -> worker = WorkPoolCurrentWorker(fleetMachine -> pool);
+
+    machine -> pour(machine -> pourDuration, machine);
+    StopMetricSender(machine);
+
+    fleetMachine -> finishedAt = NowNanoseconds();
+}
+
+/*
+    Submits every machine's pour from one of the pool's own workers, so
+    they all land on that worker's deque and the rest of the pool has to
+    steal them. This is the worst case for sharing work out, and so the
+    best test of the stealing.
+*/
+typedef struct FleetLauncher
+{
+    WorkTask task;
+    WorkPool *pool;
+    FleetMachine *machines;
+    int machineCount;
+} FleetLauncher;
+
+static void LaunchFleet(void *arg)
+{
+    FleetLauncher *launcher = (FleetLauncher*) arg;
+
+    for (int i = 0; i < launcher -> machineCount; i++)
+    {
+        FleetMachine *fleetMachine = &launcher -> machines[i];
+
+        fleetMachine -> submittedAt = NowNanoseconds();
+        WorkPoolSubmit(launcher -> pool, &fleetMachine -> task);
+    }
+}
+
+//  Prints the 50th and 99th percentile and the largest of "count" times.
+static void PrintFleetTimes(const char *name, int64_t *times, int count)
+{
+    qsort(times, count, sizeof(int64_t), CompareTimes);
+
+    printf("%-16s %12.3f %12.3f %12.3f\n", name,
+           times[(count - 1) / 2] / 1e6,
+           times[(int)((count - 1) * 0.99)] / 1e6,
+           times[count - 1] / 1e6);
+}
+
+//  Cleans up every machine in the fleet that was built, then the fleet itself.
+static void FreeFleet(FleetMachine *machines, int machineCount)
+{
+    for (int i = 0; i < machineCount && machines[i].machine != NULL; i++)
+    {
+        CleanupMachine(machines[i].machine);
+    }
+
+    free(machines);
+}
+
+/*
+    Allocates a fleet of "machineCount" machines, each with a tally sink and
+    a pour picked using "seed". Returns 0 on success, or 1 (having freed
+    whatever was built) otherwise.
+*/
+static int BuildFleet(FleetMachine **machines, int machineCount, uint64_t seed)
+{
+    if (!(*machines = (FleetMachine*) calloc(machineCount, sizeof(FleetMachine))))
+    {
+        printf("System does not have enough memory for a fleet of %d machines\n",
+               machineCount);
+        return 1;
+    }
+
+    //  xorshift gets stuck on 0 forever.
+    uint64_t state = seed != 0 ? seed : 1;
+
+    for (int i = 0; i < machineCount; i++)
     {
-        Metric *metric = metrics[i];
-        printf("\n Metric Count: %d\n", metric -> sequenceNumber);
-        printf("Metric Power Used: %.2f\n", metric -> powerUsed);
+        FleetMachine *fleetMachine = &(*machines)[i];
+
+        if (InitCoffeeMachine(&fleetMachine -> machine))
+        {
+            printf("System does not have enough memory to allocate a CoffeeMachine\n");
+            fleetMachine -> machine = NULL;
+            FreeFleet(*machines, machineCount);
+            return 1;
+        }
+
+        if (ConnectMetricSink(fleetMachine -> machine, "tally"))
+        {
+            printf("Unable To Connect The Metric Sink\n");
+            FreeFleet(*machines, machineCount);
+            return 1;
+        }
 
-        //  Here we could send each metric to the cloud via a web service/API.
+        ChoosePour(fleetMachine -> machine, &fleetMachine -> pourMode, &state);
+        fleetMachine -> task.run = FleetPour;
+        fleetMachine -> task.arg = fleetMachine;
     }
+
+    return 0;
+}
+
+/*
+    Builds a fleet of "machineCount" machines, pours them all on a pool of
+    "workerCount" workers (one per core if "workerCount" is 0), then reports
+    how the fleet did. "seed" picks the fleet's mix of pours, so the same
+    seed always builds the same fleet.
+
+    Returns 0 on success, 1 if the fleet couldn't be built.
+*/
+int RunFleet(int machineCount, int workerCount, uint64_t seed)
+{
+    if (machineCount <= 0)
+    {
+        printf("A Fleet Needs At Least One Machine\n");
+        return 1;
+    }
+
+    if (workerCount <= 0)
+    {
+#if !defined(_WIN32)
+        workerCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        workerCount = workerCount > 0 ? workerCount : 1;
+    }
+
+    FleetMachine *machines;
+    if (BuildFleet(&machines, machineCount, seed))
+    {
+        return 1;
+    }
+
+    int64_t *times = (int64_t*) malloc(machineCount * sizeof(int64_t));
+    WorkPool *pool = NULL;
+
+    if (times == NULL || WorkPoolInit(&pool, workerCount, 0))
+    {
+        printf("Unable To Start The Fleet\n");
+        free(times);
+        FreeFleet(machines, machineCount);
+        return 1;
+    }
+
+    for (int i = 0; i < machineCount; i++)
+    {
+        machines[i].pool = pool;
+    }
+
+    printf("\nPouring A Fleet Of %d Machines On %d Workers...\n", machineCount, workerCount);
+
+    FleetLauncher launcher = { { LaunchFleet, &launcher, NULL }, pool, machines,
+                               machineCount };
+
+    int64_t fleetStart = NowNanoseconds();
+    WorkPoolSubmit(pool, &launcher.task);
+    WorkPoolWait(pool);
+    int64_t fleetEnd = NowNanoseconds();
+
+    //  Add up what every machine's sink sent, and how many of each pour.
+    long int metricsSent = 0;
+    long int framesSent = 0;
+    long int failedFrames = 0;
+    double powerSent = 0;
+    int decaf = 0, rich = 0, classic = 0;
+
+    for (int i = 0; i < machineCount; i++)
+    {
+        MetricSink *sink = machines[i].machine -> sink;
+
+        metricsSent += sink -> metricsSent;
+        framesSent += sink -> framesSent;
+        failedFrames += sink -> failedFrames;
+        powerSent += sink -> powerSent;
+
+        decaf += !strcmp("decaf", machines[i].pourMode);
+        rich += !strcmp("rich", machines[i].pourMode);
+        classic += !strcmp("classic", machines[i].pourMode);
+    }
+
+    double seconds = (fleetEnd - fleetStart) / 1e9;
+
+    printf("\nFleet Complete\n");
+    printf("Machines: %d (Decaf %d, Rich %d, Classic %d)\n", machineCount, decaf, rich,
+           classic);
+    printf("Wall Time: %.3f ms\n", seconds * 1e3);
+    printf("Metrics Sent: %ld In %ld Frames (%ld Failed)\n", metricsSent, framesSent,
+           failedFrames);
+    printf("Power Used: %.1f\n", powerSent);
+    printf("Fleet Throughput: %.1f Million Metrics/s\n", metricsSent / seconds / 1e6);
+
+    //  How long each machine waited, poured, and took to finish, in milliseconds.
+    printf("\n%-16s %12s %12s %12s\n", "Per Machine (ms)", "p50", "p99", "Max");
+
+    for (int i = 0; i < machineCount; i++)
+    {
+        times[i] = machines[i].startedAt - machines[i].submittedAt;
+    }
+    PrintFleetTimes("Queue Wait", times, machineCount);
+
+    for (int i = 0; i < machineCount; i++)
+    {
+        times[i] = machines[i].finishedAt - machines[i].startedAt;
+    }
+    PrintFleetTimes("Pour", times, machineCount);
+
+    for (int i = 0; i < machineCount; i++)
+    {
+        times[i] = machines[i].finishedAt - fleetStart;
+    }
+    PrintFleetTimes("Done", times, machineCount);
+
+    printf("\n");
+    PrintWorkPoolReport(pool);
+
+    //  The workers have finished with the machines, so stop them before the fleet goes.
+    WorkPoolDestroy(pool);
+    free(times);
+    FreeFleet(machines, machineCount);
     return 0;
 }
 
@@ -317,24 +1027,22 @@ void CleanupMachine(CoffeeMachine *machine)
         pointers. There are no more pointers inside our CoffeeMachine
         struct left to handle, so we can now dispose of the CoffeeMachine
         itself!
+
+        Now that the metrics live in a MetricStore, the chain is much
+        shorter: every metric sits in the store's single block, so that one
+        block (along with the ring buffer and sink the metrics go through)
+        is all there is to free before the machine itself.
     */
-    //  Iterate over the total number of metrics that were produced.
-    for (int i = 0; i < machine -> pourDuration; i++)
+    //  Make sure the sender thread has finished with the store and sink first.
+    if (machine -> senderRunning)
     {
-        /*  
-            Remember, "metrics" is a dynamically allocated array of pointers to
-            a pointer to metrics. In order to free our metric from memory, we 
-            need to extract that pointer and pass it to free via an array index.
-        */
-        Metric *metric = machine -> metrics[i];
-        printf("\n Freeing Metric At Count: %d\n", metric -> sequenceNumber);
-
-        //  
-        free(metric);
+        StopMetricSender(machine);
     }
 
-    //  Free up the memory containing the pointers to the pointers to metrics!
-    free(machine -> metrics);
+    //  Free up the block holding every column of the metric store!
+    free(machine -> metrics.block);
+    MetricRingDestroy(machine -> stream);
+    MetricSinkClose(machine -> sink);
 
     //  Free up the memory we allocated for our CoffeeMachine structure as a
     //  whole. 
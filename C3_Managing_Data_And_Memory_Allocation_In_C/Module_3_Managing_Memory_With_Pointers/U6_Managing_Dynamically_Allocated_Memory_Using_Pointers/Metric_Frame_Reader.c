@@ -0,0 +1,207 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "Metric_Sink.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+/*
+    A stand-in for whatever will eventually receive a coffee machine's
+    metrics. It reads the binary frames a file or socket sink sends (see
+    "Metric_Sink.h") and reports what arrived:
+
+        Metric_Frame_Reader file <path>
+            Reads every frame in a file written by a file sink.
+
+        Metric_Frame_Reader socket <path>
+            Listens on a Unix domain socket at <path>, takes the first
+            machine that connects, and reads frames until it hangs up.
+
+    Add "-v" to print every metric as well as the summary.
+
+    Each machine numbers its metrics 1, 2, 3..., so any sequence number
+    that isn't one more than the last is counted as a gap (metrics lost or
+    sent out of order). File sinks append to their file, so a file written
+    by several runs has a gap where each new run starts counting again.
+*/
+
+typedef struct FrameSummary
+{
+    long int frames;
+    long int metrics;
+    long int gaps;
+    int firstSequence;
+    int lastSequence;
+    double powerUsed;
+} FrameSummary;
+
+/*
+    Reads frames from "stream" until it ends. Returns 0 if it ended cleanly
+    between two frames, 1 if it held something that wasn't a whole frame.
+*/
+static int ReadFrames(FILE *stream, FrameSummary *summary, int verbose)
+{
+    unsigned char header[METRIC_FRAME_HEADER_SIZE];
+    unsigned char record[METRIC_FRAME_RECORD_SIZE];
+    size_t headerBytes;
+
+    while ((headerBytes = fread(header, 1, sizeof(header), stream)) == sizeof(header))
+    {
+        size_t count;
+
+        if (MetricFrameDecodeHeader(header, &count))
+        {
+            printf("Frame %ld Has An Invalid Header\n", summary -> frames + 1);
+            return 1;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (fread(record, 1, sizeof(record), stream) != sizeof(record))
+            {
+                printf("Frame %ld Ends Part Way Through\n", summary -> frames + 1);
+                return 1;
+            }
+
+            Metric metric;
+            MetricFrameDecodeRecord(record, &metric);
+
+            if (summary -> metrics == 0)
+            {
+                summary -> firstSequence = metric.sequenceNumber;
+            }
+            else if (metric.sequenceNumber != summary -> lastSequence + 1)
+            {
+                summary -> gaps++;
+            }
+
+            if (verbose)
+            {
+                printf("Metric %d: %.2f\n", metric.sequenceNumber, metric.powerUsed);
+            }
+
+            summary -> lastSequence = metric.sequenceNumber;
+            summary -> powerUsed += metric.powerUsed;
+            summary -> metrics++;
+        }
+
+        summary -> frames++;
+    }
+
+    if (headerBytes != 0)
+    {
+        printf("Frame %ld Ends Part Way Through Its Header\n", summary -> frames + 1);
+        return 1;
+    }
+
+    return ferror(stream) ? 1 : 0;
+}
+
+/*
+    Listens on "path" and returns a stream for the first connection, or
+    NULL if there isn't one.
+*/
+static FILE* AcceptMachine(const char *path)
+{
+#if !defined(_WIN32)
+    struct sockaddr_un address;
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        printf("Socket Path Is Too Long: %s\n", path);
+        return NULL;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0)
+    {
+        return NULL;
+    }
+
+    unlink(path);
+
+    if (bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+        listen(listener, 1) != 0)
+    {
+        printf("Unable To Listen On: %s\n", path);
+        close(listener);
+        return NULL;
+    }
+
+    printf("Listening On %s\n", path);
+    fflush(stdout);
+
+    int machine = accept(listener, NULL, NULL);
+
+    close(listener);
+    unlink(path);
+
+    if (machine < 0)
+    {
+        return NULL;
+    }
+
+    FILE *stream = fdopen(machine, "rb");
+
+    if (stream == NULL)
+    {
+        close(machine);
+    }
+
+    return stream;
+#else
+    printf("Metric Sockets Are Not Supported On This Platform\n");
+    return NULL;
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || (strcmp(argv[1], "file") != 0 && strcmp(argv[1], "socket") != 0))
+    {
+        printf("Usage: %s file|socket <path> [-v]\n", argv[0]);
+        return 1;
+    }
+
+    int verbose = argc > 3 && strcmp(argv[3], "-v") == 0;
+    FILE *stream = NULL;
+
+    if (strcmp(argv[1], "file") == 0)
+    {
+        stream = fopen(argv[2], "rb");
+    }
+    else
+    {
+        stream = AcceptMachine(argv[2]);
+    }
+
+    if (stream == NULL)
+    {
+        printf("Unable To Read Metrics From: %s\n", argv[2]);
+        return 1;
+    }
+
+    FrameSummary summary = { 0 };
+    int result = ReadFrames(stream, &summary, verbose);
+
+    fclose(stream);
+
+    printf("%ld Frames, %ld Metrics (%d To %d), %ld Gaps, %.2f Power Used\n",
+           summary.frames, summary.metrics, summary.firstSequence, summary.lastSequence,
+           summary.gaps, summary.powerUsed);
+
+    return result;
+}
@@ -0,0 +1,376 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include "Metric_Ring_Buffer.h"
+
+/*
+    A Metric is packed into one 64 bit word (sequence number in the low
+    half, the bits of the power reading in the high half) so that a slot
+    can be read and written in one atomic step.
+*/
+static uint64_t PackMetric(Metric metric)
+{
+    uint32_t power;
+    memcpy(&power, &metric.powerUsed, sizeof(float));
+
+    return (uint64_t)(uint32_t) metric.sequenceNumber | ((uint64_t) power << 32);
+}
+
+static Metric UnpackMetric(uint64_t packed)
+{
+    Metric metric;
+    uint32_t power = (uint32_t)(packed >> 32);
+
+    metric.sequenceNumber = (int)(int32_t)(uint32_t) packed;
+    memcpy(&metric.powerUsed, &power, sizeof(float));
+
+    return metric;
+}
+
+/*
+    Creates a ring buffer with room for at least "capacity" metrics. The
+    buffer itself is allocated on a cache line boundary so that the padding
+    in MetricRingBuffer really does keep the two threads' counters apart.
+
+    Returns 0 on success, or 1 if the capacity is 0 (or too big) or there
+    isn't enough memory.
+*/
+int MetricRingInit(MetricRingBuffer **ring, size_t capacity)
+{
+    if (ring == NULL || capacity == 0 || capacity > SIZE_MAX / 2 / sizeof(uint64_t))
+    {
+        return 1;
+    }
+
+    size_t rounded = 1;
+
+    while (rounded < capacity)
+    {
+        rounded <<= 1;
+    }
+
+    *ring = (MetricRingBuffer*) aligned_alloc(METRIC_RING_CACHE_LINE_SIZE,
+                                              sizeof(MetricRingBuffer));
+
+    if (*ring == NULL)
+    {
+        printf("Unable To Allocate Memory For The Metric Ring Buffer\n");
+        return 1;
+    }
+
+    memset(*ring, 0, sizeof(MetricRingBuffer));
+    (*ring) -> slots = (_Atomic uint64_t*) malloc(rounded * sizeof(uint64_t));
+
+    if ((*ring) -> slots == NULL)
+    {
+        printf("Unable To Allocate Memory For The Metric Ring Buffer\n");
+        free(*ring);
+        *ring = NULL;
+        return 1;
+    }
+
+    (*ring) -> capacity = rounded;
+    (*ring) -> mask = rounded - 1;
+    (*ring) -> overflow = METRIC_RING_BLOCK;
+    (*ring) -> sampleEvery = 1;
+    atomic_init(&(*ring) -> tail, 0);
+    atomic_init(&(*ring) -> dropped, 0);
+    atomic_init(&(*ring) -> peakCount, 0);
+    atomic_init(&(*ring) -> head, 0);
+    atomic_init(&(*ring) -> released, 0);
+    atomic_init(&(*ring) -> closed, false);
+
+    return 0;
+}
+
+void MetricRingDestroy(MetricRingBuffer *ring)
+{
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    free(ring -> slots);
+    free(ring);
+}
+
+/*
+    Chooses what MetricRingPush does when the buffer is full (see
+    "Metric_Ring_Buffer.h"). "sampleEvery" is only used by
+    METRIC_RING_SAMPLE, and must be at least 1. Call this before the
+    producer starts pushing.
+
+    Returns 0 on success, or 1 if the policy or sample rate isn't valid.
+*/
+int MetricRingSetOverflow(MetricRingBuffer *ring, MetricRingOverflow overflow,
+                          unsigned int sampleEvery)
+{
+    if (ring == NULL || overflow < METRIC_RING_BLOCK || overflow > METRIC_RING_SAMPLE ||
+        sampleEvery == 0)
+    {
+        return 1;
+    }
+
+    ring -> overflow = overflow;
+    ring -> sampleEvery = sampleEvery;
+    return 0;
+}
+
+/*
+    Producer only. Writes "metric" into the next free slot, or returns false
+    straight away if the buffer is full. A slot is free once the consumer
+    has released it, not just claimed it (see "Metric_Ring_Buffer.h").
+*/
+bool MetricRingTryPush(MetricRingBuffer *ring, Metric metric)
+{
+    size_t tail = atomic_load_explicit(&ring -> tail, memory_order_relaxed);
+
+    if (tail - ring -> cachedReleased >= ring -> capacity)
+    {
+        ring -> cachedReleased = atomic_load_explicit(&ring -> released, memory_order_acquire);
+
+        if (tail - ring -> cachedReleased >= ring -> capacity)
+        {
+            return false;
+        }
+    }
+
+    atomic_store_explicit(&ring -> slots[tail & ring -> mask], PackMetric(metric),
+                          memory_order_relaxed);
+    atomic_store_explicit(&ring -> tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+static void MetricRingCountDrop(MetricRingBuffer *ring)
+{
+    long int dropped = atomic_load_explicit(&ring -> dropped, memory_order_relaxed);
+    atomic_store_explicit(&ring -> dropped, dropped + 1, memory_order_relaxed);
+}
+
+/*
+    Makes room for one more metric by moving "head" past the oldest one,
+    then "released" after it, as the metric is gone without being copied.
+
+    The consumer may have released slots since the push found the buffer
+    full, in which case there is room again and nothing is dropped. If
+    "head" is ahead of "released", the consumer is still copying a batch
+    out of the slots we need, so we wait for it to finish instead. If the
+    consumer claims the oldest metric first, the compare and swap fails
+    with nothing dropped. The consumer may also release its next batch
+    before we get to move "released", in which case it is already past the
+    metric we dropped and is left alone.
+*/
+static void MetricRingDropOldest(MetricRingBuffer *ring)
+{
+    size_t tail = atomic_load_explicit(&ring -> tail, memory_order_relaxed);
+    size_t released = atomic_load_explicit(&ring -> released, memory_order_acquire);
+    size_t head = atomic_load_explicit(&ring -> head, memory_order_acquire);
+
+    if (tail - released < ring -> capacity)
+    {
+        return;
+    }
+
+    if (head != released)
+    {
+        sched_yield();
+        return;
+    }
+
+    if (atomic_compare_exchange_strong_explicit(&ring -> head, &head, head + 1,
+                                                memory_order_acq_rel, memory_order_acquire))
+    {
+        atomic_compare_exchange_strong_explicit(&ring -> released, &released, released + 1,
+                                                memory_order_acq_rel, memory_order_acquire);
+        MetricRingCountDrop(ring);
+    }
+}
+
+/*
+    Producer only. Pushes "metric" following the buffer's overflow policy
+    when it is full: waiting for room, dropping the oldest metric, or
+    sampling. Returns false if "metric" itself was dropped.
+*/
+bool MetricRingPush(MetricRingBuffer *ring, Metric metric)
+{
+    if (ring -> overflow == METRIC_RING_SAMPLE)
+    {
+        size_t tail = atomic_load_explicit(&ring -> tail, memory_order_relaxed);
+
+        if (tail - ring -> cachedReleased >= ring -> capacity / 2)
+        {
+            ring -> cachedReleased = atomic_load_explicit(&ring -> released,
+                                                          memory_order_acquire);
+        }
+
+        if (tail - ring -> cachedReleased >= ring -> capacity / 2 &&
+            ++ring -> sampleCount % ring -> sampleEvery != 0)
+        {
+            MetricRingCountDrop(ring);
+            return false;
+        }
+    }
+
+    while (!MetricRingTryPush(ring, metric))
+    {
+        if (ring -> overflow == METRIC_RING_DROP_OLDEST)
+        {
+            MetricRingDropOldest(ring);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    return true;
+}
+
+//  Consumer only. Keeps "peakCount" up to date with a depth it just saw.
+static void MetricRingNotePeak(MetricRingBuffer *ring, size_t count)
+{
+    if (count > atomic_load_explicit(&ring -> peakCount, memory_order_relaxed))
+    {
+        atomic_store_explicit(&ring -> peakCount, count, memory_order_relaxed);
+    }
+}
+
+/*
+    Consumer only. Copies up to "maxCount" of the oldest metrics into
+    "metrics" and frees their slots. Returns how many were copied, which is
+    0 if the buffer is empty.
+
+    The metrics are claimed first, by moving "head" past them. If the
+    producer drops the oldest metric in the meantime the claim fails and we
+    simply try again from the new "head", having copied nothing. Once the
+    claim succeeds the producer won't touch those slots until they are
+    released, so the copy can take as long as it likes. A producer dropping
+    metrics can also move "head" past our cached "tail".
+*/
+size_t MetricRingTryPop(MetricRingBuffer *ring, Metric *metrics, size_t maxCount)
+{
+    size_t head;
+    size_t available;
+
+    while (true)
+    {
+        head = atomic_load_explicit(&ring -> head, memory_order_acquire);
+        available = ring -> cachedTail - head;
+
+        if (available == 0 || available > ring -> capacity)
+        {
+            ring -> cachedTail = atomic_load_explicit(&ring -> tail, memory_order_acquire);
+            available = ring -> cachedTail - head;
+
+            if (available == 0)
+            {
+                return 0;
+            }
+
+            //  The producer dropped metrics between us reading "head" and "tail".
+            if (available > ring -> capacity)
+            {
+                continue;
+            }
+        }
+
+        MetricRingNotePeak(ring, available);
+
+        if (available > maxCount)
+        {
+            available = maxCount;
+        }
+
+        if (atomic_compare_exchange_strong_explicit(&ring -> head, &head, head + available,
+                                                    memory_order_acq_rel,
+                                                    memory_order_acquire))
+        {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < available; i++)
+    {
+        uint64_t packed = atomic_load_explicit(&ring -> slots[(head + i) & ring -> mask],
+                                               memory_order_relaxed);
+        metrics[i] = UnpackMetric(packed);
+    }
+
+    atomic_store_explicit(&ring -> released, head + available, memory_order_release);
+    return available;
+}
+
+/*
+    Consumer only. Like MetricRingTryPop, but waits until there is at least
+    one metric to pop. Returns 0 only once the producer has closed the
+    buffer AND every metric it pushed has been popped, which is the
+    consumer's cue to stop.
+
+    "closed" is read before popping. If it was already set, every push came
+    before it, so an empty pop really means there is nothing left.
+*/
+size_t MetricRingPop(MetricRingBuffer *ring, Metric *metrics, size_t maxCount)
+{
+    while (true)
+    {
+        bool closed = MetricRingIsClosed(ring);
+        size_t popped = MetricRingTryPop(ring, metrics, maxCount);
+
+        if (popped > 0 || closed)
+        {
+            return popped;
+        }
+
+        sched_yield();
+    }
+}
+
+//  Producer only. Tells the consumer that no more metrics are coming.
+void MetricRingClose(MetricRingBuffer *ring)
+{
+    atomic_store_explicit(&ring -> closed, true, memory_order_release);
+}
+
+/*
+    Whether the producer has closed the buffer. A consumer that finds it
+    closed and then pops nothing knows every metric has been popped.
+*/
+bool MetricRingIsClosed(MetricRingBuffer *ring)
+{
+    return atomic_load_explicit(&ring -> closed, memory_order_acquire);
+}
+
+/*
+    How many metrics are waiting to be popped (the "queue depth"). Any
+    thread may ask, but the answer can be out of date by the time it is
+    used.
+*/
+size_t MetricRingCount(MetricRingBuffer *ring)
+{
+    size_t head = atomic_load_explicit(&ring -> head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring -> tail, memory_order_acquire);
+
+    return tail - head;
+}
+
+/*
+    The most metrics the consumer has found waiting at once. It only looks
+    when it pops, so this can miss a brief peak, but never overstates one.
+*/
+size_t MetricRingPeakCount(MetricRingBuffer *ring)
+{
+    return atomic_load_explicit(&ring -> peakCount, memory_order_relaxed);
+}
+
+//  How many metrics the producer has thrown away because the buffer was full.
+long int MetricRingDropped(MetricRingBuffer *ring)
+{
+    return atomic_load_explicit(&ring -> dropped, memory_order_relaxed);
+}
@@ -0,0 +1,146 @@
+/*
+    If a coffee machine holds on to every metric until its pour is over,
+    a long pour needs a lot of memory, and nobody hears about the start of
+    the pour until the very end of it.
+
+    A "ring buffer" lets the metrics stream out whilst the pour is still
+    running. It is a fixed size array of slots that two threads share:
+
+        -   The "producer" (the pour loop) writes each metric into the slot
+            at "tail" and then moves "tail" on by one.
+
+        -   The "consumer" (a sender thread) reads the metrics between
+            "head" and "tail" and then moves "head" on past them.
+
+    Both counters only ever go up. Slot "i" lives at "i % capacity", so once
+    the producer reaches the end of the array it wraps round to the start
+    and reuses the slots the consumer has already read (hence "ring"). The
+    buffer holds "tail - head" metrics, and is full once that reaches its
+    capacity. However long the pour, the memory used never changes.
+
+    As there is only ever ONE producer and ONE consumer, no locks are
+    needed: each counter is only written by one thread (but see
+    METRIC_RING_DROP_OLDEST below). Each thread writes the slots first and
+    publishes its counter afterwards ("release"), and the other thread
+    reads the counter before the slots ("acquire"), so a metric is always
+    complete before the consumer can see it.
+
+    Each thread also keeps a "cached" copy of the other thread's counter
+    and only reads the real one again when the cached copy says the buffer
+    is full (or empty). The counters are padded onto cache lines of their
+    own so the two threads don't fight over one line (see
+    "Benchmark_False_Sharing.c" in Module 5).
+
+    The capacity is always rounded up to a power of two, so that
+    "i % capacity" is a cheap "i & mask".
+
+    What happens when the producer finds the buffer full is up to its
+    "overflow" policy:
+
+        -   METRIC_RING_BLOCK (the default): The producer waits for the
+            consumer to make room. Nothing is lost, but a slow consumer
+            slows the pour down.
+
+        -   METRIC_RING_DROP_OLDEST: The producer throws away the oldest
+            metric in the buffer to make room for the new one, so the
+            consumer always gets the most recent metrics.
+
+        -   METRIC_RING_SAMPLE: Once the buffer is at least half full, the
+            producer only keeps one in every "sampleEvery" metrics and
+            drops the rest, waiting for room for the ones it keeps. The
+            consumer gets an evenly thinned out picture of the whole pour.
+
+    Every metric the producer throws away is counted in "dropped".
+
+    Dropping the oldest metric means the producer moves "head" on as well
+    as the consumer, so both of them move it with a compare and swap. The
+    consumer claims its metrics this way BEFORE copying them, and only then
+    moves a second counter, "released", on past them to hand their slots
+    back. The producer only ever writes into slots that have been released,
+    so it can never overwrite a metric that is being copied, and it only
+    drops a metric that nobody has claimed. If the buffer is full because
+    of the consumer's batch in flight, the producer waits for that copy (a
+    few hundred loads at most) rather than dropping anything. A claimed
+    batch is never thrown away, so however often the producer drops
+    metrics, the consumer gets as many as it can keep up with. Slots are
+    read and written as single 64 bit atomics (a Metric packed into one
+    word).
+
+    The "peak" depth is kept by the consumer, from the number of metrics it
+    finds waiting each time it pops.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifndef METRIC_RING_BUFFER_H
+#define METRIC_RING_BUFFER_H
+
+#define METRIC_RING_CACHE_LINE_SIZE 64
+
+typedef struct Metric
+{
+    int sequenceNumber;
+    float powerUsed;
+} Metric;
+
+typedef enum MetricRingOverflow
+{
+    METRIC_RING_BLOCK,
+    METRIC_RING_DROP_OLDEST,
+    METRIC_RING_SAMPLE
+} MetricRingOverflow;
+
+typedef struct MetricRingBuffer
+{
+    //  Set by MetricRingInit and MetricRingSetOverflow, then only read.
+    _Atomic uint64_t *slots;
+    size_t capacity;
+    size_t mask;
+    MetricRingOverflow overflow;
+    unsigned int sampleEvery;
+
+    //  The producer's line.
+    _Alignas(METRIC_RING_CACHE_LINE_SIZE) _Atomic size_t tail;
+    size_t cachedReleased;
+    unsigned int sampleCount;
+    _Atomic long int dropped;
+
+    //  The consumer's line.
+    _Alignas(METRIC_RING_CACHE_LINE_SIZE) _Atomic size_t head;
+    _Atomic size_t released;
+    size_t cachedTail;
+    _Atomic size_t peakCount;
+
+    //  Set by the producer once it has nothing more to push.
+    _Alignas(METRIC_RING_CACHE_LINE_SIZE) _Atomic bool closed;
+} MetricRingBuffer;
+
+int MetricRingInit(MetricRingBuffer **ring, size_t capacity);
+
+void MetricRingDestroy(MetricRingBuffer *ring);
+
+int MetricRingSetOverflow(MetricRingBuffer *ring, MetricRingOverflow overflow,
+                          unsigned int sampleEvery);
+
+bool MetricRingTryPush(MetricRingBuffer *ring, Metric metric);
+
+bool MetricRingPush(MetricRingBuffer *ring, Metric metric);
+
+size_t MetricRingTryPop(MetricRingBuffer *ring, Metric *metrics, size_t maxCount);
+
+size_t MetricRingPop(MetricRingBuffer *ring, Metric *metrics, size_t maxCount);
+
+void MetricRingClose(MetricRingBuffer *ring);
+
+bool MetricRingIsClosed(MetricRingBuffer *ring);
+
+size_t MetricRingCount(MetricRingBuffer *ring);
+
+size_t MetricRingPeakCount(MetricRingBuffer *ring);
+
+long int MetricRingDropped(MetricRingBuffer *ring);
+
+#endif
@@ -0,0 +1,470 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "Metric_Sink.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+//  Not every platform can stop a write to a closed socket raising SIGPIPE.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static int64_t NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*
+    Frame fields are always stored little endian, so they are written and
+    read a byte at a time rather than copied straight out of memory.
+*/
+static void PutUint16(unsigned char *bytes, uint16_t value)
+{
+    bytes[0] = (unsigned char)(value & 0xFF);
+    bytes[1] = (unsigned char)(value >> 8);
+}
+
+static void PutUint32(unsigned char *bytes, uint32_t value)
+{
+    bytes[0] = (unsigned char)(value & 0xFF);
+    bytes[1] = (unsigned char)((value >> 8) & 0xFF);
+    bytes[2] = (unsigned char)((value >> 16) & 0xFF);
+    bytes[3] = (unsigned char)(value >> 24);
+}
+
+static uint16_t GetUint16(const unsigned char *bytes)
+{
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t GetUint32(const unsigned char *bytes)
+{
+    return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) |
+           ((uint32_t) bytes[3] << 24);
+}
+
+/*
+    Checks a frame header, and if it is one we understand, reads how many
+    records follow it into "count". Returns 0 for a valid header, 1
+    otherwise.
+*/
+int MetricFrameDecodeHeader(const unsigned char *header, size_t *count)
+{
+    if (GetUint32(header) != METRIC_FRAME_MAGIC ||
+        GetUint16(header + 4) != METRIC_FRAME_VERSION ||
+        GetUint16(header + 6) != METRIC_FRAME_RECORD_SIZE)
+    {
+        return 1;
+    }
+
+    *count = GetUint32(header + 8);
+    return 0;
+}
+
+void MetricFrameDecodeRecord(const unsigned char *record, Metric *metric)
+{
+    uint32_t power = GetUint32(record + 4);
+
+    metric -> sequenceNumber = (int)(int32_t) GetUint32(record);
+    memcpy(&metric -> powerUsed, &power, sizeof(float));
+}
+
+static void EncodeRecord(unsigned char *record, int sequenceNumber, float powerUsed)
+{
+    uint32_t power;
+    memcpy(&power, &powerUsed, sizeof(float));
+
+    PutUint32(record, (uint32_t) sequenceNumber);
+    PutUint32(record + 4, power);
+}
+
+/*
+    Writes all of "size" bytes to the sink's socket. A stream socket may
+    take fewer bytes than it was offered, so keep going until it has the
+    lot.
+*/
+static int FlushToSocket(MetricSink *sink, const unsigned char *frame, size_t size)
+{
+#if !defined(_WIN32)
+    while (size > 0)
+    {
+        ssize_t sent = send(sink -> socket, frame, size, MSG_NOSIGNAL);
+
+        if (sent <= 0)
+        {
+            return 1;
+        }
+
+        frame += sent;
+        size -= (size_t) sent;
+    }
+
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+static int FlushToFile(MetricSink *sink, const unsigned char *frame, size_t size)
+{
+    if (fwrite(frame, 1, size, sink -> stream) != size || fflush(sink -> stream) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+//  The printer decodes the frame it has just built and prints each metric.
+static int FlushToPrinter(MetricSink *sink, const unsigned char *frame, size_t size)
+{
+    size_t count = (size - METRIC_FRAME_HEADER_SIZE) / METRIC_FRAME_RECORD_SIZE;
+    const unsigned char *record = frame + METRIC_FRAME_HEADER_SIZE;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Metric metric;
+        MetricFrameDecodeRecord(record, &metric);
+        record += METRIC_FRAME_RECORD_SIZE;
+
+        fprintf(sink -> stream, "\n Metric Count: %d\n", metric.sequenceNumber);
+        fprintf(sink -> stream, "Metric Power Used: %.2f\n", metric.powerUsed);
+    }
+
+    return 0;
+}
+
+//  The tally decodes the frame it has just built and adds up the power used.
+static int FlushToTally(MetricSink *sink, const unsigned char *frame, size_t size)
+{
+    size_t count = (size - METRIC_FRAME_HEADER_SIZE) / METRIC_FRAME_RECORD_SIZE;
+    const unsigned char *record = frame + METRIC_FRAME_HEADER_SIZE;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Metric metric;
+        MetricFrameDecodeRecord(record, &metric);
+        record += METRIC_FRAME_RECORD_SIZE;
+
+        sink -> powerSent += metric.powerUsed;
+    }
+
+    return 0;
+}
+
+static void CloseSocket(MetricSink *sink)
+{
+#if !defined(_WIN32)
+    close(sink -> socket);
+#endif
+}
+
+static void CloseFile(MetricSink *sink)
+{
+    fclose(sink -> stream);
+}
+
+//  The printer doesn't own its stream (it's usually stdout), so leaves it open.
+static void ClosePrinter(MetricSink *sink)
+{
+    fflush(sink -> stream);
+}
+
+//  The tally has nothing to close.
+static void CloseTally(MetricSink *sink)
+{
+    (void) sink;
+}
+
+void MetricSinkDefaultConfig(MetricSinkConfig *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config -> flushRecords = METRIC_SINK_DEFAULT_FLUSH_RECORDS;
+    config -> flushMilliseconds = METRIC_SINK_DEFAULT_FLUSH_MILLISECONDS;
+}
+
+/*
+    Allocates a sink and its frame, ready for one of the MetricSinkOpen
+    functions to fill in where its frames go. Returns 0 on success.
+*/
+static int MetricSinkCreate(MetricSink **sink, const MetricSinkConfig *config)
+{
+    MetricSinkConfig defaults;
+
+    if (config == NULL)
+    {
+        MetricSinkDefaultConfig(&defaults);
+        config = &defaults;
+    }
+
+    size_t maxRecords = (SIZE_MAX - METRIC_FRAME_HEADER_SIZE) / METRIC_FRAME_RECORD_SIZE;
+
+    if (maxRecords > UINT32_MAX)
+    {
+        maxRecords = UINT32_MAX;
+    }
+
+    if (config -> flushRecords == 0 || config -> flushRecords > maxRecords)
+    {
+        printf("A Metric Sink Must Flush Between 1 And %zu Records\n", maxRecords);
+        return 1;
+    }
+
+    *sink = (MetricSink*) calloc(1, sizeof(MetricSink));
+
+    if (*sink == NULL)
+    {
+        printf("Unable To Allocate Memory For The Metric Sink\n");
+        return 1;
+    }
+
+    size_t frameSize = METRIC_FRAME_HEADER_SIZE +
+                       config -> flushRecords * METRIC_FRAME_RECORD_SIZE;
+    (*sink) -> frame = (unsigned char*) malloc(frameSize);
+
+    if ((*sink) -> frame == NULL)
+    {
+        printf("Unable To Allocate Memory For The Metric Sink\n");
+        free(*sink);
+        *sink = NULL;
+        return 1;
+    }
+
+    (*sink) -> socket = -1;
+    (*sink) -> flushRecords = config -> flushRecords;
+    (*sink) -> flushNanoseconds = (int64_t) config -> flushMilliseconds * 1000000;
+
+    return 0;
+}
+
+static void MetricSinkFree(MetricSink *sink)
+{
+    free(sink -> frame);
+    free(sink);
+}
+
+int MetricSinkOpenPrinter(MetricSink **sink, FILE *stream, const MetricSinkConfig *config)
+{
+    if (sink == NULL || stream == NULL || MetricSinkCreate(sink, config))
+    {
+        return 1;
+    }
+
+    (*sink) -> stream = stream;
+    (*sink) -> flushFrame = FlushToPrinter;
+    (*sink) -> closeSink = ClosePrinter;
+
+    return 0;
+}
+
+//  Frames are appended to "path", so restarting a machine keeps what it sent before.
+int MetricSinkOpenFile(MetricSink **sink, const char *path, const MetricSinkConfig *config)
+{
+    if (sink == NULL || path == NULL || MetricSinkCreate(sink, config))
+    {
+        return 1;
+    }
+
+    (*sink) -> stream = fopen(path, "ab");
+
+    if ((*sink) -> stream == NULL)
+    {
+        printf("Unable To Open Metric File: %s\n", path);
+        MetricSinkFree(*sink);
+        *sink = NULL;
+        return 1;
+    }
+
+    (*sink) -> flushFrame = FlushToFile;
+    (*sink) -> closeSink = CloseFile;
+
+    return 0;
+}
+
+int MetricSinkOpenTally(MetricSink **sink, const MetricSinkConfig *config)
+{
+    if (sink == NULL || MetricSinkCreate(sink, config))
+    {
+        return 1;
+    }
+
+    (*sink) -> flushFrame = FlushToTally;
+    (*sink) -> closeSink = CloseTally;
+
+    return 0;
+}
+
+/*
+    Connects to a process listening on the Unix domain socket at "path".
+    Unix domain sockets aren't available on Windows, where this always
+    fails.
+*/
+int MetricSinkOpenSocket(MetricSink **sink, const char *path, const MetricSinkConfig *config)
+{
+#if !defined(_WIN32)
+    struct sockaddr_un address;
+
+    if (sink == NULL || path == NULL || strlen(path) >= sizeof(address.sun_path) ||
+        MetricSinkCreate(sink, config))
+    {
+        return 1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    (*sink) -> socket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if ((*sink) -> socket < 0 ||
+        connect((*sink) -> socket, (struct sockaddr*) &address, sizeof(address)) != 0)
+    {
+        printf("Unable To Connect To Metric Socket: %s\n", path);
+
+        if ((*sink) -> socket >= 0)
+        {
+            close((*sink) -> socket);
+        }
+
+        MetricSinkFree(*sink);
+        *sink = NULL;
+        return 1;
+    }
+
+    (*sink) -> flushFrame = FlushToSocket;
+    (*sink) -> closeSink = CloseSocket;
+
+    return 0;
+#else
+    printf("Metric Sockets Are Not Supported On This Platform\n");
+    return 1;
+#endif
+}
+
+/*
+    Hands the pending records to the sink as a single frame, however many
+    there are. Does nothing if there are none. Returns 0 on success, or 1
+    if the frame couldn't be sent (its metrics are dropped either way, so
+    one bad write doesn't hold up every metric after it).
+*/
+int MetricSinkFlush(MetricSink *sink)
+{
+    if (sink == NULL)
+    {
+        return 1;
+    }
+
+    if (sink -> pendingRecords == 0)
+    {
+        return 0;
+    }
+
+    PutUint32(sink -> frame, METRIC_FRAME_MAGIC);
+    PutUint16(sink -> frame + 4, METRIC_FRAME_VERSION);
+    PutUint16(sink -> frame + 6, METRIC_FRAME_RECORD_SIZE);
+    PutUint32(sink -> frame + 8, (uint32_t) sink -> pendingRecords);
+
+    size_t size = METRIC_FRAME_HEADER_SIZE + sink -> pendingRecords * METRIC_FRAME_RECORD_SIZE;
+    int result = sink -> flushFrame(sink, sink -> frame, size);
+
+    if (result == 0)
+    {
+        sink -> framesSent++;
+        sink -> metricsSent += (long int) sink -> pendingRecords;
+    }
+    else
+    {
+        sink -> failedFrames++;
+    }
+
+    sink -> pendingRecords = 0;
+    return result;
+}
+
+/*
+    Flushes the pending records if the oldest of them has been waiting
+    for "flushMilliseconds". The sender calls this whilst it has nothing
+    else to do, so a quiet machine's last few metrics still go out.
+*/
+int MetricSinkPoll(MetricSink *sink)
+{
+    if (sink == NULL)
+    {
+        return 1;
+    }
+
+    if (sink -> pendingRecords > 0 &&
+        NowNanoseconds() - sink -> pendingSince >= sink -> flushNanoseconds)
+    {
+        return MetricSinkFlush(sink);
+    }
+
+    return 0;
+}
+
+/*
+    Packs "count" metrics, given as a column of sequence numbers and a
+    column of power readings, into the sink's frame, flushing each time
+    the frame fills up and once more at the end if the oldest pending
+    metric has waited too long. Returns 0 if every flush succeeded.
+*/
+int MetricSinkWrite(MetricSink *sink, const int *sequenceNumbers, const float *powerUsed,
+                    size_t count)
+{
+    if (sink == NULL)
+    {
+        return 1;
+    }
+
+    int result = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (sink -> pendingRecords == 0)
+        {
+            sink -> pendingSince = NowNanoseconds();
+        }
+
+        unsigned char *record = sink -> frame + METRIC_FRAME_HEADER_SIZE +
+                                sink -> pendingRecords * METRIC_FRAME_RECORD_SIZE;
+
+        EncodeRecord(record, sequenceNumbers[i], powerUsed[i]);
+        sink -> pendingRecords++;
+
+        if (sink -> pendingRecords == sink -> flushRecords)
+        {
+            result |= MetricSinkFlush(sink);
+        }
+    }
+
+    return result | MetricSinkPoll(sink);
+}
+
+//  Flushes anything still pending, then closes and frees the sink.
+void MetricSinkClose(MetricSink *sink)
+{
+    if (sink == NULL)
+    {
+        return;
+    }
+
+    MetricSinkFlush(sink);
+    sink -> closeSink(sink);
+    MetricSinkFree(sink);
+}
@@ -0,0 +1,116 @@
+/*
+    Printing every metric (two printf calls each) is by far the slowest
+    part of a pour, and it still doesn't get the metrics anywhere. A
+    "sink" is wherever a machine's metrics end up: the terminal, a file on
+    the machine, or another process listening on a socket that forwards
+    them to the cloud.
+
+    Every sink works the same way. Metrics written to it are packed into a
+    binary "frame", and the frame is only handed over (flushed) once it
+    holds "flushRecords" metrics, or its oldest metric has been waiting for
+    "flushMilliseconds", whichever comes first. One frame then costs one
+    write, however many metrics it holds.
+
+    A frame is a header followed by the packed records, every field stored
+    little endian whatever the machine:
+
+        Header (METRIC_FRAME_HEADER_SIZE bytes)
+            uint32  magic         METRIC_FRAME_MAGIC ("WBCM")
+            uint16  version       METRIC_FRAME_VERSION
+            uint16  recordSize    METRIC_FRAME_RECORD_SIZE
+            uint32  count         How many records follow
+
+        Record (METRIC_FRAME_RECORD_SIZE bytes), "count" times
+            int32   sequenceNumber
+            float32 powerUsed     (IEEE 754 bits)
+
+    Frames are just written one after another, so a file sink produces a
+    file of frames and a socket sink a stream of them, and both can be read
+    back with the same code (see "Metric_Frame_Reader.c").
+
+    The printer sink builds frames like any other and then prints them,
+    one metric at a time, in the same format the coffee machine always
+    has.
+
+    The tally sink sends its frames nowhere. It reads each one back and
+    adds up what it held, so a load test can push a fleet's worth of
+    metrics through the whole pipeline without the output drowning it.
+
+    A sink is not thread safe: only one thread at a time (the machine's
+    sender, or whichever thread is running its pour) may write to it.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "Metric_Ring_Buffer.h"
+
+#ifndef METRIC_SINK_H
+#define METRIC_SINK_H
+
+#define METRIC_FRAME_MAGIC 0x4D434257u
+#define METRIC_FRAME_VERSION 1
+#define METRIC_FRAME_HEADER_SIZE 12
+#define METRIC_FRAME_RECORD_SIZE 8
+
+#define METRIC_SINK_DEFAULT_FLUSH_RECORDS 1024
+#define METRIC_SINK_DEFAULT_FLUSH_MILLISECONDS 100
+
+typedef struct MetricSinkConfig
+{
+    size_t flushRecords;
+    long int flushMilliseconds;
+} MetricSinkConfig;
+
+/*
+    "flushFrame" hands a finished frame to wherever the sink sends its
+    metrics, and "closeSink" releases whatever it sends them through (the
+    FILE or socket). Each kind of sink fills them in when it is opened.
+*/
+typedef struct MetricSink
+{
+    int (*flushFrame)(struct MetricSink *sink, const unsigned char *frame, size_t size);
+    void (*closeSink)(struct MetricSink *sink);
+
+    FILE *stream;
+    int socket;
+
+    //  The frame being filled, with room for "flushRecords" records.
+    unsigned char *frame;
+    size_t pendingRecords;
+    int64_t pendingSince;
+
+    size_t flushRecords;
+    int64_t flushNanoseconds;
+
+    long int framesSent;
+    long int metricsSent;
+    long int failedFrames;
+    double powerSent;
+} MetricSink;
+
+void MetricSinkDefaultConfig(MetricSinkConfig *config);
+
+int MetricSinkOpenPrinter(MetricSink **sink, FILE *stream, const MetricSinkConfig *config);
+
+int MetricSinkOpenFile(MetricSink **sink, const char *path, const MetricSinkConfig *config);
+
+int MetricSinkOpenSocket(MetricSink **sink, const char *path, const MetricSinkConfig *config);
+
+int MetricSinkOpenTally(MetricSink **sink, const MetricSinkConfig *config);
+
+int MetricSinkWrite(MetricSink *sink, const int *sequenceNumbers, const float *powerUsed,
+                    size_t count);
+
+int MetricSinkPoll(MetricSink *sink);
+
+int MetricSinkFlush(MetricSink *sink);
+
+void MetricSinkClose(MetricSink *sink);
+
+int MetricFrameDecodeHeader(const unsigned char *header, size_t *count);
+
+void MetricFrameDecodeRecord(const unsigned char *record, Metric *metric);
+
+#endif
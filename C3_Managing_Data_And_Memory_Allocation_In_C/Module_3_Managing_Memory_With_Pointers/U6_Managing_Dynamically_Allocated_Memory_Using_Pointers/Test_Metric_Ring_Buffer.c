@@ -0,0 +1,198 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include "Metric_Ring_Buffer.h"
+
+/*
+    Checks that the ring buffer's overflow policies lose nothing they don't
+    own up to, and that dropping the oldest metrics doesn't starve the
+    sender.
+
+        gcc -std=c11 -O2 -pthread -o Test_Metric_Ring_Buffer \
+            Test_Metric_Ring_Buffer.c Metric_Ring_Buffer.c
+
+    For each policy, one thread pushes TEST_METRICS metrics into a small
+    ring buffer whilst a sender pops them, first as fast as it can and then
+    taking TEST_SLOW_SEND_NS per metric. Every run must:
+
+        -   Account for every metric: pushed == delivered + dropped.
+
+        -   Deliver the metrics in the order they were pushed, each at most
+            once.
+
+        -   Drop nothing at all when blocking.
+
+    With the slow sender, drop-oldest must also deliver at least half of
+    what the sender could have sent with the CPU time it got, rather than
+    losing its batches to the pour. The sender's "sending" and this check
+    both go by the sender thread's own CPU clock, so a sender that simply
+    wasn't scheduled (on a single core, say) isn't counted against the ring
+    buffer.
+
+    Prints a line per run and returns 0 if every check passed, 1 otherwise.
+*/
+
+#define TEST_METRICS 1000000L
+#define TEST_CAPACITY 1024
+#define TEST_BATCH 256
+#define TEST_SLOW_SEND_NS 200
+#define TEST_SAMPLE_EVERY 8
+
+typedef struct TestRun
+{
+    MetricRingBuffer *ring;
+    int64_t sendNanoseconds;
+
+    long int delivered;
+    long int outOfOrder;
+    int lastSequenceNumber;
+    int64_t senderNanoseconds;
+} TestRun;
+
+//  How much CPU time the calling thread has used.
+static int64_t ThreadNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void* Sender(void *arg)
+{
+    TestRun *run = (TestRun*) arg;
+    Metric batch[TEST_BATCH];
+    size_t popped;
+    int64_t begin = ThreadNanoseconds();
+
+    while ((popped = MetricRingPop(run -> ring, batch, TEST_BATCH)) > 0)
+    {
+        for (size_t i = 0; i < popped; i++)
+        {
+            if (batch[i].sequenceNumber <= run -> lastSequenceNumber)
+            {
+                run -> outOfOrder++;
+            }
+
+            run -> lastSequenceNumber = batch[i].sequenceNumber;
+        }
+
+        run -> delivered += (long int) popped;
+
+        if (run -> sendNanoseconds > 0)
+        {
+            int64_t until = ThreadNanoseconds() + run -> sendNanoseconds * (int64_t) popped;
+
+            while (ThreadNanoseconds() < until)
+            {
+            }
+        }
+    }
+
+    run -> senderNanoseconds = ThreadNanoseconds() - begin;
+    return NULL;
+}
+
+/*
+    Runs one policy with a sender taking "sendNanoseconds" per metric, and
+    returns 0 if every check passed.
+*/
+static int RunPolicy(const char *name, MetricRingOverflow overflow, int64_t sendNanoseconds)
+{
+    TestRun run = { NULL, sendNanoseconds, 0, 0, 0, 0 };
+
+    if (MetricRingInit(&run.ring, TEST_CAPACITY) ||
+        MetricRingSetOverflow(run.ring, overflow, TEST_SAMPLE_EVERY))
+    {
+        printf("Unable To Create The Metric Ring Buffer\n");
+        MetricRingDestroy(run.ring);
+        return 1;
+    }
+
+    pthread_t sender;
+
+    if (pthread_create(&sender, NULL, Sender, &run) != 0)
+    {
+        printf("Unable To Start The Sender\n");
+        MetricRingDestroy(run.ring);
+        return 1;
+    }
+
+    for (long int i = 1; i <= TEST_METRICS; i++)
+    {
+        Metric metric = { (int) i, 4.4f };
+        MetricRingPush(run.ring, metric);
+    }
+
+    MetricRingClose(run.ring);
+    pthread_join(sender, NULL);
+
+    long int dropped = MetricRingDropped(run.ring);
+    int failed = 0;
+
+    if (run.delivered + dropped != TEST_METRICS)
+    {
+        printf("    %ld Delivered + %ld Dropped != %ld Pushed\n", run.delivered, dropped,
+               TEST_METRICS);
+        failed = 1;
+    }
+
+    if (run.outOfOrder > 0)
+    {
+        printf("    %ld Metrics Delivered Out Of Order Or Twice\n", run.outOfOrder);
+        failed = 1;
+    }
+
+    if (overflow == METRIC_RING_BLOCK && dropped > 0)
+    {
+        printf("    %ld Metrics Dropped Whilst Blocking\n", dropped);
+        failed = 1;
+    }
+
+    //  What the sender could have sent with the CPU time it had.
+    long int drainable = sendNanoseconds > 0 ? (long int)(run.senderNanoseconds /
+                                                          sendNanoseconds) : 0;
+
+    if (drainable > TEST_METRICS)
+    {
+        drainable = TEST_METRICS;
+    }
+
+    if (overflow == METRIC_RING_DROP_OLDEST && run.delivered < drainable / 2)
+    {
+        printf("    Only %ld Delivered, When The Sender Could Drain %ld\n", run.delivered,
+               drainable);
+        failed = 1;
+    }
+
+    printf("%14s %8lld %12ld %12ld %12ld %8s\n", name, (long long) sendNanoseconds,
+           run.delivered, dropped, drainable, failed ? "FAIL" : "ok");
+
+    MetricRingDestroy(run.ring);
+    return failed;
+}
+
+int main(void)
+{
+    printf("%ld Metrics Through A Ring Of %d\n", TEST_METRICS, TEST_CAPACITY);
+    printf("%14s %8s %12s %12s %12s\n", "", "Send ns", "Delivered", "Dropped", "Drainable");
+
+    int failed = 0;
+    int64_t sendTimes[] = { 0, TEST_SLOW_SEND_NS };
+
+    for (size_t i = 0; i < sizeof(sendTimes) / sizeof(sendTimes[0]); i++)
+    {
+        failed |= RunPolicy("block", METRIC_RING_BLOCK, sendTimes[i]);
+        failed |= RunPolicy("drop-oldest", METRIC_RING_DROP_OLDEST, sendTimes[i]);
+        failed |= RunPolicy("sample", METRIC_RING_SAMPLE, sendTimes[i]);
+    }
+
+    printf(failed ? "\nFAILED\n" : "\nAll Checks Passed\n");
+    return failed;
+}
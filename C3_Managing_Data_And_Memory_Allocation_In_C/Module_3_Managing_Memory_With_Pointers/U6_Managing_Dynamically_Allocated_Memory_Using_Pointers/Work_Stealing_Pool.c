@@ -0,0 +1,435 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include "Work_Stealing_Pool.h"
+
+/*
+    How many times an idle worker looks for work, yielding in between,
+    before it starts sleeping for WORK_POOL_IDLE_SLEEP_NS between looks.
+*/
+#define WORK_POOL_IDLE_SPINS 64
+#define WORK_POOL_IDLE_SLEEP_NS 50000
+
+//  The worker the calling thread is, if it is one of a pool's workers.
+static _Thread_local WorkWorker *currentWorker = NULL;
+
+//  A small xorshift generator, one per worker, for picking who to rob.
+static uint64_t NextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void CountUp(_Atomic long int *counter)
+{
+    long int value = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, value + 1, memory_order_relaxed);
+}
+
+/*
+    Owner only. Puts "task" on the bottom of the deque, or returns false if
+    the deque is full.
+
+    The task is stored before "bottom" is moved on ("release"), so a thief
+    that sees the new "bottom" also sees the task.
+*/
+static bool DequePush(WorkDeque *deque, WorkTask *task)
+{
+    long int bottom = atomic_load_explicit(&deque -> bottom, memory_order_relaxed);
+    long int top = atomic_load_explicit(&deque -> top, memory_order_acquire);
+
+    if (bottom - top >= deque -> capacity)
+    {
+        return false;
+    }
+
+    atomic_store_explicit(&deque -> tasks[bottom % deque -> capacity], task,
+                          memory_order_relaxed);
+    atomic_store_explicit(&deque -> bottom, bottom + 1, memory_order_release);
+
+    return true;
+}
+
+/*
+    Owner only. Takes the task on the bottom of the deque, or returns NULL
+    if it is empty.
+
+    The owner claims the bottom task by moving "bottom" up BEFORE reading
+    "top", so a thief either sees the smaller deque or the owner sees the
+    thief's move of "top". When only one task is left, both may want it,
+    and whoever moves "top" on first wins it.
+*/
+static WorkTask* DequeTake(WorkDeque *deque)
+{
+    long int bottom = atomic_load_explicit(&deque -> bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque -> bottom, bottom, memory_order_seq_cst);
+    long int top = atomic_load_explicit(&deque -> top, memory_order_seq_cst);
+
+    if (top > bottom)
+    {
+        atomic_store_explicit(&deque -> bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    WorkTask *task = atomic_load_explicit(&deque -> tasks[bottom % deque -> capacity],
+                                          memory_order_relaxed);
+
+    if (top == bottom)
+    {
+        if (!atomic_compare_exchange_strong_explicit(&deque -> top, &top, top + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed))
+        {
+            task = NULL;
+        }
+
+        atomic_store_explicit(&deque -> bottom, bottom + 1, memory_order_relaxed);
+    }
+
+    return task;
+}
+
+/*
+    Any thread. Takes the task at the top of the deque (its oldest), or
+    returns NULL if the deque is empty or another thread got there first.
+*/
+static WorkTask* DequeSteal(WorkDeque *deque)
+{
+    long int top = atomic_load_explicit(&deque -> top, memory_order_seq_cst);
+    long int bottom = atomic_load_explicit(&deque -> bottom, memory_order_seq_cst);
+
+    if (top >= bottom)
+    {
+        return NULL;
+    }
+
+    WorkTask *task = atomic_load_explicit(&deque -> tasks[top % deque -> capacity],
+                                          memory_order_relaxed);
+
+    if (!atomic_compare_exchange_strong_explicit(&deque -> top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+    {
+        return NULL;
+    }
+
+    return task;
+}
+
+static void InjectTask(WorkPool *pool, WorkTask *task)
+{
+    task -> next = NULL;
+
+    pthread_mutex_lock(&pool -> injectLock);
+
+    if (pool -> injectTail != NULL)
+    {
+        pool -> injectTail -> next = task;
+    }
+    else
+    {
+        pool -> injectHead = task;
+    }
+
+    pool -> injectTail = task;
+    atomic_fetch_add_explicit(&pool -> injectCount, 1, memory_order_release);
+
+    pthread_mutex_unlock(&pool -> injectLock);
+}
+
+//  Takes the oldest injected task. The count is checked first to skip the lock.
+static WorkTask* TakeInjected(WorkPool *pool)
+{
+    if (atomic_load_explicit(&pool -> injectCount, memory_order_acquire) == 0)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool -> injectLock);
+
+    WorkTask *task = pool -> injectHead;
+
+    if (task != NULL)
+    {
+        pool -> injectHead = task -> next;
+
+        if (pool -> injectHead == NULL)
+        {
+            pool -> injectTail = NULL;
+        }
+
+        atomic_fetch_sub_explicit(&pool -> injectCount, 1, memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&pool -> injectLock);
+
+    return task;
+}
+
+/*
+    Looks for the next task for "worker": its own deque first, then the
+    injection queue, then every other worker's deque, starting from a
+    random one.
+*/
+static WorkTask* FindTask(WorkWorker *worker)
+{
+    WorkPool *pool = worker -> pool;
+    WorkTask *task = DequeTake(&worker -> deque);
+
+    if (task == NULL)
+    {
+        task = TakeInjected(pool);
+    }
+
+    if (task == NULL && pool -> workerCount > 1)
+    {
+        int first = (int)(NextRandom(&worker -> randomState) % (uint64_t) pool -> workerCount);
+
+        for (int i = 0; i < pool -> workerCount && task == NULL; i++)
+        {
+            int victim = (first + i) % pool -> workerCount;
+
+            if (victim != worker -> index)
+            {
+                task = DequeSteal(&pool -> workers[victim].deque);
+            }
+        }
+
+        if (task != NULL)
+        {
+            CountUp(&worker -> steals);
+        }
+    }
+
+    return task;
+}
+
+static void FinishTask(WorkPool *pool)
+{
+    if (atomic_fetch_sub_explicit(&pool -> pending, 1, memory_order_acq_rel) == 1)
+    {
+        pthread_mutex_lock(&pool -> idleLock);
+        pthread_cond_broadcast(&pool -> idle);
+        pthread_mutex_unlock(&pool -> idleLock);
+    }
+}
+
+/*
+    A worker runs tasks until the pool is destroyed. When it can't find
+    any, it yields for a while and then sleeps between looks, so an idle
+    pool doesn't keep every core busy.
+*/
+static void* WorkerLoop(void *arg)
+{
+    WorkWorker *worker = (WorkWorker*) arg;
+    WorkPool *pool = worker -> pool;
+    int misses = 0;
+
+    currentWorker = worker;
+
+    while (!atomic_load_explicit(&pool -> stopping, memory_order_acquire))
+    {
+        WorkTask *task = FindTask(worker);
+
+        if (task != NULL)
+        {
+            misses = 0;
+            task -> run(task -> arg);
+            CountUp(&worker -> tasksRun);
+            FinishTask(pool);
+        }
+        else if (misses < WORK_POOL_IDLE_SPINS)
+        {
+            misses++;
+            sched_yield();
+        }
+        else
+        {
+            struct timespec pause = { 0, WORK_POOL_IDLE_SLEEP_NS };
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    currentWorker = NULL;
+    return NULL;
+}
+
+/*
+    Creates a pool of "workerCount" workers, each with a deque of
+    "dequeCapacity" tasks (WORK_POOL_DEFAULT_DEQUE_CAPACITY if 0), and
+    starts them. Returns 0 on success, 1 otherwise.
+*/
+int WorkPoolInit(WorkPool **pool, int workerCount, long int dequeCapacity)
+{
+    if (pool == NULL || workerCount < 1 || dequeCapacity < 0)
+    {
+        return 1;
+    }
+
+    if (dequeCapacity == 0)
+    {
+        dequeCapacity = WORK_POOL_DEFAULT_DEQUE_CAPACITY;
+    }
+
+    *pool = (WorkPool*) calloc(1, sizeof(WorkPool));
+
+    if (*pool == NULL)
+    {
+        printf("Unable To Allocate Memory For The Work Pool\n");
+        return 1;
+    }
+
+    (*pool) -> workers = (WorkWorker*) aligned_alloc(WORK_POOL_CACHE_LINE_SIZE,
+                                                      sizeof(WorkWorker) * workerCount);
+
+    if ((*pool) -> workers == NULL)
+    {
+        printf("Unable To Allocate Memory For The Work Pool\n");
+        free(*pool);
+        *pool = NULL;
+        return 1;
+    }
+
+    pthread_mutex_init(&(*pool) -> injectLock, NULL);
+    pthread_mutex_init(&(*pool) -> idleLock, NULL);
+    pthread_cond_init(&(*pool) -> idle, NULL);
+    atomic_init(&(*pool) -> injectCount, 0);
+    atomic_init(&(*pool) -> pending, 0);
+    atomic_init(&(*pool) -> stopping, false);
+
+    //  Every deque is set up before any worker starts, as workers rob each other.
+    for (int i = 0; i < workerCount; i++)
+    {
+        WorkWorker *worker = &(*pool) -> workers[i];
+
+        worker -> deque.tasks = (_Atomic(WorkTask*)*) calloc(dequeCapacity, sizeof(WorkTask*));
+        worker -> deque.capacity = dequeCapacity;
+        atomic_init(&worker -> deque.top, 0);
+        atomic_init(&worker -> deque.bottom, 0);
+        worker -> pool = *pool;
+        worker -> index = i;
+        worker -> randomState = 0x9E3779B97F4A7C15 ^ ((uint64_t) i * 0xBF58476D1CE4E5B9);
+        atomic_init(&worker -> tasksRun, 0);
+        atomic_init(&worker -> steals, 0);
+
+        if (worker -> deque.tasks == NULL)
+        {
+            printf("Unable To Allocate Memory For The Work Pool\n");
+            (*pool) -> workerCount = i + 1;
+            WorkPoolDestroy(*pool);
+            *pool = NULL;
+            return 1;
+        }
+    }
+
+    (*pool) -> workerCount = workerCount;
+
+    for (int i = 0; i < workerCount; i++)
+    {
+        WorkWorker *worker = &(*pool) -> workers[i];
+
+        if (pthread_create(&worker -> thread, NULL, WorkerLoop, worker) != 0)
+        {
+            printf("Unable To Start Work Pool Worker %d\n", i);
+            (*pool) -> startedCount = i;
+            WorkPoolDestroy(*pool);
+            *pool = NULL;
+            return 1;
+        }
+    }
+
+    (*pool) -> startedCount = workerCount;
+    return 0;
+}
+
+/*
+    Stops every worker and frees the pool. Tasks that haven't run yet are
+    abandoned, so call WorkPoolWait first.
+*/
+void WorkPoolDestroy(WorkPool *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    atomic_store_explicit(&pool -> stopping, true, memory_order_release);
+
+    for (int i = 0; i < pool -> startedCount; i++)
+    {
+        pthread_join(pool -> workers[i].thread, NULL);
+    }
+
+    for (int i = 0; i < pool -> workerCount; i++)
+    {
+        free(pool -> workers[i].deque.tasks);
+    }
+
+    pthread_cond_destroy(&pool -> idle);
+    pthread_mutex_destroy(&pool -> idleLock);
+    pthread_mutex_destroy(&pool -> injectLock);
+    free(pool -> workers);
+    free(pool);
+}
+
+/*
+    Queues "task" to run on one of the pool's workers. Called from one of
+    the workers, the task goes on that worker's own deque (where others can
+    steal it); from anywhere else, into the injection queue.
+*/
+void WorkPoolSubmit(WorkPool *pool, WorkTask *task)
+{
+    atomic_fetch_add_explicit(&pool -> pending, 1, memory_order_relaxed);
+
+    if (currentWorker != NULL && currentWorker -> pool == pool &&
+        DequePush(&currentWorker -> deque, task))
+    {
+        return;
+    }
+
+    InjectTask(pool, task);
+}
+
+//  Waits until every task submitted so far (and every task they submit) has run.
+void WorkPoolWait(WorkPool *pool)
+{
+    pthread_mutex_lock(&pool -> idleLock);
+
+    while (atomic_load_explicit(&pool -> pending, memory_order_acquire) > 0)
+    {
+        pthread_cond_wait(&pool -> idle, &pool -> idleLock);
+    }
+
+    pthread_mutex_unlock(&pool -> idleLock);
+}
+
+//  The index of the worker the calling thread is, or -1 if it isn't one.
+int WorkPoolCurrentWorker(WorkPool *pool)
+{
+    if (currentWorker == NULL || currentWorker -> pool != pool)
+    {
+        return -1;
+    }
+
+    return currentWorker -> index;
+}
+
+void PrintWorkPoolReport(WorkPool *pool)
+{
+    printf("%8s %12s %12s\n", "Worker", "Tasks Run", "Steals");
+
+    for (int i = 0; i < pool -> workerCount; i++)
+    {
+        WorkWorker *worker = &pool -> workers[i];
+
+        printf("%8d %12ld %12ld\n", i,
+               atomic_load_explicit(&worker -> tasksRun, memory_order_relaxed),
+               atomic_load_explicit(&worker -> steals, memory_order_relaxed));
+    }
+}
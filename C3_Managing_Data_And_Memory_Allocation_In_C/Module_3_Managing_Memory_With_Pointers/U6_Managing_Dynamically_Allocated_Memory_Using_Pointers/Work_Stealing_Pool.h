@@ -0,0 +1,117 @@
+/*
+    A fleet of coffee machines means hundreds of pours to run at once, far
+    more than there are cores. Rather than a thread per machine, we run
+    each pour as a "task" on a small pool of worker threads, one per core.
+
+    Pours vary wildly in length, so handing each worker an equal share of
+    the machines up front would leave some workers idle whilst others are
+    still working through a pile of long pours. Instead, the pool uses
+    "work stealing":
+
+        -   Every worker has its own double ended queue ("deque") of tasks.
+            Tasks a worker submits go on the bottom of its own deque, and it
+            takes its next task from the bottom too (newest first, whilst
+            the task's data is still in its cache). Only the owner ever
+            touches the bottom, so this costs next to nothing.
+
+        -   A worker whose deque is empty picks another worker at random and
+            "steals" the task at the TOP of that worker's deque (its oldest
+            task). Thieves and the owner only ever compete for the last task
+            in a deque, which is settled with a compare and swap.
+
+        -   Tasks submitted from outside the pool (by a thread that isn't one
+            of its workers) go into a shared "injection" queue guarded by a
+            lock, which idle workers check before they go stealing.
+
+    Busy workers never wait on each other, and idle workers find work
+    wherever it is. The deques are Chase-Lev deques ("Dynamic Circular
+    Work-Stealing Deque", Chase and Lev, 2005) with a fixed capacity. A
+    task submitted to a full deque goes to the injection queue instead.
+
+    A task is a WorkTask the caller owns: usually a member of whatever the
+    task works on, so submitting one never allocates. It must stay alive
+    until it has run.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#define WORK_POOL_CACHE_LINE_SIZE 64
+#define WORK_POOL_DEFAULT_DEQUE_CAPACITY 4096
+
+typedef struct WorkTask
+{
+    void (*run)(void *arg);
+    void *arg;
+
+    //  Links tasks in the injection queue.
+    struct WorkTask *next;
+} WorkTask;
+
+/*
+    One worker's deque. "bottom" is only written by its owner and "top" by
+    whoever takes the oldest task, so each gets its own cache line.
+*/
+typedef struct WorkDeque
+{
+    _Atomic(WorkTask*) *tasks;
+    long int capacity;
+
+    _Alignas(WORK_POOL_CACHE_LINE_SIZE) _Atomic long int top;
+    _Alignas(WORK_POOL_CACHE_LINE_SIZE) _Atomic long int bottom;
+} WorkDeque;
+
+/*
+    A worker thread. Its counters are only written by the worker itself,
+    but are atomic so they can be reported whilst the pool is running.
+*/
+typedef struct WorkWorker
+{
+    WorkDeque deque;
+    struct WorkPool *pool;
+    pthread_t thread;
+    int index;
+    uint64_t randomState;
+
+    _Atomic long int tasksRun;
+    _Atomic long int steals;
+} WorkWorker;
+
+typedef struct WorkPool
+{
+    WorkWorker *workers;
+    int workerCount;
+    int startedCount;
+
+    pthread_mutex_t injectLock;
+    WorkTask *injectHead;
+    WorkTask *injectTail;
+    _Atomic long int injectCount;
+
+    //  Tasks submitted but not yet finished, and who is waiting for them.
+    _Atomic long int pending;
+    pthread_mutex_t idleLock;
+    pthread_cond_t idle;
+
+    _Atomic bool stopping;
+} WorkPool;
+
+int WorkPoolInit(WorkPool **pool, int workerCount, long int dequeCapacity);
+
+void WorkPoolDestroy(WorkPool *pool);
+
+void WorkPoolSubmit(WorkPool *pool, WorkTask *task);
+
+void WorkPoolWait(WorkPool *pool);
+
+int WorkPoolCurrentWorker(WorkPool *pool);
+
+void PrintWorkPoolReport(WorkPool *pool);
+
+#endif
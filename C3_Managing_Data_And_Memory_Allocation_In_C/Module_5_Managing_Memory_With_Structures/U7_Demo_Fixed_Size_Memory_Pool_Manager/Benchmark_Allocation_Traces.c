@@ -0,0 +1,733 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Memory_Pool_Manager.h"
+#include "Slab_Allocator.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
+
+/*
+    Does the pool really beat malloc? "Memory_Pools_And_Memory_Managers.c"
+    says it should, so here we measure it, replaying the allocation
+    patterns WiredBrain's machines actually produce against glibc's malloc
+    and every flavour of our own allocators:
+
+        -   pour: A machine logs one metric per tick of a pour, then sends
+            (and frees) the whole pour at once. Bursts of POUR_TICKS
+            allocations followed by POUR_TICKS frees.
+
+        -   churn: A long running machine keeps CHURN_LIVE metrics alive
+            and keeps replacing random ones, freeing one and allocating
+            another. The steady state of a busy allocator.
+
+        -   producer-consumer: One thread logs metrics and hands them to a
+            sender thread through a queue, and the sender frees them. Every
+            block is freed on a different thread to the one that allocated
+            it, which is the hardest case for per-thread caches.
+
+    Every row is one trace run against one allocator, printed as CSV so the
+    results can be dropped straight into a spreadsheet:
+
+        -   ns_per_op: Wall time divided by the number of allocs and frees.
+        -   p50_ns / p99_ns: The median and 99th percentile time of a single
+            alloc or free, from a second, timed run of the trace. These
+            include the cost of reading the clock (the same for every
+            allocator), so compare them between rows rather than reading
+            them as absolute numbers.
+        -   peak_rss_kb: The most resident memory the process had at any
+            point whilst setting up the allocator and running the trace.
+        -   minor_faults / major_faults: Page faults taken while setting up
+            the allocator and running the trace.
+
+    Every row runs in a child process of its own, forked from a benchmark
+    that hasn't allocated anything yet. Otherwise the allocators would
+    share one heap, and each would start out with the memory glibc kept
+    from the rows before it, hiding its true footprint and page faults.
+    Peak RSS and page faults are only available on Linux (and -1
+    elsewhere). Without fork, on Windows, the rows all run in the one
+    process.
+
+    The single threaded pool can't be shared, so it sits out the
+    producer-consumer trace, and the batch row (MemPoolAllocBatch and
+    MemPoolFreeBatch) only differs from the locked pool in the pour trace.
+    The arena can't free single blocks, so it isn't in the running at all.
+
+    Pass a scale factor as the first argument to make every trace longer
+    or shorter (defaults to 1).
+*/
+
+#define POUR_TICKS 300
+#define POUR_COUNT 10000L
+#define CHURN_LIVE 100000L
+#define CHURN_STEPS 3000000L
+#define QUEUE_CAPACITY 1024
+#define QUEUE_ITEMS 2000000L
+#define POOL_SLACK 1024
+#define LATENCY_SAMPLES 1000000L
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+typedef enum
+{
+    TRACE_POUR,
+    TRACE_CHURN,
+    TRACE_PRODUCER_CONSUMER
+} TraceKind;
+
+typedef enum
+{
+    ALLOCATOR_MALLOC,
+    ALLOCATOR_POOL,
+    ALLOCATOR_POOL_BATCH,
+    ALLOCATOR_SLAB
+} AllocatorKind;
+
+/*
+    One allocator under test. Pool flavours are described by the parts of
+    MemoryPoolConfig that matter here, and the slab serves every metric
+    from its 32 byte class.
+*/
+typedef struct Allocator
+{
+    const char *name;
+    AllocatorKind kind;
+    MemoryPoolThreading threading;
+    MemoryPoolLayout layout;
+    MemoryPoolBacking backing;
+
+    MemoryPoolManager *pool;
+    SlabAllocator *slab;
+} Allocator;
+
+/*
+    Latency samples for one run. Only every "every"-th operation is timed,
+    so a long trace still fits in the "capacity" samples we have room for.
+*/
+typedef struct LatencySamples
+{
+    double *times;
+    long int capacity;
+    long int count;
+    long int every;
+    long int operation;
+} LatencySamples;
+
+//  The queue between the producer and consumer threads (one of each).
+typedef struct MetricQueue
+{
+    void *slots[QUEUE_CAPACITY];
+    _Atomic long int head;
+    _Atomic long int tail;
+} MetricQueue;
+
+typedef struct ConsumerArgs
+{
+    Allocator *allocator;
+    MetricQueue *queue;
+    long int items;
+    LatencySamples *samples;
+} ConsumerArgs;
+
+/*
+    Kept as a whole number of nanoseconds, as a double can only tell today's
+    times apart to the nearest 256 nanoseconds, longer than most of the
+    operations we are timing.
+*/
+static int64_t NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (int64_t) now.tv_sec * 1000000000 + (int64_t) now.tv_nsec;
+}
+
+//  A tiny xorshift random number generator, so rand() doesn't dominate.
+static uint64_t NextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static const char* TraceName(TraceKind trace)
+{
+    switch (trace)
+    {
+        case TRACE_POUR: return "pour";
+        case TRACE_CHURN: return "churn";
+        case TRACE_PRODUCER_CONSUMER: return "producer-consumer";
+    }
+    return "unknown";
+}
+
+//  The process's peak resident memory in KB, or -1 where we can't find out.
+static long int PeakResidentKilobytes(void)
+{
+#if defined(__linux__)
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        return usage.ru_maxrss;
+    }
+#endif
+    return -1;
+}
+
+//  Page faults taken by the process so far, minor (no disk) and major.
+static void PageFaults(long int *minor, long int *major)
+{
+#if !defined(_WIN32)
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        *minor = usage.ru_minflt;
+        *major = usage.ru_majflt;
+        return;
+    }
+#endif
+    *minor = -1;
+    *major = -1;
+}
+
+/*
+    Sets the allocator up to hold at least "capacity" metrics at once. Pools
+    get POOL_SLACK blocks on top, to cover the blocks that sit in thread
+    caches rather than in the pool's free list.
+*/
+static MemoryPoolStatus AllocatorCreate(Allocator *allocator, long int capacity)
+{
+    allocator -> pool = NULL;
+    allocator -> slab = NULL;
+
+    if (allocator -> kind == ALLOCATOR_MALLOC)
+    {
+        return MEMORY_POOL_OK;
+    }
+
+    if (allocator -> kind == ALLOCATOR_SLAB)
+    {
+        SlabConfig config;
+        SlabDefaultConfig(&config, 0);
+        config.poolConfig.threading = allocator -> threading;
+        config.blockCounts[1] = capacity + POOL_SLACK;
+
+        return SlabInit(&allocator -> slab, &config);
+    }
+
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, sizeof(TestMetrics), capacity + POOL_SLACK);
+    config.threading = allocator -> threading;
+    config.layout = allocator -> layout;
+    config.backing = allocator -> backing;
+
+    return MemPoolInitWithConfig(&allocator -> pool, &config);
+}
+
+static void AllocatorDestroy(Allocator *allocator)
+{
+    if (allocator -> pool != NULL)
+    {
+        MemPoolDestroy(allocator -> pool);
+    }
+
+    if (allocator -> slab != NULL)
+    {
+        SlabDestroy(allocator -> slab);
+    }
+
+    allocator -> pool = NULL;
+    allocator -> slab = NULL;
+}
+
+static void* AllocatorAlloc(Allocator *allocator)
+{
+    void *data = NULL;
+
+    switch (allocator -> kind)
+    {
+        case ALLOCATOR_MALLOC:
+            data = malloc(sizeof(TestMetrics));
+            break;
+
+        case ALLOCATOR_POOL:
+        case ALLOCATOR_POOL_BATCH:
+            MemPoolAllocData(allocator -> pool, &data);
+            break;
+
+        case ALLOCATOR_SLAB:
+            SlabAlloc(allocator -> slab, sizeof(TestMetrics), &data);
+            break;
+    }
+
+    return data;
+}
+
+static void AllocatorFree(Allocator *allocator, void *data)
+{
+    switch (allocator -> kind)
+    {
+        case ALLOCATOR_MALLOC:
+            free(data);
+            break;
+
+        case ALLOCATOR_POOL:
+        case ALLOCATOR_POOL_BATCH:
+            MemPoolFreeData(allocator -> pool, data);
+            break;
+
+        case ALLOCATOR_SLAB:
+            SlabFree(allocator -> slab, data);
+            break;
+    }
+}
+
+//  Starts timing an operation if it is one of the sampled ones.
+static int64_t SampleBegin(LatencySamples *samples)
+{
+    if (samples == NULL || samples -> operation++ % samples -> every != 0 ||
+        samples -> count == samples -> capacity)
+    {
+        return -1;
+    }
+
+    return NowNanoseconds();
+}
+
+//  Records an operation (or "operations" of them done in one call).
+static void SampleEnd(LatencySamples *samples, int64_t begin, long int operations)
+{
+    if (begin < 0)
+    {
+        return;
+    }
+
+    samples -> times[samples -> count++] = (double)(NowNanoseconds() - begin) / operations;
+}
+
+/*
+    Allocates a pour's worth of metrics, fills them in, then frees them all.
+    The batch allocator does each half in a single call, which is timed as
+    one sample of its average cost per block.
+*/
+static long int RunPour(Allocator *allocator, long int pours, LatencySamples *samples)
+{
+    void *metrics[POUR_TICKS];
+
+    for (long int pour = 0; pour < pours; pour++)
+    {
+        if (allocator -> kind == ALLOCATOR_POOL_BATCH)
+        {
+            int64_t begin = SampleBegin(samples);
+            MemPoolAllocBatch(allocator -> pool, POUR_TICKS, metrics);
+            SampleEnd(samples, begin, POUR_TICKS);
+        }
+        else
+        {
+            for (int tick = 0; tick < POUR_TICKS; tick++)
+            {
+                int64_t begin = SampleBegin(samples);
+                metrics[tick] = AllocatorAlloc(allocator);
+                SampleEnd(samples, begin, 1);
+            }
+        }
+
+        for (int tick = 0; tick < POUR_TICKS; tick++)
+        {
+            ((TestMetrics*) metrics[tick]) -> pourDuration = tick;
+        }
+
+        if (allocator -> kind == ALLOCATOR_POOL_BATCH)
+        {
+            int64_t begin = SampleBegin(samples);
+            MemPoolFreeBatch(allocator -> pool, POUR_TICKS, metrics);
+            SampleEnd(samples, begin, POUR_TICKS);
+        }
+        else
+        {
+            for (int tick = 0; tick < POUR_TICKS; tick++)
+            {
+                int64_t begin = SampleBegin(samples);
+                AllocatorFree(allocator, metrics[tick]);
+                SampleEnd(samples, begin, 1);
+            }
+        }
+    }
+
+    return pours * POUR_TICKS * 2;
+}
+
+/*
+    Fills a live set of CHURN_LIVE metrics (untimed), then replaces random
+    members of it "steps" times.
+*/
+static long int RunChurn(Allocator *allocator, long int steps, LatencySamples *samples,
+                         int64_t *begin)
+{
+    void **live = (void**) malloc(sizeof(void*) * CHURN_LIVE);
+    uint64_t state = 88172645463325252ULL;
+
+    if (live == NULL)
+    {
+        return 0;
+    }
+
+    for (long int i = 0; i < CHURN_LIVE; i++)
+    {
+        live[i] = AllocatorAlloc(allocator);
+    }
+
+    *begin = NowNanoseconds();
+
+    for (long int step = 0; step < steps; step++)
+    {
+        long int victim = (long int)(NextRandom(&state) % CHURN_LIVE);
+
+        int64_t start = SampleBegin(samples);
+        AllocatorFree(allocator, live[victim]);
+        SampleEnd(samples, start, 1);
+
+        start = SampleBegin(samples);
+        live[victim] = AllocatorAlloc(allocator);
+        SampleEnd(samples, start, 1);
+
+        ((TestMetrics*) live[victim]) -> pourDuration = (int) step;
+    }
+
+    for (long int i = 0; i < CHURN_LIVE; i++)
+    {
+        AllocatorFree(allocator, live[i]);
+    }
+
+    free(live);
+    return steps * 2;
+}
+
+//  The sender: takes metrics off the queue and frees them.
+static void* Consumer(void *arg)
+{
+    ConsumerArgs *args = (ConsumerArgs*) arg;
+    MetricQueue *queue = args -> queue;
+
+    for (long int item = 0; item < args -> items; item++)
+    {
+        long int head = atomic_load_explicit(&queue -> head, memory_order_relaxed);
+
+        while (atomic_load_explicit(&queue -> tail, memory_order_acquire) == head)
+        {
+            sched_yield();
+        }
+
+        void *metric = queue -> slots[head % QUEUE_CAPACITY];
+        atomic_store_explicit(&queue -> head, head + 1, memory_order_release);
+
+        int64_t begin = SampleBegin(args -> samples);
+        AllocatorFree(args -> allocator, metric);
+        SampleEnd(args -> samples, begin, 1);
+    }
+
+    return NULL;
+}
+
+/*
+    The logger: allocates metrics and queues them for the sender thread,
+    waiting whenever the queue is full. Both threads sample into their own
+    half of the latency samples so they never share a counter.
+*/
+static long int RunProducerConsumer(Allocator *allocator, long int items,
+                                    LatencySamples *samples)
+{
+    MetricQueue *queue = (MetricQueue*) calloc(1, sizeof(MetricQueue));
+    LatencySamples producerSamples;
+    LatencySamples consumerSamples;
+    LatencySamples *producerTarget = NULL;
+    LatencySamples *consumerTarget = NULL;
+
+    if (queue == NULL)
+    {
+        return 0;
+    }
+
+    if (samples != NULL)
+    {
+        producerSamples = *samples;
+        consumerSamples = *samples;
+        producerSamples.capacity = samples -> capacity / 2;
+        consumerSamples.capacity = samples -> capacity / 2;
+        consumerSamples.times = samples -> times + producerSamples.capacity;
+        producerTarget = &producerSamples;
+        consumerTarget = &consumerSamples;
+    }
+
+    ConsumerArgs args = { allocator, queue, items, consumerTarget };
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, Consumer, &args);
+
+    for (long int item = 0; item < items; item++)
+    {
+        int64_t begin = SampleBegin(producerTarget);
+        void *metric = AllocatorAlloc(allocator);
+        SampleEnd(producerTarget, begin, 1);
+
+        //  A thread cached pool can run dry while the consumer's cache
+        //  holds the rest, so wait for it to hand some back.
+        while (metric == NULL)
+        {
+            sched_yield();
+            metric = AllocatorAlloc(allocator);
+        }
+
+        ((TestMetrics*) metric) -> pourDuration = (int) item;
+
+        long int tail = atomic_load_explicit(&queue -> tail, memory_order_relaxed);
+
+        while (tail - atomic_load_explicit(&queue -> head, memory_order_acquire) ==
+               QUEUE_CAPACITY)
+        {
+            sched_yield();
+        }
+
+        queue -> slots[tail % QUEUE_CAPACITY] = metric;
+        atomic_store_explicit(&queue -> tail, tail + 1, memory_order_release);
+    }
+
+    pthread_join(consumer, NULL);
+
+    //  Gather both halves back into "samples".
+    if (samples != NULL)
+    {
+        for (long int i = 0; i < consumerSamples.count; i++)
+        {
+            samples -> times[producerSamples.count + i] = consumerSamples.times[i];
+        }
+
+        samples -> count = producerSamples.count + consumerSamples.count;
+    }
+
+    free(queue);
+    return items * 2;
+}
+
+static long int RunTrace(TraceKind trace, Allocator *allocator, long int scale,
+                         LatencySamples *samples, int64_t *begin)
+{
+    *begin = NowNanoseconds();
+
+    switch (trace)
+    {
+        case TRACE_POUR:
+            return RunPour(allocator, POUR_COUNT * scale, samples);
+
+        case TRACE_CHURN:
+            return RunChurn(allocator, CHURN_STEPS * scale, samples, begin);
+
+        case TRACE_PRODUCER_CONSUMER:
+            return RunProducerConsumer(allocator, QUEUE_ITEMS * scale, samples);
+    }
+
+    return 0;
+}
+
+static long int TraceCapacity(TraceKind trace)
+{
+    switch (trace)
+    {
+        case TRACE_POUR: return POUR_TICKS;
+        case TRACE_CHURN: return CHURN_LIVE;
+        case TRACE_PRODUCER_CONSUMER: return QUEUE_CAPACITY;
+    }
+    return 0;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static double Percentile(LatencySamples *samples, double percentile)
+{
+    if (samples -> count == 0)
+    {
+        return 0;
+    }
+
+    long int index = (long int)(percentile / 100.0 * (double)(samples -> count - 1));
+    return samples -> times[index];
+}
+
+/*
+    Runs one trace against one allocator twice: once flat out for the
+    throughput, RSS and page faults, then again with timing switched on for
+    the latency percentiles. Prints one CSV row. The latency samples are
+    only allocated after the peak RSS has been read, so they don't count
+    towards it.
+*/
+static int BenchmarkTrace(TraceKind trace, Allocator *allocator, long int scale)
+{
+    long int minorBefore, majorBefore, minorAfter, majorAfter;
+    int64_t begin;
+
+    PageFaults(&minorBefore, &majorBefore);
+
+    if (AllocatorCreate(allocator, TraceCapacity(trace)) != MEMORY_POOL_OK)
+    {
+        printf("# Unable To Create The %s Allocator\n", allocator -> name);
+        return 1;
+    }
+
+    long int operations = RunTrace(trace, allocator, scale, NULL, &begin);
+    double elapsed = (double)(NowNanoseconds() - begin);
+
+    PageFaults(&minorAfter, &majorAfter);
+    long int resident = PeakResidentKilobytes();
+    AllocatorDestroy(allocator);
+
+    if (operations == 0)
+    {
+        printf("# Unable To Run The %s Trace\n", TraceName(trace));
+        return 1;
+    }
+
+    double *sampleBuffer = (double*) malloc(sizeof(double) * LATENCY_SAMPLES);
+
+    if (sampleBuffer == NULL)
+    {
+        printf("# Unable To Allocate The Latency Samples\n");
+        return 1;
+    }
+
+    LatencySamples samples;
+    samples.times = sampleBuffer;
+    samples.capacity = LATENCY_SAMPLES;
+    samples.count = 0;
+    samples.operation = 0;
+    samples.every = operations / LATENCY_SAMPLES + 1;
+
+    if (AllocatorCreate(allocator, TraceCapacity(trace)) != MEMORY_POOL_OK)
+    {
+        free(sampleBuffer);
+        return 1;
+    }
+
+    RunTrace(trace, allocator, scale, &samples, &begin);
+    AllocatorDestroy(allocator);
+
+    qsort(samples.times, samples.count, sizeof(double), CompareDoubles);
+
+    printf("%s,%s,%ld,%.2f,%.1f,%.1f,%ld,%ld,%ld\n", TraceName(trace), allocator -> name,
+           operations, elapsed / operations, Percentile(&samples, 50),
+           Percentile(&samples, 99), resident,
+           minorBefore < 0 ? -1 : minorAfter - minorBefore,
+           majorBefore < 0 ? -1 : majorAfter - majorBefore);
+    fflush(stdout);
+    free(sampleBuffer);
+    return 0;
+}
+
+//  Runs BenchmarkTrace in a child process of its own, where there is one.
+static int BenchmarkTraceIsolated(TraceKind trace, Allocator *allocator, long int scale)
+{
+#if !defined(_WIN32)
+    fflush(stdout);
+    pid_t child = fork();
+
+    if (child == 0)
+    {
+        exit(BenchmarkTrace(trace, allocator, scale));
+    }
+
+    int status = 0;
+
+    if (child < 0 || waitpid(child, &status, 0) != child)
+    {
+        printf("# Unable To Run The %s Trace In A Child Process\n", TraceName(trace));
+        return 1;
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+#else
+    return BenchmarkTrace(trace, allocator, scale);
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    long int scale = argc > 1 ? strtol(argv[1], NULL, 10) : 1;
+
+    if (scale < 1)
+    {
+        printf("The Scale Factor Must Be At Least 1\n");
+        return 1;
+    }
+
+    Allocator allocators[] =
+    {
+        { "malloc", ALLOCATOR_MALLOC, MEMORY_POOL_SINGLE_THREADED,
+          MEMORY_POOL_LAYOUT_BLOCK_LIST, MEMORY_POOL_BACKING_HEAP, NULL, NULL },
+        { "pool-single", ALLOCATOR_POOL, MEMORY_POOL_SINGLE_THREADED,
+          MEMORY_POOL_LAYOUT_BLOCK_LIST, MEMORY_POOL_BACKING_HEAP, NULL, NULL },
+        { "pool-locked", ALLOCATOR_POOL, MEMORY_POOL_LOCKED,
+          MEMORY_POOL_LAYOUT_BLOCK_LIST, MEMORY_POOL_BACKING_HEAP, NULL, NULL },
+        { "pool-batch", ALLOCATOR_POOL_BATCH, MEMORY_POOL_LOCKED,
+          MEMORY_POOL_LAYOUT_BLOCK_LIST, MEMORY_POOL_BACKING_HEAP, NULL, NULL },
+        { "pool-cached", ALLOCATOR_POOL, MEMORY_POOL_THREAD_CACHED,
+          MEMORY_POOL_LAYOUT_BLOCK_LIST, MEMORY_POOL_BACKING_HEAP, NULL, NULL },
+        { "pool-lockfree", ALLOCATOR_POOL, MEMORY_POOL_LOCK_FREE,
+          MEMORY_POOL_LAYOUT_BLOCK_LIST, MEMORY_POOL_BACKING_HEAP, NULL, NULL },
+        { "pool-bitmap", ALLOCATOR_POOL, MEMORY_POOL_LOCKED,
+          MEMORY_POOL_LAYOUT_BITMAP, MEMORY_POOL_BACKING_HEAP, NULL, NULL },
+        { "pool-mmap", ALLOCATOR_POOL, MEMORY_POOL_LOCKED,
+          MEMORY_POOL_LAYOUT_BLOCK_LIST, MEMORY_POOL_BACKING_MMAP, NULL, NULL },
+        { "slab", ALLOCATOR_SLAB, MEMORY_POOL_LOCKED,
+          MEMORY_POOL_LAYOUT_BLOCK_LIST, MEMORY_POOL_BACKING_HEAP, NULL, NULL }
+    };
+
+    TraceKind traces[] = { TRACE_POUR, TRACE_CHURN, TRACE_PRODUCER_CONSUMER };
+
+    printf("trace,allocator,ops,ns_per_op,p50_ns,p99_ns,peak_rss_kb,minor_faults,"
+           "major_faults\n");
+
+    for (size_t t = 0; t < sizeof(traces) / sizeof(traces[0]); t++)
+    {
+        for (size_t a = 0; a < sizeof(allocators) / sizeof(allocators[0]); a++)
+        {
+            Allocator *allocator = &allocators[a];
+
+            if ((traces[t] == TRACE_PRODUCER_CONSUMER &&
+                 allocator -> threading == MEMORY_POOL_SINGLE_THREADED &&
+                 allocator -> kind != ALLOCATOR_MALLOC) ||
+                (traces[t] != TRACE_POUR && allocator -> kind == ALLOCATOR_POOL_BATCH))
+            {
+                continue;
+            }
+
+            if (BenchmarkTraceIsolated(traces[t], allocator, scale) != 0)
+            {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    Demonstrates false sharing, and how aligning a pool's blocks fixes it.
+
+    Every thread gets one block from a shared pool holding a single counter,
+    and increments its own counter as fast as it can. No two threads ever
+    touch the same counter, so in theory they shouldn't slow each other
+    down at all.
+
+    But a CPU doesn't move single bytes between cores, it moves whole 64
+    byte cache lines. With packed 8 byte blocks, eight threads' counters sit
+    in the same cache line, and every increment has to drag that line away
+    from whichever core wrote to it last. Giving every block its own cache
+    line (64 byte alignment, or cache-line padding) removes the contention.
+
+    Each row is one pool layout (see "alignment" in MemoryPoolConfig), and
+    shows the average cost of an increment and how many times faster that
+    is than the packed pool. The effect needs at least two cores to show.
+
+    Pass the number of threads as the first argument (defaults to 4).
+*/
+
+#define BENCHMARK_INCREMENTS 50000000L
+#define MAX_THREADS 64
+
+typedef struct CounterArgs
+{
+    volatile long int *counter;
+    long int increments;
+} CounterArgs;
+
+static double NowSeconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void* CounterWorker(void *arg)
+{
+    CounterArgs *args = (CounterArgs*) arg;
+
+    for (long int i = 0; i < args -> increments; i++)
+    {
+        (*args -> counter)++;
+    }
+
+    return NULL;
+}
+
+/*
+    Hands consecutive blocks of one pool to "threads" threads and times how
+    long they all take to finish counting. Returns the nanoseconds taken per
+    increment, or a negative number if the pool couldn't be set up.
+*/
+static double BenchmarkLayout(const char *name, int threads, size_t alignment,
+                              bool cacheLinePadding, double baseline)
+{
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, sizeof(long int), threads);
+    config.threading = MEMORY_POOL_LOCKED;
+    config.alignment = alignment;
+    config.cacheLinePadding = cacheLinePadding;
+
+    MemoryPoolManager *pool = NULL;
+
+    if (MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The %s Pool\n", name);
+        return -1;
+    }
+
+    pthread_t workers[MAX_THREADS];
+    CounterArgs args[MAX_THREADS];
+    long int increments = BENCHMARK_INCREMENTS / threads;
+
+    for (int i = 0; i < threads; i++)
+    {
+        void *counter;
+        MemPoolAllocData(pool, &counter);
+
+        args[i].counter = (volatile long int*) counter;
+        args[i].increments = increments;
+    }
+
+    double begin = NowSeconds();
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_create(&workers[i], NULL, CounterWorker, &args[i]);
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+
+    double nanoseconds = (NowSeconds() - begin) * 1e9 / ((double) increments * threads);
+
+    //  How far apart the first two threads' counters are in memory.
+    long int distance = (long int)((volatile char*) args[threads > 1 ? 1 : 0].counter -
+                                   (volatile char*) args[0].counter);
+
+    printf("%18s %8zu %10ld %14.2f %10.2fx\n", name, pool -> blockStride, distance,
+           nanoseconds, baseline > 0 ? baseline / nanoseconds : 1.0);
+
+    MemPoolDestroy(pool);
+    return nanoseconds;
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = argc > 1 ? (int) strtol(argv[1], NULL, 10) : 4;
+
+    if (threads < 1 || threads > MAX_THREADS)
+    {
+        printf("Thread Count Must Be Between 1 And %d\n", MAX_THREADS);
+        return 1;
+    }
+
+    printf("%d Threads Each Incrementing Their Own Counter\n", threads);
+    printf("%18s %8s %10s %14s %11s\n", "Layout", "Stride", "Distance", "ns/increment",
+           "Speedup");
+
+    double packed = BenchmarkLayout("packed", threads, 0, false, 0);
+
+    if (packed < 0 ||
+        BenchmarkLayout("align 16", threads, 16, false, packed) < 0 ||
+        BenchmarkLayout("align 16 + padding", threads, 16, true, packed) < 0 ||
+        BenchmarkLayout("align 64", threads, 64, false, packed) < 0 ||
+        BenchmarkLayout("align 4096", threads, 4096, false, packed) < 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
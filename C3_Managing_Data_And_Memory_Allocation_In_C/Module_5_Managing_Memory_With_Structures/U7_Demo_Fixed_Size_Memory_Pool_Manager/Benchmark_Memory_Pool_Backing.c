@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    Compares the ways a big pool can be backed (see MemoryPoolBacking).
+
+    A pool of millions of metrics is hundreds of MB of memory. Taking it
+    from the heap means every 4KB page of it is faulted in the first time
+    it's touched, and the CPU's TLB (its cache of page addresses) can only
+    cover a tiny slice of the pool, so random access misses it constantly.
+
+    For each backing we measure:
+
+        -   Init ms: Creating the pool. Prefaulting moves the page faults
+            here, so this goes up.
+
+        -   First Touch ns: Allocating every block and writing to it for the
+            first time. Without prefaulting, this is where the faults land.
+
+        -   Random ns: Writing to blocks picked at random once everything is
+            mapped (the steady state). Huge pages cut the TLB misses here.
+
+        -   Trimmed MB / RSS MB: Freeing every block and calling MemPoolTrim,
+            then checking how much memory the process still holds (Linux
+            only). Heap backed pools can't give anything back.
+
+    Pass the number of blocks as the first argument to change the pool size
+    (defaults to 4,000,000 blocks of 64 bytes, 256MB). Huge pages only make
+    a difference where transparent huge pages are enabled ("madvise" or
+    "always" in /sys/kernel/mm/transparent_hugepage/enabled).
+*/
+
+#define BENCHMARK_BLOCK_SIZE 64
+#define BENCHMARK_RANDOM_WRITES 20000000L
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+static double NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+//  The process's resident memory in MB, or -1 where we can't find out.
+static double ResidentMegabytes(void)
+{
+#if defined(__linux__)
+    FILE *statm = fopen("/proc/self/statm", "r");
+    long int pages = 0;
+    long int resident = 0;
+
+    if (statm == NULL)
+    {
+        return -1;
+    }
+
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+    {
+        resident = -1;
+    }
+
+    fclose(statm);
+    return resident < 0 ? -1 : resident * 4096.0 / (1024 * 1024);
+#else
+    return -1;
+#endif
+}
+
+//  A tiny xorshift random number generator, so rand() doesn't dominate.
+static uint64_t NextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int BenchmarkBacking(const char *name, long int blockCount, MemoryPoolBacking backing,
+                            bool hugePages, bool prefault)
+{
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, BENCHMARK_BLOCK_SIZE, blockCount);
+    config.layout = MEMORY_POOL_LAYOUT_BITMAP;
+    config.backing = backing;
+    config.hugePages = hugePages;
+    config.prefault = prefault;
+
+    MemoryPoolManager *pool = NULL;
+    TestMetrics **metrics = (TestMetrics**) malloc(sizeof(TestMetrics*) * blockCount);
+
+    double begin = NowNanoseconds();
+
+    if (metrics == NULL || MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The %s Pool\n", name);
+        free(metrics);
+        return 1;
+    }
+
+    double created = NowNanoseconds();
+
+    for (long int i = 0; i < blockCount; i++)
+    {
+        MemPoolAllocData(pool, (void**) &metrics[i]);
+        metrics[i] -> pourDuration = (int) i;
+    }
+
+    double touched = NowNanoseconds();
+    uint64_t state = 88172645463325252ULL;
+
+    for (long int i = 0; i < BENCHMARK_RANDOM_WRITES; i++)
+    {
+        metrics[NextRandom(&state) % (uint64_t) blockCount] -> heat += 1.0;
+    }
+
+    double end = NowNanoseconds();
+
+    for (long int i = 0; i < blockCount; i++)
+    {
+        MemPoolFreeData(pool, metrics[i]);
+    }
+
+    size_t released;
+    MemPoolTrim(pool, &released);
+
+    printf("%22s %10.1f %14.2f %10.2f %12.1f %10.1f\n", name, (created - begin) / 1e6,
+           (touched - created) / blockCount, (end - touched) / BENCHMARK_RANDOM_WRITES,
+           released / (1024.0 * 1024.0), ResidentMegabytes());
+
+    MemPoolDestroy(pool);
+    free(metrics);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long int blockCount = argc > 1 ? strtol(argv[1], NULL, 10) : 4000000L;
+
+    printf("%ld Blocks Of %d Bytes\n", blockCount, BENCHMARK_BLOCK_SIZE);
+    printf("%22s %10s %14s %10s %12s %10s\n", "Backing", "Init ms", "First Touch ns",
+           "Random ns", "Trimmed MB", "RSS MB");
+
+    if (BenchmarkBacking("heap", blockCount, MEMORY_POOL_BACKING_HEAP, false, false) != 0 ||
+        BenchmarkBacking("mmap", blockCount, MEMORY_POOL_BACKING_MMAP, false, false) != 0 ||
+        BenchmarkBacking("mmap+prefault", blockCount, MEMORY_POOL_BACKING_MMAP, false,
+                         true) != 0 ||
+        BenchmarkBacking("mmap+huge", blockCount, MEMORY_POOL_BACKING_MMAP, true, false) != 0 ||
+        BenchmarkBacking("mmap+huge+prefault", blockCount, MEMORY_POOL_BACKING_MMAP, true,
+                         true) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    WiredBrain's producers log metrics in bursts of hundreds. Here we
+    compare handling a burst one block at a time (MemPoolAllocData and
+    MemPoolFreeData in a loop) with handling it in a single call
+    (MemPoolAllocBatch and MemPoolFreeBatch), for every threading mode and
+    both layouts.
+
+    Each row shows the average cost per block of allocating a burst, writing
+    to every block with a sequential loop, then freeing the burst, along
+    with how many times faster the batch calls are. The "Runs" column counts
+    how many contiguous runs the last batch came back in (1 means every
+    block sat right after the one before it).
+
+    Pass the burst size as the first argument (defaults to 256).
+*/
+
+#define BENCHMARK_BLOCKS_PER_MODE 20000000L
+#define MAX_BURST 65536
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+static const char *ThreadingName(MemoryPoolThreading threading)
+{
+    switch (threading)
+    {
+        case MEMORY_POOL_SINGLE_THREADED: return "single";
+        case MEMORY_POOL_LOCKED: return "locked";
+        case MEMORY_POOL_THREAD_CACHED: return "cached";
+        case MEMORY_POOL_LOCK_FREE: return "lockfree";
+    }
+    return "unknown";
+}
+
+static double NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+//  Stamps every metric in a burst, the way a producer fills them in.
+static void FillBurst(void **data, long int burst, int round)
+{
+    for (long int i = 0; i < burst; i++)
+    {
+        TestMetrics *metric = (TestMetrics*) data[i];
+        metric -> pourMode = 1;
+        metric -> pourDuration = round;
+    }
+}
+
+//  Counts how many runs of back to back blocks a burst is made of.
+static long int CountRuns(MemoryPoolManager *pool, void **data, long int burst)
+{
+    long int runs = burst > 0 ? 1 : 0;
+
+    for (long int i = 1; i < burst; i++)
+    {
+        if ((char*) data[i] - (char*) data[i - 1] != (long int) pool -> blockStride)
+        {
+            runs++;
+        }
+    }
+
+    return runs;
+}
+
+static int BenchmarkBatch(MemoryPoolThreading threading, MemoryPoolLayout layout,
+                          long int burst)
+{
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, sizeof(TestMetrics), burst);
+    config.threading = threading;
+    config.layout = layout;
+
+    MemoryPoolManager *pool = NULL;
+    void **data = (void**) malloc(sizeof(void*) * burst);
+
+    if (data == NULL || MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The %s Pool\n", ThreadingName(threading));
+        free(data);
+        return 1;
+    }
+
+    long int rounds = BENCHMARK_BLOCKS_PER_MODE / burst;
+    double begin = NowNanoseconds();
+
+    for (long int round = 0; round < rounds; round++)
+    {
+        for (long int i = 0; i < burst; i++)
+        {
+            MemPoolAllocData(pool, &data[i]);
+        }
+
+        FillBurst(data, burst, (int) round);
+
+        //  Freed last first, so the free list stays in address order.
+        for (long int i = burst - 1; i >= 0; i--)
+        {
+            MemPoolFreeData(pool, data[i]);
+        }
+    }
+
+    double middle = NowNanoseconds();
+
+    for (long int round = 0; round < rounds; round++)
+    {
+        if (MemPoolAllocBatch(pool, burst, data) != MEMORY_POOL_OK)
+        {
+            printf("Batch Allocation Failed\n");
+            break;
+        }
+
+        FillBurst(data, burst, (int) round);
+        MemPoolFreeBatch(pool, burst, data);
+    }
+
+    double end = NowNanoseconds();
+
+    MemPoolAllocBatch(pool, burst, data);
+    long int runs = CountRuns(pool, data, burst);
+    MemPoolFreeBatch(pool, burst, data);
+
+    double blocks = (double) rounds * burst;
+    double single = (middle - begin) / blocks;
+    double batch = (end - middle) / blocks;
+
+    printf("%10s %8s %16.2f %16.2f %10.2fx %6ld\n", ThreadingName(threading),
+           layout == MEMORY_POOL_LAYOUT_BITMAP ? "bitmap" : "list", single, batch,
+           single / batch, runs);
+
+    MemPoolDestroy(pool);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long int burst = argc > 1 ? strtol(argv[1], NULL, 10) : 256;
+
+    if (burst < 1 || burst > MAX_BURST)
+    {
+        printf("Burst Size Must Be Between 1 And %d\n", MAX_BURST);
+        return 1;
+    }
+
+    printf("Bursts Of %ld Blocks\n", burst);
+    printf("%10s %8s %16s %16s %11s %6s\n", "Threading", "Layout", "Single ns/block",
+           "Batch ns/block", "Speedup", "Runs");
+
+    if (BenchmarkBatch(MEMORY_POOL_SINGLE_THREADED, MEMORY_POOL_LAYOUT_BLOCK_LIST,
+                       burst) != 0 ||
+        BenchmarkBatch(MEMORY_POOL_LOCKED, MEMORY_POOL_LAYOUT_BLOCK_LIST, burst) != 0 ||
+        BenchmarkBatch(MEMORY_POOL_THREAD_CACHED, MEMORY_POOL_LAYOUT_BLOCK_LIST, burst) != 0 ||
+        BenchmarkBatch(MEMORY_POOL_LOCK_FREE, MEMORY_POOL_LAYOUT_BLOCK_LIST, burst) != 0 ||
+        BenchmarkBatch(MEMORY_POOL_SINGLE_THREADED, MEMORY_POOL_LAYOUT_BITMAP, burst) != 0 ||
+        BenchmarkBatch(MEMORY_POOL_LOCKED, MEMORY_POOL_LAYOUT_BITMAP, burst) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
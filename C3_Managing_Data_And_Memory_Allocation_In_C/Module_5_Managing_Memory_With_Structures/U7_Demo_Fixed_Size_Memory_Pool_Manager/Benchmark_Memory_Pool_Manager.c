@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    A small benchmark to prove the claim made in "Memory_Pool_Manager.h":
+    that allocating and freeing a block from our pool takes the same amount
+    of time no matter how many blocks the pool is managing.
+
+    The original implementation walked the list of blocks on every call to
+    MemPoolAlloc and MemPoolFree, so a pool that was sized for millions of
+    metrics got slower and slower as it filled up. With the free list in
+    place, both calls are a handful of pointer assignments.
+
+    For pool sizes of 10, 100, 1,000 ... 10,000,000 blocks, we:
+
+        -   Allocate every block in the pool (filling it completely).
+        -   Free every block again.
+
+    We repeat this enough times that every pool size performs roughly the
+    same total number of calls, which keeps the timer resolution from
+    swamping the small pools, and then report the average cost of each call
+    in nanoseconds. If the pool is O(1), the numbers should stay flat down
+    the table.
+
+    Afterwards, we compare the two pool layouts (see MemoryPoolLayout) at
+    1,000,000 blocks: how many bytes of bookkeeping each one needs, how
+    quickly each can fill and empty the pool through MemPoolAllocData and
+    MemPoolFreeData, and how long each takes to count its allocated blocks.
+
+    Run with no arguments, or pass the largest pool size to test as the first
+    argument (e.g. "Benchmark_Memory_Pool_Manager 1000000") on machines that
+    can't spare the ~600MB the 10 million block run needs.
+*/
+
+#define BENCHMARK_BLOCK_SIZE 16
+#define BENCHMARK_TARGET_CALLS 20000000L
+#define LAYOUT_BENCHMARK_BLOCKS 1000000L
+#define LAYOUT_BENCHMARK_ROUNDS 10
+
+/*
+    timespec_get is the C11 portable way of reading a high resolution clock
+    and is available both with MSVC and glibc.
+*/
+static double NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/*
+    Fills and empties a pool of LAYOUT_BENCHMARK_BLOCKS blocks with the given
+    layout a few times over, then prints one row of the layout table.
+*/
+static int BenchmarkLayout(MemoryPoolLayout layout, const char *name)
+{
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, BENCHMARK_BLOCK_SIZE, LAYOUT_BENCHMARK_BLOCKS);
+    config.layout = layout;
+
+    MemoryPoolManager *pool = NULL;
+    void **data = (void**) malloc(sizeof(void*) * LAYOUT_BENCHMARK_BLOCKS);
+
+    if (data == NULL || MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create A %s Pool\n", name);
+        free(data);
+        return 1;
+    }
+
+    double allocTime = 0;
+    double freeTime = 0;
+    double countTime = 0;
+    long int counted = 0;
+
+    for (int round = 0; round < LAYOUT_BENCHMARK_ROUNDS; round++)
+    {
+        double begin = NowNanoseconds();
+
+        for (long int i = 0; i < LAYOUT_BENCHMARK_BLOCKS; i++)
+        {
+            MemPoolAllocData(pool, &data[i]);
+        }
+
+        double filled = NowNanoseconds();
+        counted = MemPoolCountAllocated(pool);
+        double middle = NowNanoseconds();
+
+        for (long int i = 0; i < LAYOUT_BENCHMARK_BLOCKS; i++)
+        {
+            MemPoolFreeData(pool, data[i]);
+        }
+
+        double end = NowNanoseconds();
+
+        allocTime += filled - begin;
+        countTime += middle - filled;
+        freeTime += end - middle;
+    }
+
+    double calls = (double) LAYOUT_BENCHMARK_ROUNDS * LAYOUT_BENCHMARK_BLOCKS;
+
+    printf("%12s %14zu %14.2f %14.2f %12.3f %10ld\n", name, MemPoolMetadataSize(pool),
+           allocTime / calls, freeTime / calls, countTime / LAYOUT_BENCHMARK_ROUNDS / 1e6,
+           counted);
+
+    MemPoolDestroy(pool);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    long int maxBlocks = 10000000L;
+
+    if (argc > 1)
+    {
+        maxBlocks = strtol(argv[1], NULL, 10);
+    }
+
+    printf("%12s %8s %14s %14s\n", "Blocks", "Rounds", "Alloc ns/call",
+           "Free ns/call");
+
+    for (long int blockCount = 10; blockCount <= maxBlocks; blockCount *= 10)
+    {
+        MemoryPoolManager *pool = NULL;
+
+        if (MemPoolInit(&pool, BENCHMARK_BLOCK_SIZE, blockCount) != MEMORY_POOL_OK)
+        {
+            printf("Unable To Create A Pool Of %ld Blocks\n", blockCount);
+            return 1;
+        }
+
+        MemoryPoolBlock **blocks = (MemoryPoolBlock**) malloc(sizeof(MemoryPoolBlock*) *
+                                                              blockCount);
+
+        if (blocks == NULL)
+        {
+            printf("Unable To Allocate Benchmark Storage\n");
+            MemPoolDestroy(pool);
+            return 1;
+        }
+
+        long int rounds = BENCHMARK_TARGET_CALLS / blockCount;
+
+        if (rounds < 1)
+        {
+            rounds = 1;
+        }
+
+        double allocTime = 0;
+        double freeTime = 0;
+
+        for (long int round = 0; round < rounds; round++)
+        {
+            double begin = NowNanoseconds();
+
+            for (long int i = 0; i < blockCount; i++)
+            {
+                MemPoolAlloc(pool, &blocks[i]);
+            }
+
+            double middle = NowNanoseconds();
+
+            for (long int i = 0; i < blockCount; i++)
+            {
+                MemPoolFree(pool, blocks[i]);
+            }
+
+            double end = NowNanoseconds();
+
+            allocTime += middle - begin;
+            freeTime += end - middle;
+        }
+
+        double calls = (double)rounds * (double)blockCount;
+
+        printf("%12ld %8ld %14.2f %14.2f\n", blockCount, rounds,
+               allocTime / calls, freeTime / calls);
+
+        free(blocks);
+        MemPoolDestroy(pool);
+    }
+
+    printf("\nLayouts At %ld Blocks\n", LAYOUT_BENCHMARK_BLOCKS);
+    printf("%12s %14s %14s %14s %12s %10s\n", "Layout", "Metadata B", "Alloc ns/call",
+           "Free ns/call", "Count ms", "Counted");
+
+    if (BenchmarkLayout(MEMORY_POOL_LAYOUT_BLOCK_LIST, "block list") != 0 ||
+        BenchmarkLayout(MEMORY_POOL_LAYOUT_BITMAP, "bitmap") != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    Several of WiredBrain's producer threads share a single pool, so here we
+    put the pool's threading modes through their paces.
+
+    First comes a stress run. Every thread repeatedly grabs a handful of
+    blocks, stamps each one with its own thread number and a serial number,
+    and then checks the stamp is still intact just before freeing it. If two
+    threads were ever handed the same block at the same time, one of them
+    would find somebody else's stamp and we report a failure. Once all of
+    the threads have finished (handing their cached blocks back as they
+    exit), the main thread allocates the entire pool to prove that no block
+    was lost or handed out twice along the way.
+
+    Then comes the throughput run, which measures how many allocations per
+    second the pool manages as we add more threads, comparing:
+
+        -   MEMORY_POOL_LOCKED: One global mutex taken on every call.
+        -   MEMORY_POOL_THREAD_CACHED: Per-thread magazines that only visit
+            the shared depot once every "magazineSize" calls.
+        -   MEMORY_POOL_LOCK_FREE: A Treiber stack, one compare-and-swap per
+            call with no locks at all.
+
+    The total amount of work is the same for every thread count (it is
+    split evenly between the threads), so the columns show how well each
+    mode copes as contention rises rather than how much work was done.
+    Compare the columns on the machine you plan to deploy to when choosing
+    between the modes.
+
+    Pass the largest thread count to test as the first argument (defaults
+    to 64).
+*/
+
+#define BENCHMARK_BURST 16
+#define BENCHMARK_TOTAL_BURSTS 400000
+#define STRESS_BURSTS_PER_THREAD 20000
+
+typedef struct BlockStamp
+{
+    int threadNumber;
+    long int serial;
+} BlockStamp;
+
+typedef struct WorkerArgs
+{
+    MemoryPoolManager *pool;
+    int threadNumber;
+    long int bursts;
+    bool checkStamps;
+    long int failures;
+} WorkerArgs;
+
+static const char *ThreadingName(MemoryPoolThreading threading)
+{
+    switch (threading)
+    {
+        case MEMORY_POOL_SINGLE_THREADED: return "single";
+        case MEMORY_POOL_LOCKED: return "locked";
+        case MEMORY_POOL_THREAD_CACHED: return "cached";
+        case MEMORY_POOL_LOCK_FREE: return "lockfree";
+    }
+    return "unknown";
+}
+
+static double NowSeconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/*
+    Each worker allocates a burst of blocks, optionally stamps them, then
+    frees them again, over and over. Failing to get a block isn't an error
+    here (other threads may be holding the rest of the pool), we just carry
+    on with what we got.
+*/
+static void *Worker(void *argsPtr)
+{
+    WorkerArgs *args = (WorkerArgs*) argsPtr;
+    MemoryPoolBlock *burst[BENCHMARK_BURST];
+    long int serial = 0;
+
+    for (long int b = 0; b < args -> bursts; b++)
+    {
+        int taken = 0;
+
+        for (int i = 0; i < BENCHMARK_BURST; i++)
+        {
+            if (MemPoolAlloc(args -> pool, &burst[taken]) == MEMORY_POOL_OK)
+            {
+                if (args -> checkStamps)
+                {
+                    BlockStamp *stamp = burst[taken] -> data;
+                    stamp -> threadNumber = args -> threadNumber;
+                    stamp -> serial = ++serial;
+                }
+                taken++;
+            }
+        }
+
+        for (int i = taken - 1; i >= 0; i--)
+        {
+            if (args -> checkStamps)
+            {
+                BlockStamp *stamp = burst[i] -> data;
+
+                if (stamp -> threadNumber != args -> threadNumber ||
+                    stamp -> serial != serial - (taken - 1 - i))
+                {
+                    args -> failures++;
+                }
+            }
+
+            if (MemPoolFree(args -> pool, burst[i]) != MEMORY_POOL_OK)
+            {
+                args -> failures++;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+    Runs "threadCount" workers against a brand new pool and returns how long
+    they took in seconds. Any stamp or free failures are added to "failures".
+*/
+static double RunWorkers(MemoryPoolThreading threading, int threadCount,
+                         long int blockCount, long int bursts, bool checkStamps,
+                         long int *failures)
+{
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, sizeof(BlockStamp), blockCount);
+    config.threading = threading;
+
+    MemoryPoolManager *pool = NULL;
+
+    if (MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create A %s Pool\n", ThreadingName(threading));
+        exit(1);
+    }
+
+    pthread_t *threads = (pthread_t*) malloc(sizeof(pthread_t) * threadCount);
+    WorkerArgs *args = (WorkerArgs*) calloc(threadCount, sizeof(WorkerArgs));
+
+    if (threads == NULL || args == NULL)
+    {
+        printf("Unable To Allocate Worker Storage\n");
+        exit(1);
+    }
+
+    double begin = NowSeconds();
+
+    for (int t = 0; t < threadCount; t++)
+    {
+        args[t].pool = pool;
+        args[t].threadNumber = t + 1;
+        args[t].bursts = bursts;
+        args[t].checkStamps = checkStamps;
+        pthread_create(&threads[t], NULL, Worker, &args[t]);
+    }
+
+    for (int t = 0; t < threadCount; t++)
+    {
+        pthread_join(threads[t], NULL);
+        *failures += args[t].failures;
+    }
+
+    double elapsed = NowSeconds() - begin;
+
+    /*
+        Every worker has now exited and returned its magazine to the depot,
+        so the whole pool must be available again, and every block we get
+        must be a different one.
+    */
+    if (checkStamps)
+    {
+        long int recovered = 0;
+        bool *seen = (bool*) calloc(blockCount, sizeof(bool));
+        MemoryPoolBlock *block;
+
+        while (seen != NULL && MemPoolAlloc(pool, &block) == MEMORY_POOL_OK)
+        {
+            long int index = block - pool -> head;
+
+            if (seen[index])
+            {
+                (*failures)++;
+            }
+
+            seen[index] = true;
+            recovered++;
+        }
+
+        free(seen);
+
+        if (recovered != blockCount)
+        {
+            printf("Recovered %ld Of %ld Blocks\n", recovered, blockCount);
+            (*failures)++;
+        }
+    }
+
+    free(args);
+    free(threads);
+    MemPoolDestroy(pool);
+
+    return elapsed;
+}
+
+int main(int argc, char *argv[])
+{
+    int maxThreads = 64;
+
+    if (argc > 1)
+    {
+        maxThreads = (int) strtol(argv[1], NULL, 10);
+    }
+
+    MemoryPoolThreading modes[] = { MEMORY_POOL_LOCKED, MEMORY_POOL_THREAD_CACHED,
+                                    MEMORY_POOL_LOCK_FREE };
+    int modeCount = sizeof(modes) / sizeof(modes[0]);
+    long int failures = 0;
+
+    printf("Stress Test\n");
+
+    for (int m = 0; m < modeCount; m++)
+    {
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            /*
+                Deliberately keep the pool small, so blocks are constantly
+                moving between the threads and the depot and any block that
+                gets handed out twice is quickly spotted.
+            */
+            long int blockCount = (long int) threads * BENCHMARK_BURST * 2;
+            long int before = failures;
+
+            RunWorkers(modes[m], threads, blockCount, STRESS_BURSTS_PER_THREAD,
+                       true, &failures);
+
+            printf("%8s %3d threads: %s\n", ThreadingName(modes[m]), threads,
+                   failures == before ? "OK" : "FAILED");
+        }
+    }
+
+    printf("\nThroughput (allocations/sec)\n");
+    printf("%8s", "Threads");
+
+    for (int m = 0; m < modeCount; m++)
+    {
+        printf(" %16s", ThreadingName(modes[m]));
+    }
+
+    printf("\n");
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        long int blockCount = (long int) threads * BENCHMARK_BURST * 8;
+        long int bursts = BENCHMARK_TOTAL_BURSTS / threads;
+        double allocs = (double) threads * bursts * BENCHMARK_BURST;
+
+        printf("%8d", threads);
+
+        for (int m = 0; m < modeCount; m++)
+        {
+            double elapsed = RunWorkers(modes[m], threads, blockCount,
+                                        bursts, false, &failures);
+            printf(" %16.0f", allocs / elapsed);
+        }
+
+        printf("\n");
+    }
+
+    if (failures != 0)
+    {
+        printf("\n%ld Failures Detected!\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
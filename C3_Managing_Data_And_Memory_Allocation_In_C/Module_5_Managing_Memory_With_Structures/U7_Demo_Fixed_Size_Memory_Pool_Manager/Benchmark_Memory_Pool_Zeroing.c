@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    How much does zeroing cost, and who pays for it?
+
+    The demo pool hands out blocks of 2,000,000 TestMetrics (48MB each), and
+    with the eager zeroing policy every free writes all 48MB back to zero,
+    however little of the block was used. Here we measure, for each zeroing
+    policy (see MemoryPoolZeroing) and a range of block sizes:
+
+        -   Free: The cost of freeing a block that the caller only wrote a
+            few bytes into, which is how most WiredBrain metrics blocks are
+            used.
+
+        -   Zeroed Alloc: The cost of MemPoolAllocZeroed handing the same
+            blocks back out again, cleared.
+
+    Eager pays for zeroing on free, lazy and none pay for it on the zeroed
+    alloc instead, and only when somebody actually asks for zeroed memory.
+
+    Each pool holds about BENCHMARK_POOL_BYTES of blocks (and at least two
+    blocks), so the biggest sizes need around 100MB of memory.
+*/
+
+#define BENCHMARK_POOL_BYTES (64L * 1024 * 1024)
+#define BENCHMARK_USED_BYTES 64
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+static double NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+static const char* ZeroingName(MemoryPoolZeroing zeroing)
+{
+    switch (zeroing)
+    {
+        case MEMORY_POOL_ZERO_EAGER: return "eager";
+        case MEMORY_POOL_ZERO_LAZY: return "lazy";
+        case MEMORY_POOL_ZERO_NONE: return "none";
+    }
+
+    return "unknown";
+}
+
+static int BenchmarkZeroing(size_t blockSize, MemoryPoolZeroing zeroing)
+{
+    long int blockCount = BENCHMARK_POOL_BYTES / (long int) blockSize;
+
+    if (blockCount < 2)
+    {
+        blockCount = 2;
+    }
+
+    int rounds = blockCount >= 1000 ? 5 : 20;
+    size_t used = blockSize < BENCHMARK_USED_BYTES ? blockSize : BENCHMARK_USED_BYTES;
+
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, blockSize, blockCount);
+    config.zeroing = zeroing;
+
+    MemoryPoolManager *pool = NULL;
+    void **data = (void**) malloc(sizeof(void*) * blockCount);
+
+    if (data == NULL || MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create A Pool Of %ld Blocks\n", blockCount);
+        free(data);
+        return 1;
+    }
+
+    double freeTime = 0;
+    double zeroedTime = 0;
+
+    for (long int i = 0; i < blockCount; i++)
+    {
+        MemPoolAllocData(pool, &data[i]);
+    }
+
+    for (int round = 0; round < rounds; round++)
+    {
+        for (long int i = 0; i < blockCount; i++)
+        {
+            memset(data[i], 0x5A, used);
+        }
+
+        double begin = NowNanoseconds();
+
+        for (long int i = 0; i < blockCount; i++)
+        {
+            MemPoolFreeData(pool, data[i]);
+        }
+
+        double middle = NowNanoseconds();
+
+        for (long int i = 0; i < blockCount; i++)
+        {
+            MemPoolAllocZeroed(pool, &data[i]);
+        }
+
+        double end = NowNanoseconds();
+
+        freeTime += middle - begin;
+        zeroedTime += end - middle;
+    }
+
+    double calls = (double) rounds * blockCount;
+
+    printf("%12zu %8s %10ld %16.1f %16.1f\n", blockSize, ZeroingName(zeroing), blockCount,
+           freeTime / calls, zeroedTime / calls);
+
+    for (long int i = 0; i < blockCount; i++)
+    {
+        MemPoolFreeData(pool, data[i]);
+    }
+
+    MemPoolDestroy(pool);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t blockSizes[] = { 64, 4096, 1024 * 1024, 2000000 * sizeof(TestMetrics) };
+    MemoryPoolZeroing policies[] = { MEMORY_POOL_ZERO_EAGER, MEMORY_POOL_ZERO_LAZY,
+                                     MEMORY_POOL_ZERO_NONE };
+
+    printf("%12s %8s %10s %16s %16s\n", "Block Size", "Policy", "Blocks", "Free ns/call",
+           "Zeroed ns/call");
+
+    for (size_t i = 0; i < sizeof(blockSizes) / sizeof(blockSizes[0]); i++)
+    {
+        for (size_t j = 0; j < sizeof(policies) / sizeof(policies[0]); j++)
+        {
+            if (BenchmarkZeroing(blockSizes[i], policies[j]) != 0)
+            {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
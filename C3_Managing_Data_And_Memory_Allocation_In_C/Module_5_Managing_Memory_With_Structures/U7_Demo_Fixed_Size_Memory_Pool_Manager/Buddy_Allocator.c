@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "Buddy_Allocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define BUDDY_MIN_BLOCK ((size_t) 1 << BUDDY_MIN_ORDER)
+
+/*
+    The positions of the lowest and highest set bits of a (non-zero) word,
+    which both take a single instruction on modern CPUs.
+*/
+static int BuddyLowestBit(uint64_t word)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (int) index;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+static int BuddyHighestBit(uint64_t word)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return (int) index;
+#else
+    return 63 - __builtin_clzll(word);
+#endif
+}
+
+//  The smallest order whose blocks can hold "size" bytes.
+static int BuddyOrderFor(size_t size)
+{
+    int order = BUDDY_MIN_ORDER;
+
+    while (order < BUDDY_MAX_ORDERS - 1 && ((size_t) 1 << order) < size)
+    {
+        order++;
+    }
+
+    return order;
+}
+
+static bool BuddySlotIsFree(BuddyAllocator *buddy, size_t slot)
+{
+    return (buddy -> freeSlots[slot / 64] >> (slot % 64)) & 1;
+}
+
+/*
+    Puts the block at "offset" on the free list for "order" and records that
+    a free block of that order starts there.
+*/
+static void BuddyPush(BuddyAllocator *buddy, size_t offset, int order)
+{
+    BuddyFreeBlock *block = (BuddyFreeBlock*)((char*) buddy -> start + offset);
+    size_t slot = offset >> BUDDY_MIN_ORDER;
+
+    block -> prev = NULL;
+    block -> next = buddy -> freeLists[order];
+
+    if (block -> next != NULL)
+    {
+        block -> next -> prev = block;
+    }
+
+    buddy -> freeLists[order] = block;
+    buddy -> nonEmpty |= (uint64_t) 1 << order;
+
+    buddy -> orders[slot] = (uint8_t)(order + 1);
+    buddy -> freeSlots[slot / 64] |= (uint64_t) 1 << (slot % 64);
+    buddy -> freeBytes += (size_t) 1 << order;
+}
+
+/*
+    Unlinks a free block from wherever it sits in the free list for "order".
+    The caller decides what the slot's order becomes.
+*/
+static void BuddyRemove(BuddyAllocator *buddy, BuddyFreeBlock *block, int order)
+{
+    size_t slot = (size_t)((char*) block - (char*) buddy -> start) >> BUDDY_MIN_ORDER;
+
+    if (block -> prev != NULL)
+    {
+        block -> prev -> next = block -> next;
+    }
+    else
+    {
+        buddy -> freeLists[order] = block -> next;
+    }
+
+    if (block -> next != NULL)
+    {
+        block -> next -> prev = block -> prev;
+    }
+
+    if (buddy -> freeLists[order] == NULL)
+    {
+        buddy -> nonEmpty &= ~((uint64_t) 1 << order);
+    }
+
+    buddy -> freeSlots[slot / 64] &= ~((uint64_t) 1 << (slot % 64));
+    buddy -> freeBytes -= (size_t) 1 << order;
+}
+
+/*
+    Creates a buddy allocator managing "size" bytes (rounded down to a whole
+    number of BUDDY_MIN_BLOCK slots). The size doesn't have to be a power of
+    two: the region starts out as the biggest power of two block that fits,
+    followed by the biggest that fits in what's left, and so on. Each of
+    those blocks sits at an offset that is a multiple of its own size, so
+    the buddy arithmetic works for all of them, and a block whose buddy
+    would lie past the end of the region simply never merges.
+
+    Just like MemPoolInit, this is the only place we talk to malloc.
+*/
+MemoryPoolStatus BuddyInit(BuddyAllocator **buddy, size_t size)
+{
+    size = size & ~(BUDDY_MIN_BLOCK - 1);
+
+    if (buddy == NULL || size == 0)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    size_t slots = size >> BUDDY_MIN_ORDER;
+
+    *buddy = (BuddyAllocator*) calloc(1, sizeof(BuddyAllocator));
+
+    if (*buddy == NULL)
+    {
+        printf("Unable To Allocate Memory For The Buddy Allocator\n");
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    (*buddy) -> start = malloc(size);
+    (*buddy) -> orders = (uint8_t*) calloc(slots, sizeof(uint8_t));
+    (*buddy) -> freeSlots = (uint64_t*) calloc((slots + 63) / 64, sizeof(uint64_t));
+
+    if ((*buddy) -> start == NULL || (*buddy) -> orders == NULL ||
+        (*buddy) -> freeSlots == NULL)
+    {
+        printf("Unable To Allocate Memory For The Buddy Allocator\n");
+        BuddyDestroy(*buddy);
+        *buddy = NULL;
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    (*buddy) -> size = size;
+
+    size_t offset = 0;
+
+    while (offset < size)
+    {
+        int order = BuddyHighestBit((uint64_t)(size - offset));
+        BuddyPush(*buddy, offset, order);
+        offset += (size_t) 1 << order;
+    }
+
+    return MEMORY_POOL_OK;
+}
+
+MemoryPoolStatus BuddyDestroy(BuddyAllocator *buddy)
+{
+    if (buddy == NULL)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    free(buddy -> start);
+    free(buddy -> orders);
+    free(buddy -> freeSlots);
+    free(buddy);
+
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Allocates a block of at least "size" bytes.
+
+    "nonEmpty" tells us in one step which orders have free blocks, so we
+    mask off the orders that are too small and take the lowest that's left.
+    If that block is bigger than we need, we split it in half, keep the
+    first half and put the second (its buddy) on the free list for the
+    order below, until the block is the right size. That's at most one split
+    per order, O(log n) in the size of the region.
+*/
+MemoryPoolStatus BuddyAlloc(BuddyAllocator *buddy, size_t size, void **data)
+{
+    if (buddy == NULL || data == NULL)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    *data = NULL;
+
+    int order = BuddyOrderFor(size);
+    uint64_t candidates = buddy -> nonEmpty & ~(((uint64_t) 1 << order) - 1);
+
+    if (size == 0 || size > buddy -> size || candidates == 0)
+    {
+        buddy -> failedAllocations++;
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    int current = BuddyLowestBit(candidates);
+    BuddyFreeBlock *block = buddy -> freeLists[current];
+    size_t offset = (size_t)((char*) block - (char*) buddy -> start);
+
+    BuddyRemove(buddy, block, current);
+
+    while (current > order)
+    {
+        current--;
+        BuddyPush(buddy, offset + ((size_t) 1 << current), current);
+    }
+
+    buddy -> orders[offset >> BUDDY_MIN_ORDER] = (uint8_t)(order + 1);
+    buddy -> allocatedBytes += (size_t) 1 << order;
+    buddy -> liveAllocations++;
+
+    if (buddy -> allocatedBytes > buddy -> peakAllocatedBytes)
+    {
+        buddy -> peakAllocatedBytes = buddy -> allocatedBytes;
+    }
+
+    *data = block;
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Frees a block from BuddyAlloc, merging it with its buddy for as long as
+    the buddy is free and whole (the same order, rather than split up with
+    some of its pieces still in use). Each merge doubles the block, so this
+    is O(log n) too.
+
+    Just like MemPoolFree, pointers that aren't the start of one of our
+    blocks are rejected as invalid frees, and blocks that are already free
+    as double frees.
+*/
+MemoryPoolStatus BuddyFree(BuddyAllocator *buddy, void *data)
+{
+    if (buddy == NULL || data == NULL)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    uintptr_t address = (uintptr_t) data;
+    uintptr_t first = (uintptr_t) buddy -> start;
+
+    if (address < first || address - first >= buddy -> size ||
+        (address - first) % BUDDY_MIN_BLOCK != 0)
+    {
+        return MEMORY_POOL_INVALID_FREE_ERROR;
+    }
+
+    size_t offset = (size_t)(address - first);
+    size_t slot = offset >> BUDDY_MIN_ORDER;
+
+    if (buddy -> orders[slot] == 0)
+    {
+        return MEMORY_POOL_INVALID_FREE_ERROR;
+    }
+
+    if (BuddySlotIsFree(buddy, slot))
+    {
+        return MEMORY_POOL_DOUBLE_FREE_ERROR;
+    }
+
+    int order = buddy -> orders[slot] - 1;
+
+    buddy -> allocatedBytes -= (size_t) 1 << order;
+    buddy -> liveAllocations--;
+    buddy -> orders[slot] = 0;
+
+    while (order < BUDDY_MAX_ORDERS - 2)
+    {
+        size_t blockSize = (size_t) 1 << order;
+        size_t buddyOffset = offset ^ blockSize;
+        size_t buddySlot = buddyOffset >> BUDDY_MIN_ORDER;
+
+        if (buddyOffset > buddy -> size - blockSize || !BuddySlotIsFree(buddy, buddySlot) ||
+            buddy -> orders[buddySlot] != order + 1)
+        {
+            break;
+        }
+
+        BuddyRemove(buddy, (BuddyFreeBlock*)((char*) buddy -> start + buddyOffset), order);
+        buddy -> orders[buddySlot] = 0;
+
+        offset &= ~blockSize;
+        order++;
+    }
+
+    BuddyPush(buddy, offset, order);
+    return MEMORY_POOL_OK;
+}
+
+/*
+    The size of the block "data" was given, which can be up to twice what
+    was asked for. Returns 0 if "data" isn't an allocated block.
+*/
+size_t BuddyBlockSize(BuddyAllocator *buddy, void *data)
+{
+    if (buddy == NULL || data == NULL)
+    {
+        return 0;
+    }
+
+    uintptr_t address = (uintptr_t) data;
+    uintptr_t first = (uintptr_t) buddy -> start;
+
+    if (address < first || address - first >= buddy -> size ||
+        (address - first) % BUDDY_MIN_BLOCK != 0)
+    {
+        return 0;
+    }
+
+    size_t slot = (size_t)(address - first) >> BUDDY_MIN_ORDER;
+
+    if (buddy -> orders[slot] == 0 || BuddySlotIsFree(buddy, slot))
+    {
+        return 0;
+    }
+
+    return (size_t) 1 << (buddy -> orders[slot] - 1);
+}
+
+//  The biggest request that could be served right now.
+size_t BuddyLargestFreeBlock(BuddyAllocator *buddy)
+{
+    if (buddy == NULL || buddy -> nonEmpty == 0)
+    {
+        return 0;
+    }
+
+    return (size_t) 1 << BuddyHighestBit(buddy -> nonEmpty);
+}
+
+/*
+    External fragmentation: how much of the free memory is NOT in the
+    largest free block, from 0 (all free memory is one block) towards 1
+    (free memory is scattered in tiny pieces). A high number means there
+    are plenty of free bytes, but a big request will fail anyway.
+*/
+double BuddyExternalFragmentation(BuddyAllocator *buddy)
+{
+    if (buddy == NULL || buddy -> freeBytes == 0)
+    {
+        return 0;
+    }
+
+    return 1.0 - (double) BuddyLargestFreeBlock(buddy) / (double) buddy -> freeBytes;
+}
+
+/*
+    Prints how the region is being used, and a line per order that has
+    free blocks, showing how the free memory is broken up.
+*/
+void PrintBuddyReport(BuddyAllocator *buddy)
+{
+    if (buddy == NULL)
+    {
+        return;
+    }
+
+    printf("Region: %zu KB, Allocated: %zu KB (Peak %zu KB) In %ld Blocks, Free: %zu KB\n",
+           buddy -> size / 1024, buddy -> allocatedBytes / 1024,
+           buddy -> peakAllocatedBytes / 1024, buddy -> liveAllocations,
+           buddy -> freeBytes / 1024);
+    printf("Largest Free Block: %zu KB, External Fragmentation: %.1f%%\n",
+           BuddyLargestFreeBlock(buddy) / 1024, 100.0 * BuddyExternalFragmentation(buddy));
+
+    printf("%6s %12s %12s\n", "Order", "Block Size", "Free Blocks");
+
+    for (int order = BUDDY_MIN_ORDER; order < BUDDY_MAX_ORDERS; order++)
+    {
+        long int count = 0;
+
+        for (BuddyFreeBlock *block = buddy -> freeLists[order]; block != NULL;
+             block = block -> next)
+        {
+            count++;
+        }
+
+        if (count > 0)
+        {
+            printf("%6d %12zu %12ld\n", order, (size_t) 1 << order, count);
+        }
+    }
+}
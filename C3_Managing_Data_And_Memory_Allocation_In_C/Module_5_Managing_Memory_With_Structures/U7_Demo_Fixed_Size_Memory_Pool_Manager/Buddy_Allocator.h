@@ -0,0 +1,110 @@
+/*
+    A fixed-size pool is ideal when every request is the same size, and the
+    slab copes with a handful of small sizes. But WiredBrain's metric arrays
+    are sized by how long a pour lasts, anything from a few hundred bytes to
+    a few megabytes. Give each of those a pool block big enough for the
+    longest pour and almost all of the memory goes to waste.
+
+    A "buddy" allocator manages one big region of memory by splitting it in
+    halves, and halves of halves, until it has a block just big enough for
+    the request. Every block is a power of two in size (its "order" is that
+    power, so an order 10 block is 1024 bytes), and every block has exactly
+    one "buddy": the other half of the block it was split from. A block's
+    buddy is found by flipping a single bit of its offset from the start of
+    the region, so no searching is needed:
+
+        buddy offset = offset ^ (1 << order)
+
+    Allocating rounds the request up to a power of two and takes a free
+    block of that order. If there isn't one, a bigger block is split in two
+    (over and over if need be), one half is used and the other is put on the
+    free list for its order. Freeing does the opposite: while the block's
+    buddy is also free, the two are merged back into the block they came
+    from ("coalescing"). There are at most log2(size) orders, so both take
+    O(log n) time.
+
+    The price is internal fragmentation: a request is rounded up to a power
+    of two, so a 1100 byte request takes a 2048 byte block. In return,
+    coalescing keeps external fragmentation (free memory broken into pieces
+    too small to use) in check, as neighbouring free blocks always merge
+    back together.
+
+    Like the arena, a buddy allocator isn't thread safe. Give each thread its
+    own, or guard it with a lock.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Memory_Pool_Manager.h"
+
+#ifndef BUDDY_ALLOCATOR_H
+#define BUDDY_ALLOCATOR_H
+
+//  The smallest block is 16 bytes, enough for a free block's list links.
+#define BUDDY_MIN_ORDER 4
+#define BUDDY_MAX_ORDERS 64
+
+/*
+    The free lists are threaded through the free blocks themselves. They
+    are doubly linked, so that when a block's buddy is found to be free it
+    can be unlinked from the middle of its list without a search.
+*/
+typedef struct BuddyFreeBlock
+{
+    struct BuddyFreeBlock *next;
+    struct BuddyFreeBlock *prev;
+} BuddyFreeBlock;
+
+/*
+    "start" and "size" describe the region we manage. There is one free list
+    per order, and "nonEmpty" has bit "i" set whenever the list for order
+    "i" has a block on it, so finding the smallest order that can serve a
+    request is a single count of trailing zeros.
+
+    The bookkeeping for each BUDDY_MIN_ORDER sized slot of the region lives
+    outside the region, so blocks are exactly a power of two in size:
+
+        -   orders: The order (plus one) of the block starting at this slot,
+            or 0 if no block starts here.
+
+        -   freeSlots: A bit per slot, set if the block starting here is
+            free. Together with "orders", this tells us whether a buddy is
+            free and whole (not split) in O(1).
+
+    "freeBytes" and "allocatedBytes" always add up to "size".
+*/
+typedef struct BuddyAllocator
+{
+    void *start;
+    size_t size;
+
+    BuddyFreeBlock *freeLists[BUDDY_MAX_ORDERS];
+    uint64_t nonEmpty;
+
+    uint8_t *orders;
+    uint64_t *freeSlots;
+
+    size_t freeBytes;
+    size_t allocatedBytes;
+    size_t peakAllocatedBytes;
+    long int liveAllocations;
+    long int failedAllocations;
+} BuddyAllocator;
+
+MemoryPoolStatus BuddyInit(BuddyAllocator **buddy, size_t size);
+
+MemoryPoolStatus BuddyDestroy(BuddyAllocator *buddy);
+
+MemoryPoolStatus BuddyAlloc(BuddyAllocator *buddy, size_t size, void **data);
+
+MemoryPoolStatus BuddyFree(BuddyAllocator *buddy, void *data);
+
+size_t BuddyBlockSize(BuddyAllocator *buddy, void *data);
+
+size_t BuddyLargestFreeBlock(BuddyAllocator *buddy);
+
+double BuddyExternalFragmentation(BuddyAllocator *buddy);
+
+void PrintBuddyReport(BuddyAllocator *buddy);
+
+#endif
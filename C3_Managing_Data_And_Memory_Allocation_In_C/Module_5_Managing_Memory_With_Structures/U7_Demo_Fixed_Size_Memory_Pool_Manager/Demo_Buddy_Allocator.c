@@ -0,0 +1,256 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "Buddy_Allocator.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAVE_MALLINFO2 1
+#endif
+
+/*
+    Every pour gets an array of metrics, one per tick, so the arrays range
+    from a few hundred bytes (a quick rinse) to a few megabytes (a long
+    batch brew). Here we keep DEMO_LIVE_POURS of those arrays alive,
+    replacing a random one at a time, and run the very same sequence of
+    requests through the buddy allocator and through malloc.
+
+    For each we report:
+
+        -   ns/op: The average cost of one allocation plus one free.
+
+        -   Requested: The bytes the live arrays actually asked for.
+
+        -   Held: The bytes set aside for the live arrays. For the buddy
+            allocator that's the power of two blocks, for malloc the chunks
+            in use (including their headers).
+
+        -   Internal: How much of "Held" is rounding and headers.
+
+        -   Free: Free memory the allocator is holding on to.
+
+        -   External: How much of "Free" is NOT in the largest free block,
+            the fragmentation that makes a big request fail although there
+            are enough free bytes. The buddy allocator knows this exactly.
+            malloc doesn't expose its free lists, so we use the share of its
+            free memory that isn't at the top of the heap (and so sits in
+            holes between chunks still in use), from mallinfo2. glibc gives
+            requests of 128KB or more their own mappings, which never
+            fragment the heap.
+
+    Pass a number of replacements as the first argument to change how long
+    the demo runs (defaults to DEMO_REPLACEMENTS).
+*/
+
+#define DEMO_LIVE_POURS 64
+#define DEMO_REPLACEMENTS 200000L
+#define DEMO_REGION_SIZE ((size_t) 256 << 20)
+#define DEMO_MIN_TICKS 10
+#define DEMO_MAX_TICKS 100000
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+typedef struct DemoResult
+{
+    double nsPerOp;
+    long int failed;
+    size_t requested;
+    size_t held;
+    size_t free;
+    double external;
+} DemoResult;
+
+static int64_t NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+//  A small xorshift generator, so both runs see exactly the same pours.
+static uint64_t NextRandom(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/*
+    Pour durations are spread evenly on a log scale, so short pours are
+    common and long ones rare, but there are as many 1000-10000 tick pours
+    as 100-1000 tick ones.
+*/
+static size_t NextPourSize(uint64_t *state)
+{
+    double spread = (double)(NextRandom(state) >> 11) / (double)(UINT64_C(1) << 53);
+    double ticks = DEMO_MIN_TICKS;
+
+    for (double limit = spread * 4; limit > 0; limit -= 1)
+    {
+        ticks *= limit >= 1 ? 10 : 1 + 9 * limit;
+    }
+
+    return (size_t) ticks * sizeof(TestMetrics);
+}
+
+//  Writes the first and last metric of a pour, as a real pour would.
+static void FillPour(void *data, size_t size)
+{
+    TestMetrics *metrics = (TestMetrics*) data;
+    size_t count = size / sizeof(TestMetrics);
+
+    metrics[0].pourDuration = (int) count;
+    metrics[count - 1].pourDuration = (int) count;
+}
+
+static void RunBuddy(long int replacements, DemoResult *result)
+{
+    BuddyAllocator *buddy = NULL;
+
+    if (BuddyInit(&buddy, DEMO_REGION_SIZE) != MEMORY_POOL_OK)
+    {
+        return;
+    }
+
+    void *pours[DEMO_LIVE_POURS] = { NULL };
+    size_t sizes[DEMO_LIVE_POURS] = { 0 };
+    uint64_t state = 0x9E3779B97F4A7C15;
+
+    int64_t begin = NowNanoseconds();
+
+    for (long int i = 0; i < replacements; i++)
+    {
+        int victim = (int)(NextRandom(&state) % DEMO_LIVE_POURS);
+        size_t size = NextPourSize(&state);
+
+        if (pours[victim] != NULL)
+        {
+            BuddyFree(buddy, pours[victim]);
+            pours[victim] = NULL;
+            sizes[victim] = 0;
+        }
+
+        if (BuddyAlloc(buddy, size, &pours[victim]) == MEMORY_POOL_OK)
+        {
+            FillPour(pours[victim], size);
+            sizes[victim] = size;
+        }
+    }
+
+    result -> nsPerOp = (double)(NowNanoseconds() - begin) / (double) replacements;
+    result -> failed = buddy -> failedAllocations;
+
+    for (int i = 0; i < DEMO_LIVE_POURS; i++)
+    {
+        result -> requested += sizes[i];
+    }
+
+    result -> held = buddy -> allocatedBytes;
+    result -> free = buddy -> freeBytes;
+    result -> external = BuddyExternalFragmentation(buddy);
+
+    printf("\nBuddy Allocator After %ld Replacements\n", replacements);
+    PrintBuddyReport(buddy);
+    printf("\n");
+
+    BuddyDestroy(buddy);
+}
+
+static void RunMalloc(long int replacements, DemoResult *result)
+{
+    void *pours[DEMO_LIVE_POURS] = { NULL };
+    size_t sizes[DEMO_LIVE_POURS] = { 0 };
+    uint64_t state = 0x9E3779B97F4A7C15;
+
+    int64_t begin = NowNanoseconds();
+
+    for (long int i = 0; i < replacements; i++)
+    {
+        int victim = (int)(NextRandom(&state) % DEMO_LIVE_POURS);
+        size_t size = NextPourSize(&state);
+
+        free(pours[victim]);
+        pours[victim] = malloc(size);
+        sizes[victim] = 0;
+
+        if (pours[victim] != NULL)
+        {
+            FillPour(pours[victim], size);
+            sizes[victim] = size;
+        }
+        else
+        {
+            result -> failed++;
+        }
+    }
+
+    result -> nsPerOp = (double)(NowNanoseconds() - begin) / (double) replacements;
+
+    for (int i = 0; i < DEMO_LIVE_POURS; i++)
+    {
+        result -> requested += sizes[i];
+    }
+
+#ifdef HAVE_MALLINFO2
+    struct mallinfo2 info = mallinfo2();
+
+    result -> held = info.uordblks + info.hblkhd;
+    result -> free = info.fordblks;
+    result -> external = info.fordblks > 0 ?
+                         1.0 - (double) info.keepcost / (double) info.fordblks : 0;
+#endif
+
+    for (int i = 0; i < DEMO_LIVE_POURS; i++)
+    {
+        free(pours[i]);
+    }
+}
+
+static void PrintResult(const char *name, DemoResult *result)
+{
+    double internal = result -> held > 0 ?
+                      1.0 - (double) result -> requested / (double) result -> held : 0;
+
+    printf("%8s %8.1f %7ld %13zu %10zu %9.1f%% %10zu %9.1f%%\n", name, result -> nsPerOp,
+           result -> failed, result -> requested / 1024, result -> held / 1024,
+           100.0 * internal, result -> free / 1024, 100.0 * result -> external);
+}
+
+int main(int argc, char *argv[])
+{
+    long int replacements = argc > 1 ? strtol(argv[1], NULL, 10) : DEMO_REPLACEMENTS;
+
+    if (replacements < 1)
+    {
+        printf("The Number Of Replacements Must Be At Least 1\n");
+        return 1;
+    }
+
+    DemoResult buddy = { 0 };
+    DemoResult system = { 0 };
+
+    RunBuddy(replacements, &buddy);
+    RunMalloc(replacements, &system);
+
+    printf("%d Live Pours Of %zu To %zu Bytes\n", DEMO_LIVE_POURS,
+           DEMO_MIN_TICKS * sizeof(TestMetrics), DEMO_MAX_TICKS * sizeof(TestMetrics));
+    printf("%8s %8s %7s %13s %10s %10s %10s %10s\n", "", "ns/op", "Failed", "Requested KB",
+           "Held KB", "Internal", "Free KB", "External");
+
+    PrintResult("buddy", &buddy);
+    PrintResult("malloc", &system);
+
+#ifndef HAVE_MALLINFO2
+    printf("(malloc's held and free memory need glibc 2.33 or later)\n");
+#endif
+
+    return 0;
+}
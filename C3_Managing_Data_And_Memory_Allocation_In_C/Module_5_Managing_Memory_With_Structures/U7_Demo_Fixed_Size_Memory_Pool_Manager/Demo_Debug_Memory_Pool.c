@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    Memory bugs rarely crash where they happen. Writing one element past the
+    end of a block quietly tramples whatever sits next to it, and freeing a
+    block twice hands the same memory out to two callers later on. By the
+    time anything goes visibly wrong, the code that caused it is long gone.
+
+    Building with MEM_POOL_DEBUG defined turns on the pool's debug mode (see
+    Memory_Pool_Manager.h), which catches these bugs at the point the block
+    is handed back. Here we commit each bug on purpose and print the status
+    the pool reports for it:
+
+        gcc -DMEM_POOL_DEBUG Demo_Debug_Memory_Pool.c Memory_Pool_Manager.c
+
+    Without MEM_POOL_DEBUG the double and invalid frees are still rejected,
+    but the pool has no guard bytes to catch the overrun with, so we skip
+    that part rather than trampling the next block for real.
+*/
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+static const char* StatusName(MemoryPoolStatus status)
+{
+    switch (status)
+    {
+        case MEMORY_POOL_OK: return "OK";
+        case MEMORY_POOL_DOUBLE_FREE_ERROR: return "Double Free Error";
+        case MEMORY_POOL_INVALID_FREE_ERROR: return "Invalid Free Error";
+        case MEMORY_POOL_CORRUPTION_ERROR: return "Corruption Error";
+        default: return "Error";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    MemoryPoolManager *pool = NULL;
+
+    //  Room for exactly one TestMetrics per block.
+    if (MemPoolInit(&pool, sizeof(TestMetrics), 4) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The Pool\n");
+        return 1;
+    }
+
+    MemoryPoolBlock *block;
+    MemPoolAlloc(pool, &block);
+
+#ifdef MEM_POOL_DEBUG
+    //  Writes a second TestMetrics into a block only big enough for one.
+    TestMetrics *metrics = (TestMetrics*) block -> data;
+    TestMetrics metricOne = { 200, 300, 2.3, 23.4345 };
+
+    metrics[0] = metricOne;
+    ((char*) &metrics[1])[0] = 1;
+
+    printf("Overrun Free: %s\n", StatusName(MemPoolFree(pool, block)));
+#else
+    printf("Build With MEM_POOL_DEBUG To Catch Overruns\n");
+    MemPoolFree(pool, block);
+#endif
+
+    printf("Double Free: %s\n", StatusName(MemPoolFree(pool, block)));
+
+    TestMetrics notFromThePool;
+    printf("Invalid Free: %s\n", StatusName(MemPoolFreeData(pool, &notFromThePool)));
+
+#ifdef MEM_POOL_DEBUG
+    //  Keeps using the block after handing it back. Spotted on the next alloc.
+    MemoryPoolBlock *stale = block;
+    ((TestMetrics*) stale -> data) -> heat = 99.0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        MemPoolAlloc(pool, &block);
+    }
+#endif
+
+    MemPoolDestroy(pool);
+    pool = NULL;
+
+    return 0;
+}
@@ -69,6 +69,13 @@ int main (int argc, char* argv[])
     printf("Blocks After 1st Free\n");
     PrintMemBlocks(myMemPool);
 
+    /*
+        Build with MEM_POOL_ENABLE_STATS defined to see what the pool has been
+        up to. Without it, only the pool's size is filled in.
+    */
+    printf("\nPool Statistics:\n");
+    MemPoolDumpStats(myMemPool, stdout);
+
     MemPoolDestroy(myMemPool);
     myMemPool = NULL;
 
@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "Memory_Arena.h"
+
+/*
+    Every pour on a WiredBrain machine creates a metric for each tick of the
+    pour, and every one of those metrics is thrown away together once the
+    pour is over. That makes a pour the perfect lifetime for an arena.
+
+    Here we simulate a batch of pours twice:
+
+        -   Once calling malloc for every metric and free for every metric
+            at the end of the pour.
+
+        -   Once bumping every metric out of an arena and calling ArenaReset
+            at the end of the pour.
+
+    Each tick also needs a little scratch memory that is only used for that
+    tick. We use ArenaSave/ArenaRestore to give it its own nested scope, so
+    the scratch space is reused tick after tick rather than piling up until
+    the end of the pour.
+
+    Pass the number of pours and the pour duration as arguments to change
+    the workload (defaults to 200 pours of 10,000 ticks).
+*/
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+#define SCRATCH_BYTES 64
+
+static double NowSeconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    int pours = argc > 1 ? (int) strtol(argv[1], NULL, 10) : 200;
+    int duration = argc > 2 ? (int) strtol(argv[2], NULL, 10) : 10000;
+
+    TestMetrics **metrics = (TestMetrics**) malloc(sizeof(TestMetrics*) * duration);
+    MemoryArena *arena = NULL;
+
+    if (metrics == NULL ||
+        ArenaInit(&arena, sizeof(TestMetrics) * duration + SCRATCH_BYTES * 2) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Allocate Memory For The Demo\n");
+        free(metrics);
+        return 1;
+    }
+
+    double checksum = 0;
+
+    //  The malloc version: one malloc and one free per metric.
+    double begin = NowSeconds();
+
+    for (int pour = 0; pour < pours; pour++)
+    {
+        for (int tick = 0; tick < duration; tick++)
+        {
+            char *scratch = (char*) malloc(SCRATCH_BYTES);
+            scratch[0] = (char) tick;
+
+            metrics[tick] = (TestMetrics*) malloc(sizeof(TestMetrics));
+            metrics[tick] -> pourMode = pour % 3;
+            metrics[tick] -> heat = 90.0 + scratch[0] % 5;
+
+            free(scratch);
+        }
+
+        for (int tick = 0; tick < duration; tick++)
+        {
+            checksum += metrics[tick] -> heat;
+            free(metrics[tick]);
+        }
+    }
+
+    double mallocTime = NowSeconds() - begin;
+
+    //  The arena version: bump every allocation, then reset once per pour.
+    begin = NowSeconds();
+
+    for (int pour = 0; pour < pours; pour++)
+    {
+        for (int tick = 0; tick < duration; tick++)
+        {
+            MemoryArenaMarker tickScope = ArenaSave(arena);
+
+            void *scratchData = NULL;
+            void *metricData = NULL;
+
+            if (ArenaAlloc(arena, SCRATCH_BYTES, 1, &scratchData) != MEMORY_POOL_OK)
+            {
+                printf("The Arena Ran Out Of Scratch Space\n");
+                ArenaDestroy(arena);
+                free(metrics);
+                return 1;
+            }
+
+            char *scratch = (char*) scratchData;
+            scratch[0] = (char) tick;
+
+            int pourMode = pour % 3;
+            double heat = 90.0 + scratch[0] % 5;
+
+            //  Throw away the scratch space before the metric is allocated
+            //  so the metric doesn't get stuck behind it.
+            ArenaRestore(arena, tickScope);
+
+            if (ArenaAlloc(arena, sizeof(TestMetrics), _Alignof(TestMetrics),
+                           &metricData) != MEMORY_POOL_OK)
+            {
+                printf("The Arena Ran Out Of Room For Metrics\n");
+                ArenaDestroy(arena);
+                free(metrics);
+                return 1;
+            }
+
+            metrics[tick] = (TestMetrics*) metricData;
+            metrics[tick] -> pourMode = pourMode;
+            metrics[tick] -> heat = heat;
+        }
+
+        for (int tick = 0; tick < duration; tick++)
+        {
+            checksum -= metrics[tick] -> heat;
+            ArenaFree(arena, metrics[tick]);
+        }
+
+        ArenaReset(arena);
+    }
+
+    double arenaTime = NowSeconds() - begin;
+    double allocations = (double) pours * duration * 2;
+
+    printf("%d Pours Of %d Ticks (Checksum %.1f)\n", pours, duration, checksum);
+    printf("malloc/free: %8.2f ns per allocation\n", mallocTime * 1e9 / allocations);
+    printf("arena:       %8.2f ns per allocation\n", arenaTime * 1e9 / allocations);
+    printf("Arena Peak Usage: %zu of %zu bytes\n", arena -> peakOffset, arena -> size);
+
+    ArenaDestroy(arena);
+    free(metrics);
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    Handles versus pointers.
+
+    A WiredBrain machine keeps a list of the metrics it has logged during a
+    pour. Storing them as MemoryPoolHandles rather than pointers halves the
+    size of the list, and protects us from the classic dangling pointer bug:
+    holding on to a metric after it has been freed, then reading (or worse,
+    writing) whatever the pool has since put in its place.
+
+    Here we:
+
+        -   Log a pour's worth of metrics, keeping only their handles.
+        -   Send (and free) one of them, but forget to drop its handle.
+        -   Log another metric, which reuses the freed block.
+        -   Try to use the stale handle, which is caught rather than
+            quietly handing us the new metric.
+*/
+
+#define POUR_DURATION 8
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+int main(int argc, char *argv[])
+{
+    MemoryPoolManager *pool = NULL;
+
+    if (MemPoolInit(&pool, sizeof(TestMetrics), POUR_DURATION) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The Pool\n");
+        return 1;
+    }
+
+    MemoryPoolHandle metrics[POUR_DURATION];
+
+    for (int tick = 0; tick < POUR_DURATION; tick++)
+    {
+        MemPoolAllocHandle(pool, &metrics[tick]);
+
+        TestMetrics *metric = (TestMetrics*) MemPoolResolve(pool, metrics[tick]);
+        metric -> pourMode = 1;
+        metric -> pourDuration = tick;
+        metric -> heat = 90.0 + tick;
+    }
+
+    printf("A List Of %d Pointers Takes %zu Bytes, %d Handles Take %zu Bytes\n",
+           POUR_DURATION, sizeof(TestMetrics*) * POUR_DURATION, POUR_DURATION,
+           sizeof(metrics));
+
+    //  Send the third metric, but keep its (now stale) handle around.
+    MemoryPoolHandle stale = metrics[2];
+    MemPoolFreeHandle(pool, metrics[2]);
+
+    //  The next metric reuses the block the third metric lived in.
+    MemPoolAllocHandle(pool, &metrics[2]);
+    ((TestMetrics*) MemPoolResolve(pool, metrics[2])) -> heat = 42.0;
+
+    printf("Stale Handle %08x Resolves To %p\n", stale, MemPoolResolve(pool, stale));
+    printf("New Handle   %08x Resolves To %p (Heat %.1f)\n", metrics[2],
+           MemPoolResolve(pool, metrics[2]),
+           ((TestMetrics*) MemPoolResolve(pool, metrics[2])) -> heat);
+
+    if (MemPoolFreeHandle(pool, stale) == MEMORY_POOL_DOUBLE_FREE_ERROR)
+    {
+        printf("Freeing The Stale Handle Was Rejected As A Double Free\n");
+    }
+
+    for (int tick = 0; tick < POUR_DURATION; tick++)
+    {
+        MemPoolFreeHandle(pool, metrics[tick]);
+    }
+
+    MemPoolDestroy(pool);
+    pool = NULL;
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    Warm restarts.
+
+    When a WiredBrain machine's process restarts, it rebuilds its metrics
+    one allocation at a time. Here we:
+
+        -   Rebuild a pool of DEMO_METRICS metrics the slow way, allocating
+            and filling in each one, and free every fourth one again.
+        -   Save the pool to an image with MemPoolSave.
+        -   Load it back with MemPoolLoad, which maps the image's data
+            rather than rebuilding anything.
+        -   Check a handle taken before saving still finds its metric.
+
+    for both layouts. The image is written to the path given as the first
+    argument (defaults to "Memory_Pool.img"), and deleted at the end.
+*/
+
+#define DEMO_METRICS 1000000L
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+static int64_t NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static double Milliseconds(int64_t begin, int64_t end)
+{
+    return (double)(end - begin) / 1e6;
+}
+
+static int DemoImage(MemoryPoolLayout layout, const char *path)
+{
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, sizeof(TestMetrics), DEMO_METRICS);
+    config.layout = layout;
+
+    MemoryPoolManager *pool = NULL;
+    MemoryPoolHandle kept = MEM_POOL_NULL_HANDLE;
+
+    int64_t begin = NowNanoseconds();
+
+    if (MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The Pool\n");
+        return 1;
+    }
+
+    for (long int i = 0; i < DEMO_METRICS; i++)
+    {
+        MemoryPoolHandle handle;
+        MemPoolAllocHandle(pool, &handle);
+
+        TestMetrics *metric = (TestMetrics*) MemPoolResolve(pool, handle);
+        metric -> pourMode = 1;
+        metric -> pourDuration = (int) i;
+        metric -> heat = 90.0;
+
+        if (i % 4 == 0)
+        {
+            MemPoolFreeHandle(pool, handle);
+        }
+        else if (i == DEMO_METRICS / 2 + 1)
+        {
+            kept = handle;
+        }
+    }
+
+    int64_t rebuilt = NowNanoseconds();
+
+    if (MemPoolSave(pool, path) != MEMORY_POOL_OK)
+    {
+        MemPoolDestroy(pool);
+        return 1;
+    }
+
+    int64_t saved = NowNanoseconds();
+
+    MemoryPoolManager *loaded = NULL;
+
+    if (MemPoolLoad(&loaded, path) != MEMORY_POOL_OK)
+    {
+        MemPoolDestroy(pool);
+        return 1;
+    }
+
+    int64_t restarted = NowNanoseconds();
+
+    TestMetrics *metric = (TestMetrics*) MemPoolResolve(loaded, kept);
+
+    printf("%8s %12.1f %12.1f %12.1f %12ld %14d\n",
+           layout == MEMORY_POOL_LAYOUT_BITMAP ? "bitmap" : "list",
+           Milliseconds(begin, rebuilt), Milliseconds(rebuilt, saved),
+           Milliseconds(saved, restarted), MemPoolCountAllocated(loaded),
+           metric != NULL ? metric -> pourDuration : -1);
+
+    MemPoolDestroy(loaded);
+    MemPoolDestroy(pool);
+    remove(path);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = argc > 1 ? argv[1] : "Memory_Pool.img";
+
+    printf("%ld Metrics, Every Fourth One Freed\n", DEMO_METRICS);
+    printf("%8s %12s %12s %12s %12s %14s\n", "Layout", "Rebuild ms", "Save ms", "Load ms",
+           "Allocated", "Kept Metric");
+
+    if (DemoImage(MEMORY_POOL_LAYOUT_BLOCK_LIST, path) != 0 ||
+        DemoImage(MEMORY_POOL_LAYOUT_BITMAP, path) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
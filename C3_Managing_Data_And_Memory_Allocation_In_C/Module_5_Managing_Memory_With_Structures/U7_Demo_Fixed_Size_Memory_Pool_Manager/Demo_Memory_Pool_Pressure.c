@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "Memory_Pool_Manager.h"
+
+/*
+    Backpressure with watermarks.
+
+    A WiredBrain machine logs a metric every tick of a pour, and sends them
+    all once the pour is over. A pour that lasts longer than the pool has
+    blocks runs the pool dry, and its last metrics are lost.
+
+    Here we run the same pours twice: once on its own, and once with a high
+    watermark at 80% of the pool. When it is reached, the callback asks the
+    machine to send early, and the low watermark tells us when the pool has
+    room again.
+
+    Last of all, several machines share one pool from their own threads, to
+    check that the callbacks still alternate and end up matching the pool.
+*/
+
+#define POOL_BLOCKS 1000
+#define POURS 50
+#define SHARED_MACHINES 8
+#define SHARED_BURST 100
+#define SHARED_ROUNDS 20000
+
+//  Even one machine's burst can cross both watermarks, so transitions keep
+//  happening however many of the machines actually run at once.
+#define SHARED_LOW_WATERMARK 25
+#define SHARED_HIGH_WATERMARK 75
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+typedef struct Machine
+{
+    MemoryPoolManager *pool;
+    void *pending[POOL_BLOCKS];
+    long int pendingCount;
+    bool sendEarly;
+    long int lostMetrics;
+    long int earlySends;
+} Machine;
+
+//  Sends (and frees) every metric logged so far.
+static void SendMetrics(Machine *machine)
+{
+    MemPoolFreeBatch(machine -> pool, machine -> pendingCount, machine -> pending);
+    machine -> pendingCount = 0;
+}
+
+static void OnPressure(MemoryPoolManager *pool, MemoryPoolPressure pressure,
+                       long int blocksInUse, void *context)
+{
+    Machine *machine = (Machine*) context;
+
+    if (pressure == MEMORY_POOL_PRESSURE_HIGH)
+    {
+        machine -> sendEarly = true;
+        machine -> earlySends++;
+    }
+    else if (machine -> earlySends == 1)
+    {
+        printf("Pool Relieved At %ld Of %ld Blocks\n", blocksInUse, pool -> memoryBlockCount);
+    }
+}
+
+static void RunPours(Machine *machine)
+{
+    srand(7);
+
+    for (int pour = 0; pour < POURS; pour++)
+    {
+        int duration = 200 + rand() % 1200;
+
+        for (int tick = 0; tick < duration; tick++)
+        {
+            void *data = NULL;
+
+            if (MemPoolAllocData(machine -> pool, &data) != MEMORY_POOL_OK)
+            {
+                machine -> lostMetrics++;
+                continue;
+            }
+
+            TestMetrics *metric = (TestMetrics*) data;
+            metric -> pourMode = 1;
+            metric -> pourDuration = tick;
+            machine -> pending[machine -> pendingCount++] = data;
+
+            if (machine -> sendEarly)
+            {
+                machine -> sendEarly = false;
+                SendMetrics(machine);
+            }
+        }
+
+        SendMetrics(machine);
+    }
+}
+
+/*
+    The shared pool's callback log. Callbacks for one pool never overlap,
+    so it needs no lock of its own.
+*/
+typedef struct PressureLog
+{
+    long int highs;
+    long int relieves;
+    long int outOfOrder;
+    bool lastWasHigh;
+} PressureLog;
+
+static void OnSharedPressure(MemoryPoolManager *pool, MemoryPoolPressure pressure,
+                             long int blocksInUse, void *context)
+{
+    PressureLog *log = (PressureLog*) context;
+    bool high = pressure == MEMORY_POOL_PRESSURE_HIGH;
+
+    if (high == log -> lastWasHigh)
+    {
+        log -> outOfOrder++;
+    }
+
+    log -> lastWasHigh = high;
+
+    if (high)
+    {
+        log -> highs++;
+    }
+    else
+    {
+        log -> relieves++;
+    }
+}
+
+//  Logs a random burst of metrics then sends them, over and over.
+static void *SharedMachine(void *poolPtr)
+{
+    MemoryPoolManager *pool = (MemoryPoolManager*) poolPtr;
+    void *pending[SHARED_BURST];
+    uint32_t seed = (uint32_t) (uintptr_t) pending | 1;
+
+    for (int round = 0; round < SHARED_ROUNDS; round++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+
+        long int burst = 1 + seed % SHARED_BURST;
+        long int logged = 0;
+
+        while (logged < burst && MemPoolAllocData(pool, &pending[logged]) == MEMORY_POOL_OK)
+        {
+            logged++;
+        }
+
+        MemPoolFreeBatch(pool, logged, pending);
+    }
+
+    return NULL;
+}
+
+//  Returns true if the shared pool's callbacks alternated and ended relieved.
+static bool RunSharedMachines(void)
+{
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, sizeof(TestMetrics), POOL_BLOCKS);
+    config.threading = MEMORY_POOL_LOCK_FREE;
+
+    MemoryPoolManager *pool = NULL;
+    PressureLog log = { 0 };
+
+    if (MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The Shared Pool\n");
+        return false;
+    }
+
+    MemPoolSetWatermarks(pool, SHARED_LOW_WATERMARK, SHARED_HIGH_WATERMARK, OnSharedPressure,
+                         &log);
+
+    pthread_t machines[SHARED_MACHINES];
+
+    for (int m = 0; m < SHARED_MACHINES; m++)
+    {
+        pthread_create(&machines[m], NULL, SharedMachine, pool);
+    }
+
+    for (int m = 0; m < SHARED_MACHINES; m++)
+    {
+        pthread_join(machines[m], NULL);
+    }
+
+    //  Every metric has been sent, so the pool must have been relieved.
+    bool passed = log.outOfOrder == 0 && log.relieves == log.highs &&
+                  !log.lastWasHigh && !MemPoolUnderPressure(pool);
+
+    printf("Shared Pool: %ld High, %ld Relieved, %ld Out Of Order, %s\n", log.highs,
+           log.relieves, log.outOfOrder, passed ? "Passed" : "FAILED");
+
+    MemPoolDestroy(pool);
+    return passed;
+}
+
+int main(int argc, char *argv[])
+{
+    Machine machine = { 0 };
+
+    if (MemPoolInit(&machine.pool, sizeof(TestMetrics), POOL_BLOCKS) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The Pool\n");
+        return 1;
+    }
+
+    RunPours(&machine);
+    printf("Without Watermarks: %ld Metrics Lost\n", machine.lostMetrics);
+
+    machine.lostMetrics = 0;
+    MemPoolSetWatermarks(machine.pool, POOL_BLOCKS / 5, POOL_BLOCKS * 4 / 5, OnPressure,
+                         &machine);
+
+    RunPours(&machine);
+    printf("With Watermarks: %ld Metrics Lost, %ld Early Sends\n", machine.lostMetrics,
+           machine.earlySends);
+
+    MemPoolDestroy(machine.pool);
+
+    return RunSharedMachines() ? 0 : 1;
+}
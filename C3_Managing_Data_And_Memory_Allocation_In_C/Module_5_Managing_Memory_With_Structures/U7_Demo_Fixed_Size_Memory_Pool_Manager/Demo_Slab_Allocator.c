@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "Slab_Allocator.h"
+
+/*
+    A quick tour of the slab allocator.
+
+    WiredBrain's firmware juggles a few different kinds of small object:
+    metrics logged during a pour, the people using the machine and the nodes
+    of the linked lists that tie everything together. Each is a different
+    size, so rather than setting up (and sizing) a separate pool by hand for
+    each one, we ask a slab allocator for whatever size we need and it picks
+    the right pool for us.
+
+    At the end we print the slab's report to see how each size class was
+    used and how much space was lost to rounding requests up to the size
+    of their class.
+*/
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+typedef struct Person
+{
+    char name[64];
+    int age;
+    float favouriteStrength;
+} Person;
+
+typedef struct ListNode
+{
+    void *value;
+    struct ListNode *next;
+} ListNode;
+
+int main(int argc, char *argv[])
+{
+    SlabConfig config;
+    SlabDefaultConfig(&config, 1024);
+
+    SlabAllocator *slab = NULL;
+
+    if (SlabInit(&slab, &config) != MEMORY_POOL_OK)
+    {
+        printf("Unable To Create The Slab Allocator\n");
+        return 1;
+    }
+
+    /*
+        Build a list of people and a list of metrics. Every object comes from
+        the same allocator, but each lands in the class that suits its size.
+    */
+    ListNode *people = NULL;
+    ListNode *metrics = NULL;
+
+    for (int i = 0; i < 200; i++)
+    {
+        Person *person;
+        ListNode *node;
+
+        if (SlabAlloc(slab, sizeof(Person), (void**) &person) != MEMORY_POOL_OK ||
+            SlabAlloc(slab, sizeof(ListNode), (void**) &node) != MEMORY_POOL_OK)
+        {
+            printf("Ran Out Of Slab Memory\n");
+            break;
+        }
+
+        snprintf(person -> name, sizeof(person -> name), "Customer %d", i);
+        person -> age = 20 + i % 50;
+        node -> value = person;
+        node -> next = people;
+        people = node;
+    }
+
+    for (int i = 0; i < 800; i++)
+    {
+        TestMetrics *metric;
+        ListNode *node;
+
+        if (SlabAlloc(slab, sizeof(TestMetrics), (void**) &metric) != MEMORY_POOL_OK ||
+            SlabAlloc(slab, sizeof(ListNode), (void**) &node) != MEMORY_POOL_OK)
+        {
+            printf("Ran Out Of Slab Memory\n");
+            break;
+        }
+
+        metric -> pourMode = i % 3;
+        metric -> pourDuration = i;
+        node -> value = metric;
+        node -> next = metrics;
+        metrics = node;
+    }
+
+    printf("First Person: %s\n", ((Person*) people -> value) -> name);
+    printf("Sizes: TestMetrics %zu, Person %zu, ListNode %zu\n\n", sizeof(TestMetrics),
+           sizeof(Person), sizeof(ListNode));
+
+    //  Send the metrics on their way, handing their memory back as we go.
+    while (metrics != NULL)
+    {
+        ListNode *next = metrics -> next;
+        SlabFree(slab, metrics -> value);
+        SlabFree(slab, metrics);
+        metrics = next;
+    }
+
+    PrintSlabReport(slab);
+
+    while (people != NULL)
+    {
+        ListNode *next = people -> next;
+        SlabFree(slab, people -> value);
+        SlabFree(slab, people);
+        people = next;
+    }
+
+    SlabDestroy(slab);
+    slab = NULL;
+
+    return 0;
+}
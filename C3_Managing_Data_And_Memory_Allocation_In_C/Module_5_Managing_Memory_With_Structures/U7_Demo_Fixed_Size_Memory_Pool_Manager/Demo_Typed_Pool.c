@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "Typed_Pool.h"
+
+/*
+    A pour's metrics, logged through a typed pool (see Typed_Pool.h) with
+    no casts and no MemoryPoolBlocks in sight.
+
+    We then time the same churn (allocate a burst of metrics, fill them in,
+    free them) through the typed pool and through a single threaded
+    MemoryPoolManager that doesn't zero its blocks, and compare how much
+    memory each needs per metric.
+*/
+
+#define POUR_DURATION 8
+#define DEMO_CAPACITY 4096
+#define DEMO_BURST 256
+#define DEMO_ROUNDS 100000L
+
+typedef struct TestMetrics
+{
+    int pourMode;
+    int pourDuration;
+    float flow;
+    double heat;
+} TestMetrics;
+
+DECLARE_POOL(TestMetrics)
+
+static int64_t NowNanoseconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static double TimeTypedPool(Pool_TestMetrics *pool)
+{
+    TestMetrics *burst[DEMO_BURST];
+    int64_t begin = NowNanoseconds();
+
+    for (long int round = 0; round < DEMO_ROUNDS; round++)
+    {
+        for (int i = 0; i < DEMO_BURST; i++)
+        {
+            Pool_TestMetrics_alloc(pool, &burst[i]);
+            burst[i] -> pourDuration = (int) round;
+        }
+
+        for (int i = DEMO_BURST - 1; i >= 0; i--)
+        {
+            Pool_TestMetrics_free(pool, burst[i]);
+        }
+    }
+
+    return (double)(NowNanoseconds() - begin) / (DEMO_ROUNDS * DEMO_BURST);
+}
+
+static double TimeMemoryPool(MemoryPoolManager *pool)
+{
+    void *burst[DEMO_BURST];
+    int64_t begin = NowNanoseconds();
+
+    for (long int round = 0; round < DEMO_ROUNDS; round++)
+    {
+        for (int i = 0; i < DEMO_BURST; i++)
+        {
+            MemPoolAllocData(pool, &burst[i]);
+            ((TestMetrics*) burst[i]) -> pourDuration = (int) round;
+        }
+
+        for (int i = DEMO_BURST - 1; i >= 0; i--)
+        {
+            MemPoolFreeData(pool, burst[i]);
+        }
+    }
+
+    return (double)(NowNanoseconds() - begin) / (DEMO_ROUNDS * DEMO_BURST);
+}
+
+int main(int argc, char *argv[])
+{
+    Pool_TestMetrics metricsPool;
+
+    if (Pool_TestMetrics_init(&metricsPool, DEMO_CAPACITY) != MEMORY_POOL_OK)
+    {
+        return 1;
+    }
+
+    TestMetrics *pour[POUR_DURATION];
+
+    for (int tick = 0; tick < POUR_DURATION; tick++)
+    {
+        Pool_TestMetrics_alloc(&metricsPool, &pour[tick]);
+        pour[tick] -> pourMode = 1;
+        pour[tick] -> pourDuration = tick;
+        pour[tick] -> heat = 90.0 + tick;
+    }
+
+    printf("Logged %ld Metrics, Last Heat: %.1f\n", metricsPool.liveCount,
+           pour[POUR_DURATION - 1] -> heat);
+
+    for (int tick = 0; tick < POUR_DURATION; tick++)
+    {
+        Pool_TestMetrics_free(&metricsPool, pour[tick]);
+    }
+
+    TestMetrics stray;
+
+    if (Pool_TestMetrics_free(&metricsPool, &stray) == MEMORY_POOL_INVALID_FREE_ERROR)
+    {
+        printf("Freeing A Metric The Pool Doesn't Own Is Rejected\n");
+    }
+
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, sizeof(TestMetrics), DEMO_CAPACITY);
+    config.zeroing = MEMORY_POOL_ZERO_NONE;
+
+    MemoryPoolManager *pool = NULL;
+
+    if (MemPoolInitWithConfig(&pool, &config) != MEMORY_POOL_OK)
+    {
+        Pool_TestMetrics_destroy(&metricsPool);
+        return 1;
+    }
+
+    double typed = TimeTypedPool(&metricsPool);
+    double untyped = TimeMemoryPool(pool);
+
+    printf("\nBursts Of %d Metrics\n", DEMO_BURST);
+    printf("%20s %10s %16s\n", "", "ns/metric", "Bytes Per Metric");
+    printf("%20s %10.2f %16zu\n", "Pool_TestMetrics", typed, sizeof(Pool_TestMetrics_Slot));
+    printf("%20s %10.2f %16zu\n", "MemoryPoolManager", untyped,
+           pool -> blockStride + sizeof(MemoryPoolBlock));
+
+    MemPoolDestroy(pool);
+    Pool_TestMetrics_destroy(&metricsPool);
+
+    return 0;
+}
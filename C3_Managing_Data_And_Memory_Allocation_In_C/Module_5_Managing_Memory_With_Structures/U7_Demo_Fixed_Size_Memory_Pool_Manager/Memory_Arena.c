@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "Memory_Arena.h"
+
+/*
+    Creates an arena managing "size" bytes. Just like MemPoolInit, this is
+    the only place the arena talks to malloc.
+*/
+MemoryPoolStatus ArenaInit(MemoryArena **arena, size_t size)
+{
+    if (arena == NULL || size == 0)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    *arena = (MemoryArena*) malloc(sizeof(MemoryArena));
+
+    if (*arena == NULL)
+    {
+        printf("Unable To Allocate Memory For The Arena\n");
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    (*arena) -> start = malloc(size);
+
+    if ((*arena) -> start == NULL)
+    {
+        printf("Unable To Allocate Memory For The Arena\n");
+        free(*arena);
+        *arena = NULL;
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    (*arena) -> size = size;
+    (*arena) -> offset = 0;
+    (*arena) -> peakOffset = 0;
+
+    return MEMORY_POOL_OK;
+}
+
+MemoryPoolStatus ArenaDestroy(MemoryArena *arena)
+{
+    if (arena != NULL)
+    {
+        free(arena -> start);
+        free(arena);
+    }
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Bumps the arena's offset along to make room for "size" bytes.
+
+    "alignment" must be a power of two (or 0 to use the strictest alignment
+    any built in type needs, just like malloc). Rounding an address up to a
+    power of two is a bit of bit twiddling: adding "alignment - 1" pushes
+    the address past the next boundary (unless it's already on one), and
+    masking off the low bits drops it back onto that boundary.
+
+    If the arena doesn't have enough room left, nothing changes and an
+    allocation error is returned.
+*/
+MemoryPoolStatus ArenaAlloc(MemoryArena *arena, size_t size, size_t alignment, void **data)
+{
+    if (arena == NULL || data == NULL)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    if (alignment == 0)
+    {
+        alignment = _Alignof(max_align_t);
+    }
+
+    if ((alignment & (alignment - 1)) != 0)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    uintptr_t base = (uintptr_t) arena -> start;
+    uintptr_t current = base + arena -> offset;
+    uintptr_t aligned = (current + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+    size_t newOffset = (size_t)(aligned - base);
+
+    if (newOffset > arena -> size || size > arena -> size - newOffset)
+    {
+        *data = NULL;
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    arena -> offset = newOffset + size;
+
+    if (arena -> offset > arena -> peakOffset)
+    {
+        arena -> peakOffset = arena -> offset;
+    }
+
+    *data = (void*) aligned;
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Individual allocations can't be freed from an arena, so this does
+    nothing. It exists so code can be written against the same "alloc then
+    free" shape as the other allocators and switched over to an arena
+    without rewriting every call site.
+*/
+void ArenaFree(MemoryArena *arena, void *data)
+{
+    (void) arena;
+    (void) data;
+}
+
+/*
+    Frees everything allocated from the arena in one go. Only the offset is
+    touched, so this takes the same time whether one object or one million
+    objects were allocated.
+*/
+void ArenaReset(MemoryArena *arena)
+{
+    if (arena != NULL)
+    {
+        arena -> offset = 0;
+    }
+}
+
+/*
+    Records where the arena is up to, so everything allocated after this
+    point can later be thrown away with ArenaRestore. Markers nest: restore
+    them in the reverse order to which they were saved.
+*/
+MemoryArenaMarker ArenaSave(MemoryArena *arena)
+{
+    MemoryArenaMarker marker = { arena != NULL ? arena -> offset : 0 };
+    return marker;
+}
+
+/*
+    Rewinds the arena to a marker from ArenaSave. A marker that is ahead of
+    the arena's current position belongs to a scope that has already been
+    unwound (or reset), so it is rejected rather than handing out memory
+    that may still be in use.
+*/
+MemoryPoolStatus ArenaRestore(MemoryArena *arena, MemoryArenaMarker marker)
+{
+    if (arena == NULL || marker.offset > arena -> offset)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    arena -> offset = marker.offset;
+    return MEMORY_POOL_OK;
+}
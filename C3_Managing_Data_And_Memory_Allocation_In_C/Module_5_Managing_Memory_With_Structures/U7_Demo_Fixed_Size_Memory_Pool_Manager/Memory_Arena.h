@@ -0,0 +1,65 @@
+/*
+    An arena (also known as a "bump" or "linear" allocator) is the simplest
+    memory manager there is, and for the right job, the fastest.
+
+    Like our memory pool, an arena grabs one big block of memory up front.
+    Unlike the pool, it doesn't chop that memory into fixed-size blocks.
+    Instead, it keeps a single "offset" marking how much of the block has
+    been used. Allocating just rounds the offset up to the alignment the
+    caller needs, hands out the address at that offset and "bumps" the
+    offset along by the size requested. That's it!
+
+    The catch is that you can't free individual allocations. ArenaFree does
+    nothing at all. Instead, everything is freed at once with ArenaReset,
+    which simply puts the offset back to zero. No matter how many objects
+    were allocated, resetting costs the same tiny amount of time.
+
+    This is a perfect fit for WiredBrain's pours: each pour creates lots of
+    short-lived objects, and they all die together when the pour finishes.
+
+    For nested lifetimes (say, scratch memory used for one step of a pour),
+    ArenaSave records the current offset as a marker, and ArenaRestore later
+    rewinds the arena to that marker, freeing everything allocated since in
+    one go whilst keeping everything allocated before it.
+*/
+
+#include <stddef.h>
+#include "Memory_Pool_Manager.h"
+
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+/*
+    "offset" is how many bytes from "start" have been handed out so far, and
+    "peakOffset" the most that has ever been in use at once, which is handy
+    for sizing the arena.
+*/
+typedef struct MemoryArena
+{
+    void *start;
+    size_t size;
+    size_t offset;
+    size_t peakOffset;
+} MemoryArena;
+
+//  A saved position in an arena, returned by ArenaSave.
+typedef struct MemoryArenaMarker
+{
+    size_t offset;
+} MemoryArenaMarker;
+
+MemoryPoolStatus ArenaInit(MemoryArena **arena, size_t size);
+
+MemoryPoolStatus ArenaDestroy(MemoryArena *arena);
+
+MemoryPoolStatus ArenaAlloc(MemoryArena *arena, size_t size, size_t alignment, void **data);
+
+void ArenaFree(MemoryArena *arena, void *data);
+
+void ArenaReset(MemoryArena *arena);
+
+MemoryArenaMarker ArenaSave(MemoryArena *arena);
+
+MemoryPoolStatus ArenaRestore(MemoryArena *arena, MemoryArenaMarker marker);
+
+#endif
@@ -1,252 +1,3842 @@
+//  mmap's MAP_ANONYMOUS and madvise aren't part of strict C11 or POSIX, so
+//  ask the C library for them before anything is included.
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
 #include "Memory_Pool_Manager.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void MemPoolReleaseMagazine(void *magazine);
+
+/*
+    Bitmap helpers. Counting the trailing zeros of a word gives the position
+    of its lowest set bit, and a population count gives the number of set
+    bits. Modern CPUs do both in a single instruction, which GCC/Clang and
+    MSVC expose under different names. "word" must not be zero for
+    MemPoolCountTrailingZeros.
+*/
+static int MemPoolCountTrailingZeros(uint64_t word)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (int) index;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+static int MemPoolPopCount(uint64_t word)
+{
+#if defined(_MSC_VER)
+    return (int) __popcnt64(word);
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+//  How many 64-bit words a bitmap needs to hold one bit per block.
+static long int MemPoolBitmapWords(long int blockCount)
+{
+    return (blockCount + 63) / 64;
+}
+
+//  Rounds "size" up to a multiple of "granularity" (a power of two).
+static size_t MemPoolRoundUp(size_t size, size_t granularity)
+{
+    return (size + granularity - 1) & ~(granularity - 1);
+}
+
+/*
+    Works out how blocks are laid out in a chunk. Each block takes up
+    "blockStride" bytes, and its data starts "dataOffset" bytes into that.
+
+    Packed blocks are just the block itself, plus its guard bytes either
+    side (which are zero bytes wide unless MEM_POOL_DEBUG is defined). An
+    aligned pool rounds the leading guard up to the alignment, so the data
+    behind it stays aligned, and rounds the whole stride up too, so every
+    block after the first is aligned as well. Cache-line padding rounds the
+    stride up to a whole number of cache lines.
+*/
+static void MemPoolSetLayout(MemoryPoolManager *pool, size_t alignment, bool cacheLinePadding)
+{
+    size_t granularity = alignment == 0 ? 1 : alignment;
+
+    if (cacheLinePadding && granularity < MEM_POOL_CACHE_LINE_SIZE)
+    {
+        granularity = MEM_POOL_CACHE_LINE_SIZE;
+    }
+
+    pool -> alignment = alignment;
+    pool -> dataOffset = alignment == 0 ? MEM_POOL_GUARD_SIZE :
+                                          MemPoolRoundUp(MEM_POOL_GUARD_SIZE, alignment);
+    pool -> blockStride = MemPoolRoundUp(pool -> dataOffset + pool -> memoryBlockSize +
+                                         MEM_POOL_GUARD_SIZE, granularity);
+}
+
+//  The distance between the start of one block's data and the next.
+static size_t MemPoolStride(MemoryPoolManager *pool)
+{
+    return pool -> blockStride;
+}
+
+//  Block "i"'s data starts "i * stride + dataOffset" bytes into its chunk.
+static void* MemPoolSlotData(MemoryPoolManager *pool, void *start, long int slot)
+{
+    return (char*) start + (size_t) slot * MemPoolStride(pool) + pool -> dataOffset;
+}
+
+//  True if blocks need more alignment than malloc promises.
+static bool MemPoolOverAligned(MemoryPoolManager *pool)
+{
+    return pool -> alignment > _Alignof(max_align_t);
+}
+
+/*
+    The checks behind MEM_POOL_DEBUG (see Memory_Pool_Manager.h). In release
+    builds MEM_POOL_DEBUG_REPORT expands to nothing and none of these
+    functions exist.
+*/
+#ifdef MEM_POOL_DEBUG
+#define MEM_POOL_DEBUG_REPORT(problem, address) \
+    printf("Memory Pool Debug: %s At %p\n", problem, (void*) (address))
+
+//  True if "size" bytes from "data" all hold "pattern".
+static bool MemPoolDebugCheckBytes(const void *data, size_t size, unsigned char pattern)
+{
+    const unsigned char *bytes = (const unsigned char*) data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        if (bytes[i] != pattern)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//  Surrounds every block of a new chunk with canaries and poisons its data.
+static void MemPoolDebugFillChunk(MemoryPoolManager *pool, void *start, long int blockCount)
+{
+    for (long int i = 0; i < blockCount; i++)
+    {
+        char *data = (char*) MemPoolSlotData(pool, start, i);
+
+        memset(data - MEM_POOL_GUARD_SIZE, MEM_POOL_GUARD_BYTE, MEM_POOL_GUARD_SIZE);
+        memset(data, MEM_POOL_POISON_BYTE, pool -> memoryBlockSize);
+        memset(data + pool -> memoryBlockSize, MEM_POOL_GUARD_BYTE, MEM_POOL_GUARD_SIZE);
+    }
+}
+
+/*
+    Called as a block is handed out. Anything other than poison in the block
+    means someone wrote to it whilst it was free. The block is zeroed before
+    it is handed out, just as it would be in a release build.
+*/
+static void MemPoolDebugCheckAlloc(MemoryPoolManager *pool, void *data)
+{
+    if (!MemPoolDebugCheckBytes(data, pool -> memoryBlockSize, MEM_POOL_POISON_BYTE))
+    {
+        MEM_POOL_DEBUG_REPORT("Write After Free", data);
+    }
+
+    memset(data, 0, pool -> memoryBlockSize);
+}
+
+/*
+    Called as a block is freed. Checks both canaries, repairing them if they
+    were overwritten so the block can be used again, then poisons the data.
+*/
+static MemoryPoolStatus MemPoolDebugCheckFree(MemoryPoolManager *pool, void *data)
+{
+    char *before = (char*) data - MEM_POOL_GUARD_SIZE;
+    char *after = (char*) data + pool -> memoryBlockSize;
+    MemoryPoolStatus status = MEMORY_POOL_OK;
+
+    if (!MemPoolDebugCheckBytes(before, MEM_POOL_GUARD_SIZE, MEM_POOL_GUARD_BYTE))
+    {
+        MEM_POOL_DEBUG_REPORT("Write Before Start Of Block", data);
+        memset(before, MEM_POOL_GUARD_BYTE, MEM_POOL_GUARD_SIZE);
+        status = MEMORY_POOL_CORRUPTION_ERROR;
+    }
+
+    if (!MemPoolDebugCheckBytes(after, MEM_POOL_GUARD_SIZE, MEM_POOL_GUARD_BYTE))
+    {
+        MEM_POOL_DEBUG_REPORT("Write Past End Of Block", data);
+        memset(after, MEM_POOL_GUARD_BYTE, MEM_POOL_GUARD_SIZE);
+        status = MEMORY_POOL_CORRUPTION_ERROR;
+    }
+
+    memset(data, MEM_POOL_POISON_BYTE, pool -> memoryBlockSize);
+    return status;
+}
+#else
+#define MEM_POOL_DEBUG_REPORT(problem, address)
+#endif
+
+/*
+    Creates a single threaded pool of "memBlockCount" blocks, each of which
+    is "memBlockSize" bytes big. This is just a shortcut for filling in a
+    default MemoryPoolConfig and passing it to MemPoolInitWithConfig.
+*/
 MemoryPoolStatus MemPoolInit(MemoryPoolManager **pool, size_t memBlockSize,
                             long int memBlockCount)
 {
-    if (memBlockCount <= 0)
+    MemoryPoolConfig config;
+    MemPoolDefaultConfig(&config, memBlockSize, memBlockCount);
+
+    return MemPoolInitWithConfig(pool, &config);
+}
+
+/*
+    Fills in a config with the options MemPoolInit has always used: a single
+    threaded pool of "memBlockCount" blocks of "memBlockSize" bytes.
+*/
+void MemPoolDefaultConfig(MemoryPoolConfig *config, size_t memBlockSize,
+                          long int memBlockCount)
+{
+    if (config == NULL)
     {
-        return MEMORY_POOL_INIT_ERROR;
+        return;
     }
 
-    /*  
-        Allocate memory for the pool itself. 
-        
-        We need to use a ptr to a ptr 
-        here so we don't end up with a dangling pointer! Remember, the local
-        pool variable only has scope for this function! If we just use a 
-        pointer, we assign the malloced pointer that refers to our new
-        MemoryPoolManager to the LOCAL VARIABLE and not the original pointer
-        in the calling code. This pointer then goes out of scope and we end
-        up with a memory leak, thus we dereference a pointer which pointers
-        to the address of a pointer in the calling code so we can directly
-        assign the value of our new pointer to that variable. 
-    */
-   *pool = (MemoryPoolManager*) malloc(sizeof(MemoryPoolManager));
+    memset(config, 0, sizeof(MemoryPoolConfig));
+    config -> memoryBlockSize = memBlockSize;
+    config -> memoryBlockCount = memBlockCount;
+    config -> threading = MEMORY_POOL_SINGLE_THREADED;
+    config -> magazineSize = MEM_POOL_DEFAULT_MAGAZINE_SIZE;
+    config -> growable = false;
+    config -> growthFactor = 1.0;
+    config -> maxBlockCount = 0;
+    config -> layout = MEMORY_POOL_LAYOUT_BLOCK_LIST;
+    config -> zeroing = MEMORY_POOL_ZERO_EAGER;
+    config -> backing = MEMORY_POOL_BACKING_HEAP;
+    config -> hugePages = false;
+    config -> prefault = false;
+    config -> alignment = 0;
+    config -> cacheLinePadding = false;
+}
 
-    //   Allocate memory for each block. This will be a single contiguous block
-    //   for each block. Each MemoryPoolBlock is a structure that represents
-    //   a block of data that is comparable to calling "malloc"
-    MemoryPoolBlock *blocks = (MemoryPoolBlock*) malloc(sizeof(MemoryPoolBlock) * 
-                                                        memBlockCount);
-    
-    // Allocate the chunk of memory to be managed by the pool.
-    size_t poolSize = memBlockSize * memBlockCount;
+static size_t MemPoolPageSize(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t) info.dwPageSize;
+#else
+    return (size_t) sysconf(_SC_PAGESIZE);
+#endif
+}
 
-    //  Void ptr: Just store the address of where our pool of memory starts.
-    void *start = (void*) malloc(poolSize);
+//  Writes to one byte of every page so the operating system maps them all now.
+static void MemPoolTouchPages(void *start, size_t size)
+{
+    volatile char *bytes = (volatile char*) start;
+    size_t pageSize = MemPoolPageSize();
 
-    //  Catch any instances where there is not enough memory to allocate the
-    //  Pool Manager, the Memory Pool Blocks or the memory we'll use to
-    //  store data in the blocks.
-    if (pool == NULL || blocks == NULL || start == NULL)
+    for (size_t offset = 0; offset < size; offset += pageSize)
     {
-        printf("Unable To Allocate Memory For The Pool\n");
-        return MEMORY_POOL_INIT_ERROR;
+        bytes[offset] = 0;
     }
+}
 
-    /*  
-        Update the pool metadata including how many memory blocks we are 
-        creating, how big each block is, the total amount of memory used
-        in the memory pool (i.e. cumulative total of all the blocks) and 
-        a pointer to the start of the memory used to hold the data for
-        all of our blocks so we can update the blocks with new data
-        when required. 
-    */
-    (*pool) -> memoryBlockCount = memBlockCount;
-    (*pool) -> memoryBlockSize = memBlockSize;
-    (*pool) -> poolSize = poolSize;
-    (*pool) -> head = blocks;
+/*
+    Maps "size" bytes (a whole number of pages) of fresh, zeroed memory for
+    a MEMORY_POOL_BACKING_MMAP pool.
 
-    /*
-        We need to point each MemoryBlock to the starting address of each
-        chunk of memory it is managing in the single block of allocated
-        memory we set up in "start".
+    Transparent huge pages can only be used for memory that sits on a 2MB
+    boundary, which mmap doesn't promise. So for huge pages we map an extra
+    MEM_POOL_HUGE_PAGE_SIZE bytes, then unmap whatever sticks out either
+    side of the first 2MB boundary. MAP_POPULATE would fault the pages in
+    before madvise gets to ask for huge pages, so in that case we prefault
+    by hand afterwards instead.
+*/
+static void* MemPoolMapChunkData(MemoryPoolManager *pool, size_t size)
+{
+#if defined(_WIN32)
+    void *start = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 
-        To begin with, start at the begining of the block, set a pointer to
-        the starting memory address of the block of memory that the current
-        Memory Block will store it's data to, and then increment the pointer
-        by the designatated amount of memory each block is to hold so we 
-        can move to the starting address of the next memory block's data.
+    if (start != NULL && pool -> prefault)
+    {
+        MemPoolTouchPages(start, size);
+    }
 
-        We also need to move to the next MemoryPoolBlock in memory so we can
-        update it's struct members with the provided data as well as link
-        it to it's starting address in memory. 
+    return start;
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    size_t alignment = pool -> hugePages ? MEM_POOL_HUGE_PAGE_SIZE : 0;
+    bool populated = false;
 
-        Finally, we update our memory block linked list node with all the 
-        member data it needs including pointing it to the next memmory 
-        block in the list as well as the size of each block and a flag
-        to check if the memory block has been allocated. 
-    */
-    void *current = start;
-    void *next = NULL;
+#ifdef MAP_POPULATE
+    if (pool -> prefault && !pool -> hugePages)
+    {
+        flags |= MAP_POPULATE;
+        populated = true;
+    }
+#endif
 
-    MemoryPoolBlock *currentBlock = blocks;
-    MemoryPoolBlock *nextBlock = NULL;
+    void *mapped = mmap(NULL, size + alignment, PROT_READ | PROT_WRITE, flags, -1, 0);
 
-    for (int i = 0; i < memBlockCount; i++)
+    if (mapped == MAP_FAILED)
     {
-        currentBlock -> data = current;
+        return NULL;
+    }
 
-        /*  
-            If i is equal to the last memory block (if we zero out our block
-            count), we are at the end of our blocks. Therefore set the next
-            block to NULL so we know when to stop looking for more blocks in
-            our linked list.
-        */
-        if (i == memBlockCount - 1)
+    char *start = (char*) mapped;
+
+    if (alignment != 0)
+    {
+        uintptr_t address = (uintptr_t) mapped;
+        uintptr_t aligned = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        size_t before = aligned - address;
+
+        start = (char*) aligned;
+
+        if (before != 0)
         {
-            next = NULL;
-            nextBlock = NULL;
+            munmap(mapped, before);
         }
 
-        else
+        if (alignment - before != 0)
         {
-            // Void ptr arithmetic illegal in standard C! Cast to int to
-            // increment!
-            next = (int*)current + memBlockSize;
-            nextBlock = currentBlock + sizeof(MemoryPoolBlock);
+            munmap(start + size, alignment - before);
         }
 
-        currentBlock -> next = nextBlock;
-        currentBlock -> size = memBlockSize; 
-        currentBlock -> isAlloc = false;
-
-        //  Increment to next data storage starting address for the next memory
-        //  block.
-        current = next;
+#ifdef MADV_HUGEPAGE
+        madvise(start, size, MADV_HUGEPAGE);
+#endif
+    }
 
-        //  Point us to the next block ready to set up the next metadata to track
-        //  another memory block to be managed by the memory pool.
-        currentBlock = nextBlock;
+    if (pool -> prefault && !populated)
+    {
+        MemPoolTouchPages(start, size);
     }
 
-    return MEMORY_POOL_OK;
+    return start;
+#endif
 }
 
 /*
-    Perform clean up on our Memory Pool Manaager and ensure all components
-    are cleaned up correctly in order to prevent a memory leak.
+    Allocates the memory that holds a new chunk's data, and sets
+    "mappedSize" to its size if it was mapped rather than taken from the
+    heap (see MemoryPoolBacking).
 
-    This method must be called in order to properly deallocate all memory
-    associated with the memory pool manager.
+    Unless the pool never zeroes anything, the chunk has to start off
+    zeroed, and calloc is the cheapest way to get there: for big chunks the
+    operating system hands over pages that are already zero, so nothing has
+    to be written at all. Mapped memory always starts off zeroed.
+*/
+static void* MemPoolAllocChunkData(MemoryPoolManager *pool, long int blockCount,
+                                   size_t *mappedSize)
+{
+    size_t size = MemPoolStride(pool) * blockCount;
+    *mappedSize = 0;
 
-    As the memory pool manager is made up of three components that have
-    all been dynamically allocated, all three need to be freed to avoid
-    a memory leak.
+    if (pool -> backing == MEMORY_POOL_BACKING_MMAP)
+    {
+        size_t granularity = pool -> hugePages ? MEM_POOL_HUGE_PAGE_SIZE : MemPoolPageSize();
+        size = (size + granularity - 1) / granularity * granularity;
 
-    These three components are:
+        void *start = MemPoolMapChunkData(pool, size);
 
-        - The block of memory responsible for storing each blocks data as a
-          single contiguous block of memory.
+        if (start != NULL)
+        {
+            *mappedSize = size;
+        }
 
-        - The block of memory responsible for storing each MemoryBlock struct
-          and it's associated meta-data.
+        return start;
+    }
 
-        - The Memory pool itself, a struct used for tracking the head of the
-          MemoryBlocks linked list as well as how many/how big each Memory
-          Block should be in the pool.
-*/
-MemoryPoolStatus MemPoolDestroy(MemoryPoolManager *pool)
+    /*
+        Over-aligned blocks need the chunk itself to start on an aligned
+        address. C11's aligned_alloc does that (MSVC has its own version),
+        but doesn't zero the memory for us like calloc. As the stride is a
+        multiple of the alignment, so is "size", as aligned_alloc requires.
+    */
+    if (MemPoolOverAligned(pool))
+    {
+#if defined(_MSC_VER)
+        void *start = _aligned_malloc(size, pool -> alignment);
+#else
+        void *start = aligned_alloc(pool -> alignment, size);
+#endif
+
+        if (start != NULL && pool -> zeroing != MEMORY_POOL_ZERO_NONE)
+        {
+            memset(start, 0, size);
+        }
+
+        return start;
+    }
+
+    if (pool -> zeroing == MEMORY_POOL_ZERO_NONE)
+    {
+        return malloc(size);
+    }
+
+    return calloc(blockCount, MemPoolStride(pool));
+}
+
+//  Hands a chunk's data back to wherever MemPoolAllocChunkData got it from.
+static void MemPoolFreeChunkData(MemoryPoolManager *pool, void *start, size_t mappedSize)
 {
-    if (pool != NULL && pool->head != NULL)
+    if (mappedSize == 0)
     {
-        free(pool -> head->data);
-        free(pool->head);
-        free(pool);
+#if defined(_MSC_VER)
+        if (MemPoolOverAligned(pool))
+        {
+            _aligned_free(start);
+            return;
+        }
+#else
+        (void) pool;
+#endif
+        free(start);
+        return;
     }
-    return MEMORY_POOL_OK;
+
+#if defined(_WIN32)
+    VirtualFree(start, 0, MEM_RELEASE);
+#else
+    munmap(start, mappedSize);
+#endif
 }
 
 /*
-    Iterate over each Memory Block tracked by the Memory Pool until we hit the
-    first available block that is unallocated. Set this block to allocated and
-    then set the block pointer to the newly allocated block in the memory pool.
+    The chunk map (see MemoryPoolChunkMap). A fixed pool has one chunk, so
+    finding the chunk an address belongs to is a single range check. A
+    growable pool can end up with any number of chunks (a growth factor of
+    1.0 adds another chunk the size of the first every time it runs dry),
+    and checking each of them in turn would make every free slower the
+    further the pool had grown, which is exactly what the free list was
+    meant to avoid.
+
+    So every chunk after the first is entered into a hash table under each
+    window of addresses it covers, once for its data and once for its
+    MemoryPoolBlocks, and once more under the block indexes it holds so a
+    handle can find its chunk too. A window is the biggest power of two that
+    fits in the first chunk, and chunks never shrink, so no window overlaps
+    more than a couple of chunks (or three, when the last chunk was cut
+    short by "maxBlockCount"). Finding an address's chunk is then a shift
+    and a probe of the table, however many chunks there are.
 
-    Note how no calls to malloc take place here! Memory allocation is done via
-    boolean flags! So there are no system calls made! This is the power of a
-    memory pool!
+    Frees look chunks up without taking any lock, whilst another thread may
+    be growing the pool. Entries are only ever added: each entry's chunk is
+    written before its key is published (release), and a reader that finds
+    the key (acquire) therefore sees the chunk fully set up. A replacement
+    map is filled in completely before it is published.
 */
-MemoryPoolStatus MemPoolAlloc(MemoryPoolManager *pool, MemoryPoolBlock **block)
+#define MEM_POOL_MAP_DATA ((uint64_t) 1 << 62)
+#define MEM_POOL_MAP_BLOCKS ((uint64_t) 2 << 62)
+#define MEM_POOL_MAP_INDEX ((uint64_t) 3 << 62)
+#define MEM_POOL_MAP_KINDS 3
+#define MEM_POOL_MAP_WINDOW_MASK (((uint64_t) 1 << 62) - 1)
+#define MEM_POOL_MAP_MIN_CAPACITY 64
+
+//  The largest "shift" for which 1 << shift still fits in "size".
+static int MemPoolMapShift(size_t size)
 {
-    if (pool == NULL || block == NULL)
+    int shift = 0;
+
+    while (shift < 62 && (size >> (shift + 1)) != 0)
     {
-        printf("Memory Pool Alloc Error\n");
-        return MEMORY_POOL_ALLOC_ERROR;
+        shift++;
     }
 
-    if (pool -> head != NULL)
+    return shift;
+}
+
+//  Where to start probing for "key" (Fibonacci hashing).
+static size_t MemPoolMapSlot(MemoryPoolChunkMap *map, uint64_t key)
+{
+    return (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (map -> capacity - 1);
+}
+
+static void MemPoolMapInsert(MemoryPoolChunkMap *map, uint64_t key, MemoryPoolChunk *chunk)
+{
+    size_t slot = MemPoolMapSlot(map, key);
+
+    while (atomic_load_explicit(&map -> entries[slot].key, memory_order_relaxed) != 0)
     {
-        //  Point us to the start of the memory pools tracked list of Memory 
-        // Block's. 
-        MemoryPoolBlock *current = pool -> head;
+        slot = (slot + 1) & (map -> capacity - 1);
+    }
+
+    atomic_store_explicit(&map -> entries[slot].chunk, chunk, memory_order_relaxed);
+    atomic_store_explicit(&map -> entries[slot].key, key, memory_order_release);
+    map -> used++;
+}
+
+//  Which of a map's "shifts" (and a chunk's ranges) a kind of key uses.
+static int MemPoolMapKind(uint64_t kind)
+{
+    return (int)(kind >> 62) - 1;
+}
+
+/*
+    The ranges a chunk's data addresses, MemoryPoolBlock addresses and block
+    indexes cover, in that order. A bitmap chunk's blocks range is empty.
+*/
+static void MemPoolChunkRanges(MemoryPoolManager *pool, MemoryPoolChunk *chunk,
+                               uintptr_t ranges[MEM_POOL_MAP_KINDS][2])
+{
+    size_t blocksSize = chunk -> blocks != NULL ? sizeof(MemoryPoolBlock) : 0;
+
+    ranges[0][0] = (uintptr_t) chunk -> start + pool -> dataOffset;
+    ranges[0][1] = ranges[0][0] + MemPoolStride(pool) * chunk -> blockCount;
+    ranges[1][0] = (uintptr_t) chunk -> blocks;
+    ranges[1][1] = ranges[1][0] + blocksSize * chunk -> blockCount;
+    ranges[2][0] = (uintptr_t) chunk -> firstIndex;
+    ranges[2][1] = ranges[2][0] + (uintptr_t) chunk -> blockCount;
+}
+
+/*
+    Enters "chunk" into "map" under every window it covers, or, if "map" is
+    NULL, just counts how many entries that would take.
+*/
+static size_t MemPoolMapEnter(MemoryPoolManager *pool, MemoryPoolChunkMap *map,
+                              const int shifts[MEM_POOL_MAP_KINDS], MemoryPoolChunk *chunk)
+{
+    uintptr_t ranges[MEM_POOL_MAP_KINDS][2];
+    MemPoolChunkRanges(pool, chunk, ranges);
 
-        //  If we reach a NULL Ptr, we've hit the last node. Whilst we're not 
-        //  at the end, continue to iterate over the memory blocks.
-        while (current)
+    const uint64_t kinds[MEM_POOL_MAP_KINDS] = { MEM_POOL_MAP_DATA, MEM_POOL_MAP_BLOCKS,
+                                                 MEM_POOL_MAP_INDEX };
+    size_t entries = 0;
+
+    for (int r = 0; r < MEM_POOL_MAP_KINDS; r++)
+    {
+        if (ranges[r][0] == ranges[r][1])
         {
-            if (current-> isAlloc == false)
-            {
-                //  Set the pointer to the memory block that was passed in to 
-                //  point to the memory block that has just been allocated.
-                *block = current;
-                current -> isAlloc = true;
-                return MEMORY_POOL_OK;
-            }
+            continue;
+        }
 
-            else
+        uint64_t first = ranges[r][0] >> shifts[r];
+        uint64_t last = (ranges[r][1] - 1) >> shifts[r];
+
+        for (uint64_t window = first; window <= last; window++, entries++)
+        {
+            if (map != NULL)
             {
-                current = current -> next;
+                MemPoolMapInsert(map, kinds[r] | (window & MEM_POOL_MAP_WINDOW_MASK), chunk);
             }
         }
     }
-}
 
+    return entries;
+}
 
 /*
-    This function traverses the MemoryPool's MemoryPoolBlock linked list
-    until it hits the address of the block that was passed in as the
-    second parameter.
+    Adds a new (not yet linked) chunk to the pool's chunk map, first building
+    a bigger map if this would leave it more than half full. The first map
+    takes its window sizes from the pool's first chunk.
 
-    When hit, the block has it's allocation set to false and, for security,
-    has it's previous stored data zeroed ready for reallocation.
+    Callers must hold "depotLock" if the pool is shared between threads.
 */
-MemoryPoolStatus MemPoolFree(MemoryPoolManager *pool, MemoryPoolBlock *block)
+static MemoryPoolStatus MemPoolMapChunk(MemoryPoolManager *pool, MemoryPoolChunk *chunk)
 {
-    MemoryPoolBlock *current = pool -> head;
+    MemoryPoolChunkMap *map = atomic_load_explicit(&pool -> chunkMap, memory_order_relaxed);
+    int shifts[MEM_POOL_MAP_KINDS];
 
-    while (current)
+    if (map != NULL)
     {
-        if (current == block)
-        {
-            current -> isAlloc = false;
-            memset(current -> data, 0, pool -> memoryBlockSize);
-            return MEMORY_POOL_OK;
-        }
+        memcpy(shifts, map -> shifts, sizeof(shifts));
+    }
+    else
+    {
+        long int firstCount = pool -> chunks -> blockCount;
 
-        else
+        shifts[0] = MemPoolMapShift(MemPoolStride(pool) * firstCount);
+        shifts[1] = MemPoolMapShift(sizeof(MemoryPoolBlock) * firstCount);
+        shifts[2] = MemPoolMapShift((size_t) firstCount);
+    }
+
+    size_t needed = MemPoolMapEnter(pool, NULL, shifts, chunk);
+
+    if (map != NULL && (map -> used + needed) * 2 <= map -> capacity)
+    {
+        MemPoolMapEnter(pool, map, shifts, chunk);
+        return MEMORY_POOL_OK;
+    }
+
+    size_t capacity = map != NULL ? map -> capacity : MEM_POOL_MAP_MIN_CAPACITY;
+
+    while (((map != NULL ? map -> used : 0) + needed) * 2 > capacity)
+    {
+        capacity *= 2;
+    }
+
+    MemoryPoolChunkMap *grown = (MemoryPoolChunkMap*) calloc(1, sizeof(MemoryPoolChunkMap));
+    MemoryPoolChunkMapEntry *entries = (MemoryPoolChunkMapEntry*)
+                                       calloc(capacity, sizeof(MemoryPoolChunkMapEntry));
+
+    if (grown == NULL || entries == NULL)
+    {
+        printf("Unable To Allocate Memory For The Pool\n");
+        free(grown);
+        free(entries);
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    grown -> entries = entries;
+    grown -> capacity = capacity;
+    memcpy(grown -> shifts, shifts, sizeof(shifts));
+    grown -> retired = map;
+
+    for (size_t i = 0; map != NULL && i < map -> capacity; i++)
+    {
+        uint64_t key = atomic_load_explicit(&map -> entries[i].key, memory_order_relaxed);
+
+        if (key != 0)
         {
-            current = current -> next;
+            MemPoolMapInsert(grown, key, atomic_load_explicit(&map -> entries[i].chunk,
+                                                              memory_order_relaxed));
         }
     }
-    return MEMORY_POOL_DESTROY_ERROR;
+
+    MemPoolMapEnter(pool, grown, shifts, chunk);
+    atomic_store_explicit(&pool -> chunkMap, grown, memory_order_release);
+    return MEMORY_POOL_OK;
 }
 
-void PrintMemBlocks(MemoryPoolManager *pool)
+/*
+    Finds the chunk whose data (MEM_POOL_MAP_DATA), MemoryPoolBlocks
+    (MEM_POOL_MAP_BLOCKS) or block indexes (MEM_POOL_MAP_INDEX) hold
+    "address", checking the first chunk before the chunk map. Returns NULL
+    if no chunk does. Takes no lock.
+*/
+static MemoryPoolChunk* MemPoolLookupChunk(MemoryPoolManager *pool, uint64_t kind,
+                                           uintptr_t address)
 {
-    if (pool == NULL)
+    int range = MemPoolMapKind(kind);
+    uintptr_t ranges[MEM_POOL_MAP_KINDS][2];
+
+    MemPoolChunkRanges(pool, pool -> chunks, ranges);
+
+    if (address >= ranges[range][0] && address < ranges[range][1])
     {
-        return;
+        return pool -> chunks;
+    }
+
+    MemoryPoolChunkMap *map = atomic_load_explicit(&pool -> chunkMap, memory_order_acquire);
+
+    if (map == NULL)
+    {
+        return NULL;
     }
 
-    MemoryPoolBlock *current = pool -> head;
+    uint64_t key = kind | ((address >> map -> shifts[range]) & MEM_POOL_MAP_WINDOW_MASK);
 
-    while (current != NULL)
+    for (size_t slot = MemPoolMapSlot(map, key); ; slot = (slot + 1) & (map -> capacity - 1))
     {
-        PrintBlock(current);
-        current = current -> next;
+        uint64_t found = atomic_load_explicit(&map -> entries[slot].key, memory_order_acquire);
+
+        if (found == 0)
+        {
+            return NULL;
+        }
+
+        if (found != key)
+        {
+            continue;
+        }
+
+        MemoryPoolChunk *chunk = atomic_load_explicit(&map -> entries[slot].chunk,
+                                                      memory_order_relaxed);
+        MemPoolChunkRanges(pool, chunk, ranges);
+
+        if (address >= ranges[range][0] && address < ranges[range][1])
+        {
+            return chunk;
+        }
+    }
+}
+
+/*
+    Links a freshly created chunk onto the end of the pool's chunk list and
+    adds its blocks to the pool's totals. Every chunk after the first goes
+    into the chunk map first, which is the only part that can fail, in
+    which case the chunk isn't linked and belongs to the caller again.
+
+    Callers must hold "depotLock" if the pool is shared between threads.
+*/
+static MemoryPoolStatus MemPoolLinkChunk(MemoryPoolManager *pool, MemoryPoolChunk *chunk)
+{
+    chunk -> firstIndex = pool -> memoryBlockCount;
+    atomic_init(&chunk -> nextChunk, NULL);
+
+    if (pool -> lastChunk != NULL && MemPoolMapChunk(pool, chunk) != MEMORY_POOL_OK)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    if (pool -> lastChunk == NULL)
+    {
+        pool -> chunks = chunk;
+        pool -> head = chunk -> blocks;
+        pool -> start = chunk -> start;
+    }
+    else
+    {
+        atomic_store_explicit(&pool -> lastChunk -> nextChunk, chunk, memory_order_release);
+    }
+
+    pool -> lastChunk = chunk;
+    pool -> memoryBlockCount += chunk -> blockCount;
+    pool -> poolSize += pool -> memoryBlockSize * chunk -> blockCount;
+    return MEMORY_POOL_OK;
+}
+
+//  Frees everything a chunk owns, and the chunk itself.
+static void MemPoolFreeChunk(MemoryPoolManager *pool, MemoryPoolChunk *chunk)
+{
+    MemPoolFreeChunkData(pool, chunk -> start, chunk -> mappedSize);
+    free(chunk -> blocks);
+    free(chunk -> occupancy);
+    free(chunk -> dirty);
+    free(chunk -> generations);
+    free(chunk);
+}
+
+/*
+    The bitmap layout's version of MemPoolAddChunkData. Instead of an array
+    of MemoryPoolBlocks, the chunk gets a zeroed bitmap (every block free).
+
+    If the block count isn't a multiple of 64, the last word has bits that
+    don't belong to any block. We set those "padding" bits to 1 up front so
+    they look permanently allocated and the search never hands them out.
+*/
+static MemoryPoolStatus MemPoolAddBitmapChunk(MemoryPoolManager *pool, MemoryPoolChunk *chunk,
+                                              long int blockCount, void *start,
+                                              size_t mappedSize)
+{
+    long int words = MemPoolBitmapWords(blockCount);
+    uint64_t *occupancy = (uint64_t*) calloc(words, sizeof(uint64_t));
+    uint64_t *dirty = NULL;
+    uint8_t *generations = (uint8_t*) calloc(blockCount, sizeof(uint8_t));
+
+    if (pool -> zeroing == MEMORY_POOL_ZERO_LAZY)
+    {
+        dirty = (uint64_t*) calloc(words, sizeof(uint64_t));
+    }
+
+    if (chunk == NULL || occupancy == NULL || generations == NULL || start == NULL ||
+        (pool -> zeroing == MEMORY_POOL_ZERO_LAZY && dirty == NULL))
+    {
+        printf("Unable To Allocate Memory For The Pool\n");
+        free(chunk);
+        free(occupancy);
+        free(dirty);
+        free(generations);
+        MemPoolFreeChunkData(pool, start, mappedSize);
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    int usedBits = (int)(blockCount % 64);
+
+    if (usedBits != 0)
+    {
+        occupancy[words - 1] = ~(uint64_t) 0 << usedBits;
+    }
+
+    chunk -> occupancy = occupancy;
+    chunk -> dirty = dirty;
+    chunk -> generations = generations;
+    chunk -> start = start;
+    chunk -> mappedSize = mappedSize;
+    chunk -> blockCount = blockCount;
+    chunk -> searchWord = 0;
+
+    if (MemPoolLinkChunk(pool, chunk) != MEMORY_POOL_OK)
+    {
+        MemPoolFreeChunk(pool, chunk);
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Adds a new chunk of "blockCount" blocks to the pool, with its data in
+    "start" (which the chunk takes ownership of, even if this fails), and
+    pushes all of them onto the free list.
+
+    Each chunk is made of two allocations: an array of MemoryPoolBlocks to
+    track the blocks, and a single contiguous piece of memory that holds the
+    blocks' data. The very first chunk is created by MemPoolInitWithConfig,
+    and a growable pool adds more chunks when it runs out of blocks. Chunks
+    are never moved or freed until the pool is destroyed, so every block
+    pointer handed out stays valid no matter how much the pool grows.
+
+    Callers must hold "depotLock" if the pool is shared between threads.
+*/
+static MemoryPoolStatus MemPoolAddChunkData(MemoryPoolManager *pool, long int blockCount,
+                                            void *start, size_t mappedSize)
+{
+    size_t memBlockSize = pool -> memoryBlockSize;
+
+    MemoryPoolChunk *chunk = (MemoryPoolChunk*) calloc(1, sizeof(MemoryPoolChunk));
+
+    if (pool -> layout == MEMORY_POOL_LAYOUT_BITMAP)
+    {
+        return MemPoolAddBitmapChunk(pool, chunk, blockCount, start, mappedSize);
+    }
+
+    //   Allocate memory for each block. This will be a single contiguous block
+    //   for each block. Each MemoryPoolBlock is a structure that represents
+    //   a block of data that is comparable to calling "malloc"
+    MemoryPoolBlock *blocks = (MemoryPoolBlock*) malloc(sizeof(MemoryPoolBlock) * 
+                                                        blockCount);
+
+    //  Every block's generation starts at zero (see MemoryPoolHandle).
+    uint8_t *generations = (uint8_t*) calloc(blockCount, sizeof(uint8_t));
+
+    //  Catch any instances where there is not enough memory to allocate the
+    //  Memory Pool Blocks or the memory we'll use to store data in the blocks.
+    //  Make sure we hand back anything we did manage to allocate so a failed
+    //  allocation doesn't leak!
+    if (chunk == NULL || blocks == NULL || generations == NULL || start == NULL)
+    {
+        printf("Unable To Allocate Memory For The Pool\n");
+        free(chunk);
+        free(blocks);
+        free(generations);
+        MemPoolFreeChunkData(pool, start, mappedSize);
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    /*
+        We need to point each MemoryBlock to the starting address of each
+        chunk of memory it is managing in the single block of allocated
+        memory we set up in "start".
+
+        Block "i" manages the memory starting "i * memBlockSize" bytes into
+        "start" (plus room for the guard bytes in debug builds, which
+        MemPoolSlotData works out for us).
+
+        We also link every block into the free list. As nothing in the chunk
+        has been allocated yet, every block is free, so block "i" simply
+        points to block "i + 1". This means the chunk hands its blocks out
+        in address order, starting at the front of the chunk.
+    */
+    for (long int i = 0; i < blockCount; i++)
+    {
+        MemoryPoolBlock *currentBlock = &blocks[i];
+
+        currentBlock -> data = MemPoolSlotData(pool, start, i);
+        currentBlock -> size = memBlockSize; 
+        currentBlock -> isAlloc = false;
+        currentBlock -> isDirty = false;
+
+        /*  
+            If i is equal to the last memory block (if we zero out our block
+            count), we are at the end of the chunk's blocks. Therefore link
+            the last block to whatever was already on the free list (NULL for
+            the first chunk), so we know when we've run out of free blocks.
+        */
+        currentBlock -> next = (i == blockCount - 1) ? pool -> freeList : &blocks[i + 1];
+    }
+
+    chunk -> blocks = blocks;
+    chunk -> generations = generations;
+    chunk -> start = start;
+    chunk -> mappedSize = mappedSize;
+    chunk -> blockCount = blockCount;
+
+    //  Only hand the blocks out once the chunk is linked in, so they can
+    //  always be found again when they are freed.
+    if (MemPoolLinkChunk(pool, chunk) != MEMORY_POOL_OK)
+    {
+        MemPoolFreeChunk(pool, chunk);
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    pool -> freeList = blocks;
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Adds a new chunk of "blockCount" blocks, with freshly allocated data, to
+    the pool. Allocate the chunk of memory to be managed by the pool. Void
+    ptr: Just store the address of where our pool of memory starts.
+*/
+static MemoryPoolStatus MemPoolAddChunk(MemoryPoolManager *pool, long int blockCount)
+{
+    size_t mappedSize;
+    void *start = MemPoolAllocChunkData(pool, blockCount, &mappedSize);
+
+    if (start == NULL)
+    {
+        printf("Unable To Allocate Memory For The Pool\n");
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+#ifdef MEM_POOL_DEBUG
+    MemPoolDebugFillChunk(pool, start, blockCount);
+#endif
+
+    return MemPoolAddChunkData(pool, blockCount, start, mappedSize);
+}
+
+/*
+    Called when a growable pool's free list is empty. The new chunk is
+    "growthFactor" times the size of the last one (so a factor of 2 doubles
+    the pool's capacity every time), but never takes the pool past its hard
+    cap of "maxBlockCount" blocks. As the factor is at least 1, only the
+    chunk that reaches the cap can be smaller than the first one, which
+    keeps the chunk map small (see MemPoolMapChunk).
+
+    Callers must hold "depotLock" if the pool is shared between threads.
+*/
+static MemoryPoolStatus MemPoolGrow(MemoryPoolManager *pool)
+{
+    if (!pool -> growable)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    long int blockCount = (long int)(pool -> lastChunk -> blockCount * pool -> growthFactor);
+
+    if (blockCount < 1)
+    {
+        blockCount = 1;
+    }
+
+    if (pool -> maxBlockCount > 0 && 
+        blockCount > pool -> maxBlockCount - pool -> memoryBlockCount)
+    {
+        blockCount = pool -> maxBlockCount - pool -> memoryBlockCount;
+    }
+
+    if (blockCount <= 0)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    return MemPoolAddChunk(pool, blockCount);
+}
+
+/*
+    A pool image part way through being loaded (see MemPoolLoad). The block
+    data has either been mapped from the file already ("start") or is still
+    to be read from "file". "occupancy" has a bit per block, set if the
+    block was in use, and "generations" a byte per block.
+*/
+typedef struct MemoryPoolImage
+{
+    FILE *file;
+    void *start;
+    size_t mappedSize;
+    size_t dataSize;
+    size_t blockStride;
+    size_t dataOffset;
+    uint64_t *occupancy;
+    uint8_t *generations;
+} MemoryPoolImage;
+
+static MemoryPoolStatus MemPoolRestoreImage(MemoryPoolManager *pool, MemoryPoolImage *image);
+
+/*
+    Creates a pool from "config". When "image" isn't NULL, the first chunk
+    is built from the image's data and the image's state restored on top of
+    it once everything else is set up.
+*/
+static MemoryPoolStatus MemPoolCreate(MemoryPoolManager **pool, const MemoryPoolConfig *config,
+                                      MemoryPoolImage *image)
+{
+    if (pool == NULL || config == NULL || config -> memoryBlockCount <= 0 ||
+        config -> memoryBlockSize == 0)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    if (config -> threading == MEMORY_POOL_THREAD_CACHED && 
+        config -> magazineSize <= 0)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    //  The lock-free list packs a block index into 32 bits, and works on a
+    //  single, fixed chunk of blocks.
+    if (config -> threading == MEMORY_POOL_LOCK_FREE &&
+        ((uint64_t) config -> memoryBlockCount >= UINT32_MAX || config -> growable))
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    //  The bitmap is guarded by the depot lock, so there's no per-thread or
+    //  lock-free version of it.
+    if (config -> layout == MEMORY_POOL_LAYOUT_BITMAP &&
+        config -> threading != MEMORY_POOL_SINGLE_THREADED &&
+        config -> threading != MEMORY_POOL_LOCKED)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    //  Alignments must be powers of two, and no bigger than a page.
+    if (config -> alignment > MEM_POOL_MAX_ALIGNMENT ||
+        (config -> alignment & (config -> alignment - 1)) != 0)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    if (config -> growable && (config -> growthFactor < 1.0 ||
+        (config -> maxBlockCount > 0 && config -> maxBlockCount < config -> memoryBlockCount)))
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    /*  
+        Allocate memory for the pool itself. 
+        
+        We need to use a ptr to a ptr 
+        here so we don't end up with a dangling pointer! Remember, the local
+        pool variable only has scope for this function! If we just use a 
+        pointer, we assign the malloced pointer that refers to our new
+        MemoryPoolManager to the LOCAL VARIABLE and not the original pointer
+        in the calling code. This pointer then goes out of scope and we end
+        up with a memory leak, thus we dereference a pointer which pointers
+        to the address of a pointer in the calling code so we can directly
+        assign the value of our new pointer to that variable. 
+
+        We use calloc here so every member starts off zeroed (and every
+        pointer NULL). That way, if anything below fails, MemPoolDestroy can
+        safely clean up whatever was set up so far.
+    */
+    *pool = (MemoryPoolManager*) calloc(1, sizeof(MemoryPoolManager));
+
+    if (*pool == NULL)
+    {
+        printf("Unable To Allocate Memory For The Pool\n");
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    /*  
+        Update the pool metadata including how big each block is, how the
+        pool is shared between threads and whether it may grow. The number
+        of blocks and the total amount of memory used in the memory pool
+        (i.e. cumulative total of all the blocks) are added up as each chunk
+        of blocks is created.
+    */
+    (*pool) -> memoryBlockSize = config -> memoryBlockSize;
+    (*pool) -> growable = config -> growable;
+    (*pool) -> growthFactor = config -> growthFactor;
+    (*pool) -> maxBlockCount = config -> maxBlockCount;
+    (*pool) -> layout = config -> layout;
+    (*pool) -> zeroing = config -> zeroing;
+    (*pool) -> backing = config -> backing;
+    (*pool) -> hugePages = config -> hugePages;
+    (*pool) -> prefault = config -> prefault;
+    MemPoolSetLayout(*pool, config -> alignment, config -> cacheLinePadding);
+
+    /*
+        Set up the synchronisation for the pool's threading mode. The mutex
+        is always created (it's cheap) so that MemPoolDestroy doesn't have
+        to care which mode we are in. Only the thread cached mode needs a
+        thread specific key, which each thread uses to find its own magazine.
+        The key's destructor hands a thread's cached blocks back to the depot
+        when that thread exits, so they aren't lost to the pool.
+    */
+    (*pool) -> threading = MEMORY_POOL_SINGLE_THREADED;
+    (*pool) -> magazineSize = config -> magazineSize;
+    pthread_mutex_init(&(*pool) -> depotLock, NULL);
+    atomic_init(&(*pool) -> lockFreeHead, 0);
+    pthread_mutex_init(&(*pool) -> pressureLock, NULL);
+
+    MemoryPoolStatus status;
+
+    if (image != NULL && image -> start != NULL)
+    {
+        //  The chunk owns the mapping from here on, whether or not this works.
+        status = MemPoolAddChunkData(*pool, config -> memoryBlockCount, image -> start,
+                                     image -> mappedSize);
+        image -> start = NULL;
+
+        if (status == MEMORY_POOL_OK)
+        {
+            (*pool) -> chunks -> fromImage = true;
+        }
+    }
+    else
+    {
+        status = MemPoolAddChunk(*pool, config -> memoryBlockCount);
+    }
+
+    if (status != MEMORY_POOL_OK)
+    {
+        MemPoolDestroy(*pool);
+        *pool = NULL;
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    if (config -> threading == MEMORY_POOL_THREAD_CACHED &&
+        pthread_key_create(&(*pool) -> magazineKey, MemPoolReleaseMagazine) != 0)
+    {
+        printf("Unable To Create The Pool's Thread Cache\n");
+        MemPoolDestroy(*pool);
+        *pool = NULL;
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    //  Only switch to the requested mode once everything it needs exists, so
+    //  MemPoolDestroy never tries to tear down a key that was never created.
+    (*pool) -> threading = config -> threading;
+
+    /*
+        A lock-free pool keeps its free list as block indexes instead, using
+        the same starting order as the pointer based list above: block "i"
+        links to block "i + 1" and block 0 is at the top of the stack.
+    */
+    if (config -> threading == MEMORY_POOL_LOCK_FREE)
+    {
+        long int memBlockCount = (*pool) -> memoryBlockCount;
+
+        (*pool) -> lockFreeNext = (_Atomic uint32_t*) malloc(sizeof(_Atomic uint32_t) *
+                                                             memBlockCount);
+
+        if ((*pool) -> lockFreeNext == NULL)
+        {
+            printf("Unable To Allocate Memory For The Pool\n");
+            MemPoolDestroy(*pool);
+            *pool = NULL;
+            return MEMORY_POOL_INIT_ERROR;
+        }
+
+        for (long int i = 0; i < memBlockCount; i++)
+        {
+            uint32_t next = (i == memBlockCount - 1) ? 0 : (uint32_t)(i + 2);
+            atomic_init(&(*pool) -> lockFreeNext[i], next);
+        }
+
+        (*pool) -> freeList = NULL;
+        atomic_store(&(*pool) -> lockFreeHead, 1);
+    }
+
+    if (image != NULL)
+    {
+        status = MemPoolRestoreImage(*pool, image);
+
+        if (status != MEMORY_POOL_OK)
+        {
+            MemPoolDestroy(*pool);
+            *pool = NULL;
+            return status;
+        }
+    }
+
+    return MEMORY_POOL_OK;
+}
+
+MemoryPoolStatus MemPoolInitWithConfig(MemoryPoolManager **pool,
+                                       const MemoryPoolConfig *config)
+{
+    return MemPoolCreate(pool, config, NULL);
+}
+
+/*
+    Perform clean up on our Memory Pool Manaager and ensure all components
+    are cleaned up correctly in order to prevent a memory leak.
+
+    This method must be called in order to properly deallocate all memory
+    associated with the memory pool manager.
+
+    As the memory pool manager is made up of several components that have
+    all been dynamically allocated, all of them need to be freed to avoid
+    a memory leak.
+
+    These components are:
+
+        - For every chunk, the block of memory responsible for storing each
+          blocks data as a single contiguous block of memory.
+
+        - For every chunk, the block of memory responsible for storing each
+          MemoryBlock struct and it's associated meta-data, plus the chunk
+          itself.
+
+        - The Memory pool itself, a struct used for tracking the chunks and
+          the free list as well as how many/how big each Memory Block should
+          be in the pool.
+
+    A thread cached pool also owns one magazine per thread that has used it.
+    Deleting the thread specific key first stops any thread that exits
+    later from trying to hand its magazine back to a pool that no longer
+    exists. No other thread may be using the pool while it is destroyed.
+*/
+MemoryPoolStatus MemPoolDestroy(MemoryPoolManager *pool)
+{
+    if (pool == NULL)
+    {
+        return MEMORY_POOL_OK;
+    }
+
+    if (pool -> threading == MEMORY_POOL_THREAD_CACHED)
+    {
+        pthread_key_delete(pool -> magazineKey);
+
+        MemoryPoolMagazine *magazine = pool -> magazines;
+
+        while (magazine != NULL)
+        {
+            MemoryPoolMagazine *nextMagazine = magazine -> nextMagazine;
+            free(magazine -> blocks);
+            free(magazine);
+            magazine = nextMagazine;
+        }
+    }
+
+    MemoryPoolChunk *chunk = pool -> chunks;
+
+    while (chunk != NULL)
+    {
+        MemoryPoolChunk *nextChunk = chunk -> nextChunk;
+        MemPoolFreeChunk(pool, chunk);
+        chunk = nextChunk;
+    }
+
+    MemoryPoolChunkMap *map = pool -> chunkMap;
+
+    while (map != NULL)
+    {
+        MemoryPoolChunkMap *retired = map -> retired;
+        free(map -> entries);
+        free(map);
+        map = retired;
+    }
+
+    pthread_mutex_destroy(&pool -> depotLock);
+    pthread_mutex_destroy(&pool -> pressureLock);
+    free((void*) pool -> lockFreeNext);
+    free(pool);
+
+    return MEMORY_POOL_OK;
+}
+
+//  True if block "slot" of "chunk" isn't allocated, in either layout.
+static bool MemPoolSlotIsFree(MemoryPoolManager *pool, MemoryPoolChunk *chunk, long int slot)
+{
+    if (pool -> layout == MEMORY_POOL_LAYOUT_BITMAP)
+    {
+        return ((chunk -> occupancy[slot / 64] >> (slot % 64)) & 1) == 0;
+    }
+
+    return !chunk -> blocks[slot].isAlloc;
+}
+
+#ifndef MEM_POOL_DEBUG
+/*
+    Throws away the physical pages behind a range of a mapped chunk. The
+    addresses stay valid: the next time they are touched, the operating
+    system maps in fresh zeroed pages.
+
+    A chunk mapped from a pool image would get the file's contents back
+    rather than zeros, so there we map fresh anonymous pages over the range
+    instead.
+*/
+static void MemPoolReleasePages(MemoryPoolChunk *chunk, void *start, size_t size)
+{
+#if defined(_WIN32)
+    VirtualFree(start, size, MEM_DECOMMIT);
+    VirtualAlloc(start, size, MEM_COMMIT, PAGE_READWRITE);
+#else
+    if (chunk -> fromImage)
+    {
+        mmap(start, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+             -1, 0);
+        return;
+    }
+
+    madvise(start, size, MADV_DONTNEED);
+#endif
+}
+#endif
+
+/*
+    A pool never shrinks on its own. Once a burst of activity is over, its
+    free blocks still hold on to all the memory they used at the peak. For
+    a MEMORY_POOL_BACKING_MMAP pool, MemPoolTrim hands the pages behind the
+    free blocks back to the operating system.
+
+    Only pages that lie entirely within a run of free blocks can go, so a
+    single allocated block keeps its own pages. Every block stays where it
+    is, so nothing the caller holds is invalidated, and free blocks simply
+    come back as zeros when they are next used (which suits every zeroing
+    policy). "releasedBytes", if it isn't NULL, is set to the size of the
+    address range released, whether or not it had been touched yet.
+
+    Heap backed pools can't give memory back piecemeal, so trimming them
+    does nothing. Neither do debug builds, as releasing the pages would wipe
+    the poison that catches writes after free.
+
+    Like MemPoolDestroy, no other thread may be using the pool at the time.
+*/
+MemoryPoolStatus MemPoolTrim(MemoryPoolManager *pool, size_t *releasedBytes)
+{
+    size_t released = 0;
+
+    if (releasedBytes != NULL)
+    {
+        *releasedBytes = 0;
+    }
+
+    if (pool == NULL)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+#ifndef MEM_POOL_DEBUG
+    if (pool -> backing == MEMORY_POOL_BACKING_MMAP)
+    {
+        uintptr_t pageMask = ~(uintptr_t)(MemPoolPageSize() - 1);
+        size_t stride = MemPoolStride(pool);
+
+        for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL;
+             chunk = chunk -> nextChunk)
+        {
+            uintptr_t start = (uintptr_t) chunk -> start;
+            long int slot = 0;
+
+            while (slot < chunk -> blockCount)
+            {
+                if (!MemPoolSlotIsFree(pool, chunk, slot))
+                {
+                    slot++;
+                    continue;
+                }
+
+                long int end = slot;
+
+                while (end < chunk -> blockCount && MemPoolSlotIsFree(pool, chunk, end))
+                {
+                    end++;
+                }
+
+                //  A run that reaches the end of the chunk takes the slack
+                //  left over from rounding the mapping up to whole pages.
+                uintptr_t from = (start + slot * stride + ~pageMask) & pageMask;
+                uintptr_t to = end == chunk -> blockCount ? start + chunk -> mappedSize :
+                                                            (start + end * stride) & pageMask;
+
+                if (to > from)
+                {
+                    MemPoolReleasePages(chunk, (void*) from, to - from);
+                    released += to - from;
+                }
+
+                slot = end;
+            }
+        }
+    }
+#endif
+
+    if (releasedBytes != NULL)
+    {
+        *releasedBytes = released;
+    }
+
+    return MEMORY_POOL_OK;
+}
+
+/*
+    The two basic free list operations. Popping takes the block at the
+    front of the free list and pushing puts a block back on the front.
+    Neither does any locking; callers must hold "depotLock" if the pool is
+    shared between threads.
+*/
+static MemoryPoolBlock* MemPoolPopFreeBlock(MemoryPoolManager *pool)
+{
+    MemoryPoolBlock *current = pool -> freeList;
+
+    if (current != NULL)
+    {
+        pool -> freeList = current -> next;
+        current -> next = NULL;
+    }
+
+    return current;
+}
+
+static void MemPoolPushFreeBlock(MemoryPoolManager *pool, MemoryPoolBlock *block)
+{
+    block -> next = pool -> freeList;
+    pool -> freeList = block;
+}
+
+/*
+    The lock-free versions of popping and pushing a free block.
+
+    Both read the current head, work out what the new head should be, then
+    use compare-and-swap to install it only if the head hasn't changed in the
+    meantime. If another thread got there first, the swap fails, "head" is
+    refreshed with the latest value and we simply try again.
+
+    The low 32 bits of the head are the top block's index plus one (zero
+    meaning the stack is empty) and the high 32 bits are the ABA tag, which
+    goes up by one on every successful swap.
+*/
+static MemoryPoolBlock* MemPoolPopFreeBlockLockFree(MemoryPoolManager *pool)
+{
+    uint64_t head = atomic_load(&pool -> lockFreeHead);
+    uint64_t newHead;
+    uint32_t top;
+
+    do
+    {
+        top = (uint32_t) head;
+
+        if (top == 0)
+        {
+            return NULL;
+        }
+
+        uint32_t next = atomic_load(&pool -> lockFreeNext[top - 1]);
+        newHead = ((head >> 32) + 1) << 32 | next;
+    } 
+    while (!atomic_compare_exchange_weak(&pool -> lockFreeHead, &head, newHead));
+
+    return &pool -> head[top - 1];
+}
+
+/*
+    Pushes a run of blocks, already linked together through "lockFreeNext"
+    from block "first" down to block "last", onto the stack in one swap.
+    Only the last block's link has to point at the old head, so a run costs
+    the same single compare-and-swap as one block.
+*/
+static void MemPoolPushFreeRunLockFree(MemoryPoolManager *pool, long int first, long int last)
+{
+    uint64_t head = atomic_load(&pool -> lockFreeHead);
+    uint64_t newHead;
+
+    do
+    {
+        atomic_store(&pool -> lockFreeNext[last], (uint32_t) head);
+        newHead = ((head >> 32) + 1) << 32 | (uint64_t)(first + 1);
+    } 
+    while (!atomic_compare_exchange_weak(&pool -> lockFreeHead, &head, newHead));
+}
+
+static void MemPoolPushFreeBlockLockFree(MemoryPoolManager *pool, long int index)
+{
+    MemPoolPushFreeRunLockFree(pool, index, index);
+}
+
+/*
+    Finds the calling thread's magazine for a thread cached pool, creating
+    an empty one the first time a thread uses the pool.
+*/
+static MemoryPoolMagazine* MemPoolGetMagazine(MemoryPoolManager *pool)
+{
+    MemoryPoolMagazine *magazine = pthread_getspecific(pool -> magazineKey);
+
+    if (magazine != NULL)
+    {
+        return magazine;
+    }
+
+    magazine = (MemoryPoolMagazine*) malloc(sizeof(MemoryPoolMagazine));
+
+    if (magazine == NULL)
+    {
+        return NULL;
+    }
+
+    magazine -> blocks = (MemoryPoolBlock**) malloc(sizeof(MemoryPoolBlock*) * 
+                                                    pool -> magazineSize * 2);
+
+    if (magazine -> blocks == NULL)
+    {
+        free(magazine);
+        return NULL;
+    }
+
+    magazine -> pool = pool;
+    magazine -> count = 0;
+
+    pthread_mutex_lock(&pool -> depotLock);
+    magazine -> nextMagazine = pool -> magazines;
+    pool -> magazines = magazine;
+    pthread_mutex_unlock(&pool -> depotLock);
+
+    pthread_setspecific(pool -> magazineKey, magazine);
+    return magazine;
+}
+
+/*
+    Called by pthreads when a thread that owns a magazine exits. Every block
+    still sitting in the magazine is pushed back onto the depot and the
+    magazine itself is unlinked from the pool and freed.
+*/
+static void MemPoolReleaseMagazine(void *magazinePtr)
+{
+    MemoryPoolMagazine *magazine = (MemoryPoolMagazine*) magazinePtr;
+    MemoryPoolManager *pool = magazine -> pool;
+
+    pthread_mutex_lock(&pool -> depotLock);
+
+    for (int i = 0; i < magazine -> count; i++)
+    {
+        MemPoolPushFreeBlock(pool, magazine -> blocks[i]);
+    }
+
+    MemoryPoolMagazine **link = &pool -> magazines;
+
+    while (*link != NULL && *link != magazine)
+    {
+        link = &(*link) -> nextMagazine;
+    }
+
+    if (*link == magazine)
+    {
+        *link = magazine -> nextMagazine;
+    }
+
+    pthread_mutex_unlock(&pool -> depotLock);
+
+    free(magazine -> blocks);
+    free(magazine);
+}
+
+/*
+    Clears a block that is being handed out by MemPoolAllocZeroed, unless
+    the pool's zeroing policy means it is already clean: every free block of
+    an eager pool has been zeroed, and a lazy pool's blocks are still zero
+    until they are first handed out ("dirty"). Debug builds zero every
+    block they hand out anyway, so they don't need this.
+*/
+#ifndef MEM_POOL_DEBUG
+static void MemPoolZeroForAlloc(MemoryPoolManager *pool, void *data, bool dirty)
+{
+    if (pool -> zeroing == MEMORY_POOL_ZERO_NONE ||
+        (pool -> zeroing == MEMORY_POOL_ZERO_LAZY && dirty))
+    {
+        memset(data, 0, pool -> memoryBlockSize);
+    }
+}
+#endif
+
+/*
+    Marks a block that has just been taken off the free list as allocated,
+    checking (debug builds) or zeroing it (if "zeroed") on the way out. This
+    needs no lock, as nobody else can reach a block once it is off the free
+    list.
+*/
+static void MemPoolHandOutBlock(MemoryPoolManager *pool, MemoryPoolBlock *block, bool zeroed)
+{
+    block -> isAlloc = true;
+
+#ifdef MEM_POOL_DEBUG
+    (void) zeroed;
+    MemPoolDebugCheckAlloc(pool, block -> data);
+#else
+    if (zeroed)
+    {
+        MemPoolZeroForAlloc(pool, block -> data, block -> isDirty);
+    }
+#endif
+
+    block -> isDirty = true;
+}
+
+/*
+    Pop the first block off the pool's free list, mark it as allocated and
+    then set the block pointer to the newly allocated block in the memory
+    pool.
+
+    Note how no calls to malloc take place here! Memory allocation is done by
+    unlinking a node from a list we already own! So there are no system calls
+    made! This is the power of a memory pool!
+
+    As we always take the block at the head of the free list, we never need
+    to search for a free block, so allocation takes constant (O(1)) time no
+    matter how many blocks the pool holds.
+
+    How we get at the free list depends on the pool's threading mode. A
+    single threaded pool just pops it, a locked pool pops it whilst holding
+    the depot lock, and a thread cached pool pops from the calling thread's
+    magazine, only visiting the depot to refill the magazine with a whole
+    batch of blocks once it runs dry. A lock-free pool pops its stack with
+    a compare-and-swap.
+
+    Bitmap pools don't have MemoryPoolBlocks, so they must be used through
+    MemPoolAllocData instead.
+
+    If every block has already been handed out, the free list is empty. A
+    growable pool then adds another chunk of blocks and carries on, but a
+    fixed pool (or one that has reached its cap) reports an allocation
+    error rather than handing back garbage.
+*/
+static MemoryPoolStatus MemPoolAllocUntracked(MemoryPoolManager *pool, MemoryPoolBlock **block,
+                                              bool zeroed)
+{
+    if (pool == NULL || block == NULL || pool -> layout != MEMORY_POOL_LAYOUT_BLOCK_LIST)
+    {
+        printf("Memory Pool Alloc Error\n");
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    MemoryPoolBlock *current = NULL;
+
+    switch (pool -> threading)
+    {
+        case MEMORY_POOL_SINGLE_THREADED:
+            if (pool -> freeList != NULL || MemPoolGrow(pool) == MEMORY_POOL_OK)
+            {
+                current = MemPoolPopFreeBlock(pool);
+            }
+            break;
+
+        case MEMORY_POOL_LOCKED:
+            pthread_mutex_lock(&pool -> depotLock);
+
+            if (pool -> freeList != NULL || MemPoolGrow(pool) == MEMORY_POOL_OK)
+            {
+                current = MemPoolPopFreeBlock(pool);
+            }
+
+            pthread_mutex_unlock(&pool -> depotLock);
+            break;
+
+        case MEMORY_POOL_THREAD_CACHED:
+        {
+            MemoryPoolMagazine *magazine = MemPoolGetMagazine(pool);
+
+            if (magazine == NULL)
+            {
+                break;
+            }
+
+            if (magazine -> count == 0)
+            {
+                pthread_mutex_lock(&pool -> depotLock);
+
+                if (pool -> freeList == NULL)
+                {
+                    MemPoolGrow(pool);
+                }
+
+                while (magazine -> count < pool -> magazineSize && 
+                       pool -> freeList != NULL)
+                {
+                    magazine -> blocks[magazine -> count++] = MemPoolPopFreeBlock(pool);
+                }
+
+                pthread_mutex_unlock(&pool -> depotLock);
+            }
+
+            if (magazine -> count > 0)
+            {
+                current = magazine -> blocks[--magazine -> count];
+            }
+            break;
+        }
+
+        case MEMORY_POOL_LOCK_FREE:
+            current = MemPoolPopFreeBlockLockFree(pool);
+            break;
+    }
+
+    if (current == NULL)
+    {
+        *block = NULL;
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    //  Set the pointer to the memory block that was passed in to point to the
+    //  block that was just taken.
+    MemPoolHandOutBlock(pool, current, zeroed);
+
+    *block = current;
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Works out which chunk (and which slot in that chunk) a block lives in
+    directly from its address, rather than searching the blocks for it.
+
+    As every chunk's MemoryPoolBlocks live in one array, a block belongs to
+    a chunk only if its address falls inside that array AND sits exactly on
+    the boundary of one of its elements. Pointer comparisons between
+    unrelated objects are not defined by the standard, so we compare the
+    addresses as plain integers (uintptr_t) instead.
+
+    A fixed pool only ever has one chunk, so this is a single range check.
+    A growable pool that has added chunks finds the rest through its chunk
+    map, which costs the same however many chunks there are (see
+    MemPoolMapChunk). Neither takes a lock.
+
+    Returns the block's chunk and sets "index" to its position in the pool
+    as a whole, or returns NULL if the block isn't one of ours.
+*/
+static MemoryPoolChunk* MemPoolFindChunk(MemoryPoolManager *pool, MemoryPoolBlock *block,
+                                         long int *index)
+{
+    uintptr_t address = (uintptr_t) block;
+    MemoryPoolChunk *chunk = MemPoolLookupChunk(pool, MEM_POOL_MAP_BLOCKS, address);
+
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+
+    uintptr_t offset = address - (uintptr_t) chunk -> blocks;
+
+    if (offset % sizeof(MemoryPoolBlock) != 0)
+    {
+        return NULL;
+    }
+
+    *index = chunk -> firstIndex + (long int)(offset / sizeof(MemoryPoolBlock));
+    return chunk;
+}
+
+/*
+    The same trick as MemPoolFindChunk, but working from the address of a
+    block's data rather than the block itself. Every block's data lives in
+    its chunk's single allocation starting at "start", one stride (see
+    MemPoolSetLayout) apart, so the offset from the first block's data tells
+    us exactly which block owns it.
+
+    Returns the chunk and sets "slot" to the block's position within that
+    chunk, or returns NULL if the address isn't the start of a block.
+*/
+static MemoryPoolChunk* MemPoolFindDataChunk(MemoryPoolManager *pool, void *data,
+                                             long int *slot)
+{
+    uintptr_t address = (uintptr_t) data;
+    MemoryPoolChunk *chunk = MemPoolLookupChunk(pool, MEM_POOL_MAP_DATA, address);
+
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+
+    uintptr_t offset = address - ((uintptr_t) chunk -> start + pool -> dataOffset);
+
+    if (offset % MemPoolStride(pool) != 0)
+    {
+        return NULL;
+    }
+
+    *slot = (long int)(offset / MemPoolStride(pool));
+    return chunk;
+}
+
+/*
+    Finds the MemoryPoolBlock that manages a data pointer. This lets callers
+    that only kept hold of the data pointer hand the memory back. Returns
+    NULL if the address isn't the start of one of this pool's blocks (and
+    always for bitmap pools, which have no MemoryPoolBlocks).
+*/
+MemoryPoolBlock* MemPoolFindBlock(MemoryPoolManager *pool, void *data)
+{
+    if (pool == NULL || data == NULL || pool -> layout != MEMORY_POOL_LAYOUT_BLOCK_LIST)
+    {
+        return NULL;
+    }
+
+    long int slot;
+    MemoryPoolChunk *chunk = MemPoolFindDataChunk(pool, data, &slot);
+
+    return chunk != NULL ? &chunk -> blocks[slot] : NULL;
+}
+
+//  True if "data" is the start of one of this pool's blocks, in any layout.
+bool MemPoolContains(MemoryPoolManager *pool, void *data)
+{
+    long int slot;
+    return pool != NULL && data != NULL && MemPoolFindDataChunk(pool, data, &slot) != NULL;
+}
+
+/*
+    Checks that a block being freed is one of ours and is still allocated,
+    then marks it as free, moves it on to its next generation and scrubs
+    its data. Everything short of putting it back on the free list, so this
+    needs no lock either.
+
+    Returns MEMORY_POOL_OK (or MEMORY_POOL_CORRUPTION_ERROR in debug builds)
+    once the block has been taken back, and sets "index" to its position in
+    the pool. Any other status means the block was rejected and must not go
+    anywhere near the free list.
+*/
+static MemoryPoolStatus MemPoolTakeBackBlock(MemoryPoolManager *pool, MemoryPoolBlock *block,
+                                             long int *index)
+{
+    MemoryPoolChunk *chunk = block == NULL ? NULL : MemPoolFindChunk(pool, block, index);
+
+    if (chunk == NULL)
+    {
+        MEM_POOL_DEBUG_REPORT("Invalid Free", block);
+        return MEMORY_POOL_INVALID_FREE_ERROR;
+    }
+
+    if (block -> isAlloc == false)
+    {
+        MEM_POOL_DEBUG_REPORT("Double Free", block -> data);
+        return MEMORY_POOL_DOUBLE_FREE_ERROR;
+    }
+
+    MemoryPoolStatus status = MEMORY_POOL_OK;
+
+    block -> isAlloc = false;
+    chunk -> generations[*index - chunk -> firstIndex]++;
+
+#ifdef MEM_POOL_DEBUG
+    status = MemPoolDebugCheckFree(pool, block -> data);
+#else
+    if (pool -> zeroing == MEMORY_POOL_ZERO_EAGER)
+    {
+        memset(block -> data, 0, pool -> memoryBlockSize);
+    }
+#endif
+
+    return status;
+}
+
+/*
+    This function looks up the slot of the block that was passed in as the
+    second parameter from its address, then pushes it back onto the front of
+    the pool's free list so it can be handed out again. Like allocating, this
+    takes constant time as no searching of the pool is needed.
+
+    In a thread cached pool the block goes into the calling thread's magazine
+    instead. When the magazine is full, half of it is handed back to the
+    depot in one go so other threads can use those blocks. A lock-free pool
+    pushes the block back onto its stack with a compare-and-swap.
+
+    When freed, the block has it's allocation set to false and, for security,
+    has it's previous stored data zeroed ready for reallocation (unless the
+    pool's zeroing policy says otherwise, see MemoryPoolZeroing). Debug
+    builds poison the data instead, after checking the block's guard bytes.
+
+    Bitmap pools don't have MemoryPoolBlocks, so they must be used through
+    MemPoolFreeData instead.
+
+    Blocks that don't belong to this pool, or that have already been freed,
+    are rejected (as invalid and double frees respectively). Pushing the
+    same block onto the free list twice would corrupt the list and hand the
+    same memory out to two different callers!
+*/
+static MemoryPoolStatus MemPoolFreeUntracked(MemoryPoolManager *pool, MemoryPoolBlock *block)
+{
+    if (pool == NULL || pool -> layout != MEMORY_POOL_LAYOUT_BLOCK_LIST)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    long int index;
+    MemoryPoolStatus status = MemPoolTakeBackBlock(pool, block, &index);
+
+    if (status != MEMORY_POOL_OK && status != MEMORY_POOL_CORRUPTION_ERROR)
+    {
+        return status;
+    }
+
+    MemoryPoolBlock *current = block;
+
+    switch (pool -> threading)
+    {
+        case MEMORY_POOL_SINGLE_THREADED:
+            MemPoolPushFreeBlock(pool, current);
+            break;
+
+        case MEMORY_POOL_LOCKED:
+            pthread_mutex_lock(&pool -> depotLock);
+            MemPoolPushFreeBlock(pool, current);
+            pthread_mutex_unlock(&pool -> depotLock);
+            break;
+
+        case MEMORY_POOL_THREAD_CACHED:
+        {
+            MemoryPoolMagazine *magazine = MemPoolGetMagazine(pool);
+
+            if (magazine == NULL)
+            {
+                pthread_mutex_lock(&pool -> depotLock);
+                MemPoolPushFreeBlock(pool, current);
+                pthread_mutex_unlock(&pool -> depotLock);
+                break;
+            }
+
+            if (magazine -> count == pool -> magazineSize * 2)
+            {
+                pthread_mutex_lock(&pool -> depotLock);
+
+                while (magazine -> count > pool -> magazineSize)
+                {
+                    MemPoolPushFreeBlock(pool, magazine -> blocks[--magazine -> count]);
+                }
+
+                pthread_mutex_unlock(&pool -> depotLock);
+            }
+
+            magazine -> blocks[magazine -> count++] = current;
+            break;
+        }
+
+        case MEMORY_POOL_LOCK_FREE:
+            MemPoolPushFreeBlockLockFree(pool, index);
+            break;
+    }
+
+    return status;
+}
+
+/*
+    Finds a free block in a bitmap pool and marks it as allocated.
+
+    For each chunk we start at "searchWord", the first word that might still
+    have a free bit, and skip over words that are completely full (all 64
+    bits set). In the first word that isn't full, the free blocks are its 0
+    bits, so we flip the word and count its trailing zeros to get the
+    position of the lowest free block. Checking 64 blocks per comparison
+    makes even a long scan over a busy bitmap quick.
+
+    "dirty" is set to whether the block has been handed out before (always
+    true unless the pool uses the MEMORY_POOL_ZERO_LAZY policy).
+
+    Callers must hold "depotLock" if the pool is shared between threads.
+*/
+static void* MemPoolAllocBitmap(MemoryPoolManager *pool, bool *dirty)
+{
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL; chunk = chunk -> nextChunk)
+    {
+        long int words = MemPoolBitmapWords(chunk -> blockCount);
+
+        for (long int w = chunk -> searchWord; w < words; w++)
+        {
+            uint64_t word = chunk -> occupancy[w];
+
+            if (word != UINT64_MAX)
+            {
+                int bit = MemPoolCountTrailingZeros(~word);
+                uint64_t mask = (uint64_t) 1 << bit;
+
+                chunk -> occupancy[w] = word | mask;
+                chunk -> searchWord = w;
+                *dirty = true;
+
+                if (chunk -> dirty != NULL)
+                {
+                    *dirty = (chunk -> dirty[w] & mask) != 0;
+                    chunk -> dirty[w] |= mask;
+                }
+
+                return MemPoolSlotData(pool, chunk -> start, w * 64 + bit);
+            }
+        }
+
+        chunk -> searchWord = words;
+    }
+
+    return NULL;
+}
+
+/*
+    Allocates a block and hands back a pointer to its data, rather than the
+    MemoryPoolBlock that manages it. This works for every layout, and is the
+    only way to allocate from a bitmap pool. If "zeroed" is true, the block
+    is cleared before it is handed out (see MemPoolAllocZeroed).
+*/
+static MemoryPoolStatus MemPoolAllocDataUntracked(MemoryPoolManager *pool, void **data,
+                                                  bool zeroed)
+{
+    if (pool == NULL || data == NULL)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    if (pool -> layout == MEMORY_POOL_LAYOUT_BLOCK_LIST)
+    {
+        MemoryPoolBlock *block;
+        MemoryPoolStatus status = MemPoolAllocUntracked(pool, &block, zeroed);
+
+        *data = status == MEMORY_POOL_OK ? block -> data : NULL;
+        return status;
+    }
+
+    bool locked = pool -> threading == MEMORY_POOL_LOCKED;
+
+    if (locked)
+    {
+        pthread_mutex_lock(&pool -> depotLock);
+    }
+
+    bool dirty = true;
+    void *current = MemPoolAllocBitmap(pool, &dirty);
+
+    if (current == NULL && MemPoolGrow(pool) == MEMORY_POOL_OK)
+    {
+        current = MemPoolAllocBitmap(pool, &dirty);
+    }
+
+    if (locked)
+    {
+        pthread_mutex_unlock(&pool -> depotLock);
+    }
+
+#ifdef MEM_POOL_DEBUG
+    if (current != NULL)
+    {
+        MemPoolDebugCheckAlloc(pool, current);
+    }
+#else
+    if (current != NULL && zeroed)
+    {
+        MemPoolZeroForAlloc(pool, current, dirty);
+    }
+#endif
+
+    *data = current;
+    return current != NULL ? MEMORY_POOL_OK : MEMORY_POOL_ALLOC_ERROR;
+}
+
+/*
+    Hands block "slot" of a bitmap pool's "chunk" back: rejects it if its
+    bit is already clear, otherwise scrubs its data, clears its bit, moves it
+    on to its next generation and moves the chunk's "searchWord" back if
+    needed so the next allocation can find it.
+
+    Callers must hold "depotLock" if the pool is shared between threads.
+*/
+static MemoryPoolStatus MemPoolReleaseBitmapSlot(MemoryPoolManager *pool,
+                                                 MemoryPoolChunk *chunk, long int slot,
+                                                 void *data)
+{
+    long int w = slot / 64;
+    uint64_t mask = (uint64_t) 1 << (slot % 64);
+    MemoryPoolStatus status = MEMORY_POOL_OK;
+
+    if ((chunk -> occupancy[w] & mask) == 0)
+    {
+        MEM_POOL_DEBUG_REPORT("Double Free", data);
+        return MEMORY_POOL_DOUBLE_FREE_ERROR;
+    }
+
+#ifdef MEM_POOL_DEBUG
+    status = MemPoolDebugCheckFree(pool, data);
+#else
+    if (pool -> zeroing == MEMORY_POOL_ZERO_EAGER)
+    {
+        memset(data, 0, pool -> memoryBlockSize);
+    }
+#endif
+    chunk -> occupancy[w] &= ~mask;
+    chunk -> generations[slot]++;
+
+    if (w < chunk -> searchWord)
+    {
+        chunk -> searchWord = w;
+    }
+
+    return status;
+}
+
+/*
+    Frees a block given a pointer to its data. For a bitmap pool, the block's
+    bit is cleared and the chunk's "searchWord" moved back if needed so the
+    next allocation can find the newly freed block. Just like MemPoolFree,
+    the data is zeroed (depending on the zeroing policy, or poisoned in debug
+    builds), and pointers that aren't ours or whose block is already free
+    are rejected.
+*/
+static MemoryPoolStatus MemPoolFreeDataUntracked(MemoryPoolManager *pool, void *data)
+{
+    if (pool == NULL || data == NULL)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    if (pool -> layout == MEMORY_POOL_LAYOUT_BLOCK_LIST)
+    {
+        MemoryPoolBlock *block = MemPoolFindBlock(pool, data);
+
+        if (block == NULL)
+        {
+            MEM_POOL_DEBUG_REPORT("Invalid Free", data);
+            return MEMORY_POOL_INVALID_FREE_ERROR;
+        }
+
+        return MemPoolFreeUntracked(pool, block);
+    }
+
+    bool locked = pool -> threading == MEMORY_POOL_LOCKED;
+
+    //  The chunk is looked up under the lock too, so a thread growing the
+    //  pool can't be halfway through adding the chunk this block lives in.
+    if (locked)
+    {
+        pthread_mutex_lock(&pool -> depotLock);
+    }
+
+    long int slot;
+    MemoryPoolChunk *chunk = MemPoolFindDataChunk(pool, data, &slot);
+    MemoryPoolStatus status = MEMORY_POOL_INVALID_FREE_ERROR;
+
+    if (chunk == NULL)
+    {
+        MEM_POOL_DEBUG_REPORT("Invalid Free", data);
+    }
+    else
+    {
+        status = MemPoolReleaseBitmapSlot(pool, chunk, slot, data);
+    }
+
+    if (locked)
+    {
+        pthread_mutex_unlock(&pool -> depotLock);
+    }
+
+    return status;
+}
+
+/*
+    Batches. Producers tend to log metrics in bursts of hundreds, and paying
+    for a lock (or a compare-and-swap) and all of the bookkeeping once per
+    block adds up. The batch functions move a whole run of blocks on and off
+    the free structure in one operation instead:
+
+        -   Block list pools pop or push the whole run while holding the
+            depot lock once. A freed run is linked together before the lock
+            is taken, so pushing it is just two pointer writes.
+
+        -   Thread cached pools serve what they can from the calling
+            thread's magazine, and visit the depot (once) for the rest.
+
+        -   Lock-free pools walk "count" links down from the top of the
+            stack and cut the whole run off with one compare-and-swap.
+
+        -   Bitmap pools take the lowest free bits a word at a time, so one
+            mask update claims up to 64 blocks.
+
+    Zeroing, guard checks and poisoning still happen once per block, but
+    outside the lock wherever the layout allows it.
+
+    Runs come back in address order wherever the free blocks are next to
+    each other: a fresh chunk hands out its blocks from the front, a bitmap
+    is scanned from its lowest bit, and a freed batch goes back on the free
+    list in the order it was passed in, so the next batch gets it back the
+    same way round. That lets callers walk the blocks with a plain
+    sequential loop.
+*/
+
+/*
+    Pops "count" blocks off the free list into "blocks", adding chunks to a
+    growable pool whenever it runs dry. Returns how many blocks it popped,
+    which is only less than "count" when the pool can't grow any further.
+
+    Callers must hold "depotLock" if the pool is shared between threads.
+*/
+static long int MemPoolPopFreeRun(MemoryPoolManager *pool, long int count, void **blocks)
+{
+    long int popped = 0;
+
+    while (popped < count)
+    {
+        if (pool -> freeList == NULL && MemPoolGrow(pool) != MEMORY_POOL_OK)
+        {
+            break;
+        }
+
+        blocks[popped++] = MemPoolPopFreeBlock(pool);
+    }
+
+    return popped;
+}
+
+/*
+    Pushes a chain of blocks, already linked together through "next" from
+    "first" to "last", onto the front of the free list in one go.
+
+    Callers must hold "depotLock" if the pool is shared between threads.
+*/
+static void MemPoolPushFreeRun(MemoryPoolManager *pool, MemoryPoolBlock *first,
+                               MemoryPoolBlock *last)
+{
+    last -> next = pool -> freeList;
+    pool -> freeList = first;
+}
+
+/*
+    Pops "count" blocks off a lock-free pool's stack with a single
+    compare-and-swap. The links we follow can change under us while another
+    thread pops or pushes, but any change to the stack also changes its
+    head (and tag), so the swap only succeeds if the run we walked is still
+    the top of the stack.
+
+    Lock-free pools can't grow, so if the stack holds fewer than "count"
+    blocks we take nothing and return 0. Otherwise returns "count".
+*/
+static long int MemPoolPopFreeRunLockFree(MemoryPoolManager *pool, long int count,
+                                          void **blocks)
+{
+    uint64_t head = atomic_load(&pool -> lockFreeHead);
+    uint64_t newHead;
+
+    do
+    {
+        uint32_t top = (uint32_t) head;
+
+        for (long int i = 0; i < count; i++)
+        {
+            if (top == 0)
+            {
+                return 0;
+            }
+
+            blocks[i] = &pool -> head[top - 1];
+            top = atomic_load(&pool -> lockFreeNext[top - 1]);
+        }
+
+        newHead = ((head >> 32) + 1) << 32 | top;
+    } 
+    while (!atomic_compare_exchange_weak(&pool -> lockFreeHead, &head, newHead));
+
+    return count;
+}
+
+/*
+    Claims up to "count" free blocks of a bitmap pool, lowest address first.
+    All of the free bits we take from a word are set with one write, and
+    the chunk's "searchWord" only moves past words that end up full.
+    Returns how many blocks were claimed.
+
+    Callers must hold "depotLock" if the pool is shared between threads.
+*/
+static long int MemPoolAllocBitmapRun(MemoryPoolManager *pool, long int count, void **data)
+{
+    long int taken = 0;
+
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL && taken < count;
+         chunk = chunk -> nextChunk)
+    {
+        long int words = MemPoolBitmapWords(chunk -> blockCount);
+        long int w = chunk -> searchWord;
+
+        while (w < words && taken < count)
+        {
+            uint64_t available = ~chunk -> occupancy[w];
+            uint64_t claimed = 0;
+
+            while (available != 0 && taken < count)
+            {
+                int bit = MemPoolCountTrailingZeros(available);
+                uint64_t mask = (uint64_t) 1 << bit;
+
+                available &= ~mask;
+                claimed |= mask;
+                data[taken++] = MemPoolSlotData(pool, chunk -> start, w * 64 + bit);
+            }
+
+            chunk -> occupancy[w] |= claimed;
+
+            if (chunk -> dirty != NULL)
+            {
+                chunk -> dirty[w] |= claimed;
+            }
+
+            if (chunk -> occupancy[w] == UINT64_MAX)
+            {
+                w++;
+            }
+        }
+
+        chunk -> searchWord = w;
+    }
+
+    return taken;
+}
+
+static MemoryPoolStatus MemPoolAllocBitmapBatch(MemoryPoolManager *pool, long int count,
+                                                void **data)
+{
+    bool locked = pool -> threading == MEMORY_POOL_LOCKED;
+
+    if (locked)
+    {
+        pthread_mutex_lock(&pool -> depotLock);
+    }
+
+    long int taken = MemPoolAllocBitmapRun(pool, count, data);
+
+    while (taken < count && MemPoolGrow(pool) == MEMORY_POOL_OK)
+    {
+        taken += MemPoolAllocBitmapRun(pool, count - taken, data + taken);
+    }
+
+    //  Not enough blocks to go round, so clear the bits we did claim again.
+    //  Nobody has seen these blocks, so there is nothing to scrub (a lazy
+    //  pool will just zero them once more than it needs to).
+    if (taken < count)
+    {
+        for (long int i = 0; i < taken; i++)
+        {
+            long int slot;
+            MemoryPoolChunk *chunk = MemPoolFindDataChunk(pool, data[i], &slot);
+
+            chunk -> occupancy[slot / 64] &= ~((uint64_t) 1 << (slot % 64));
+
+            if (slot / 64 < chunk -> searchWord)
+            {
+                chunk -> searchWord = slot / 64;
+            }
+        }
+    }
+
+    if (locked)
+    {
+        pthread_mutex_unlock(&pool -> depotLock);
+    }
+
+    if (taken < count)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+#ifdef MEM_POOL_DEBUG
+    for (long int i = 0; i < count; i++)
+    {
+        MemPoolDebugCheckAlloc(pool, data[i]);
+    }
+#endif
+
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Allocates "count" blocks in one go and puts their data pointers in
+    "data", which must have room for all of them. It is all or nothing: if
+    the pool can't supply every block, none are taken, "data" is filled with
+    NULLs and an allocation error is returned.
+*/
+static MemoryPoolStatus MemPoolAllocBatchUntracked(MemoryPoolManager *pool, long int count,
+                                                   void **data)
+{
+    if (pool == NULL || data == NULL || count < 0)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    MemoryPoolStatus status = MEMORY_POOL_OK;
+
+    if (pool -> layout == MEMORY_POOL_LAYOUT_BITMAP)
+    {
+        status = MemPoolAllocBitmapBatch(pool, count, data);
+    }
+    else
+    {
+        //  "data" holds the MemoryPoolBlocks themselves until we know we
+        //  have all of them, then each is swapped for its data pointer.
+        long int taken = 0;
+        bool locked = pool -> threading != MEMORY_POOL_SINGLE_THREADED;
+
+        switch (pool -> threading)
+        {
+            case MEMORY_POOL_SINGLE_THREADED:
+                taken = MemPoolPopFreeRun(pool, count, data);
+                break;
+
+            case MEMORY_POOL_LOCKED:
+                pthread_mutex_lock(&pool -> depotLock);
+                taken = MemPoolPopFreeRun(pool, count, data);
+                pthread_mutex_unlock(&pool -> depotLock);
+                break;
+
+            case MEMORY_POOL_THREAD_CACHED:
+            {
+                MemoryPoolMagazine *magazine = MemPoolGetMagazine(pool);
+
+                //  Take the top of the magazine in the order it was freed in.
+                if (magazine != NULL)
+                {
+                    taken = magazine -> count < count ? magazine -> count : count;
+                    magazine -> count -= (int) taken;
+
+                    for (long int i = 0; i < taken; i++)
+                    {
+                        data[i] = magazine -> blocks[magazine -> count + i];
+                    }
+                }
+
+                if (taken < count)
+                {
+                    pthread_mutex_lock(&pool -> depotLock);
+                    taken += MemPoolPopFreeRun(pool, count - taken, data + taken);
+                    pthread_mutex_unlock(&pool -> depotLock);
+                }
+                break;
+            }
+
+            case MEMORY_POOL_LOCK_FREE:
+                taken = MemPoolPopFreeRunLockFree(pool, count, data);
+                break;
+        }
+
+        if (taken < count)
+        {
+            //  Put back what we did take, in the same order, so the next
+            //  batch still finds them as a run.
+            for (long int i = 0; i + 1 < taken; i++)
+            {
+                ((MemoryPoolBlock*) data[i]) -> next = (MemoryPoolBlock*) data[i + 1];
+            }
+
+            if (taken > 0)
+            {
+                if (locked)
+                {
+                    pthread_mutex_lock(&pool -> depotLock);
+                }
+
+                MemPoolPushFreeRun(pool, (MemoryPoolBlock*) data[0],
+                                   (MemoryPoolBlock*) data[taken - 1]);
+
+                if (locked)
+                {
+                    pthread_mutex_unlock(&pool -> depotLock);
+                }
+            }
+
+            status = MEMORY_POOL_ALLOC_ERROR;
+        }
+        else
+        {
+            for (long int i = 0; i < count; i++)
+            {
+                MemoryPoolBlock *block = (MemoryPoolBlock*) data[i];
+
+                MemPoolHandOutBlock(pool, block, false);
+                data[i] = block -> data;
+            }
+        }
+    }
+
+    if (status != MEMORY_POOL_OK)
+    {
+        for (long int i = 0; i < count; i++)
+        {
+            data[i] = NULL;
+        }
+    }
+
+    return status;
+}
+
+static MemoryPoolStatus MemPoolFreeBitmapBatch(MemoryPoolManager *pool, long int count,
+                                               void **data, long int *freed)
+{
+    bool locked = pool -> threading == MEMORY_POOL_LOCKED;
+    MemoryPoolStatus result = MEMORY_POOL_OK;
+
+    if (locked)
+    {
+        pthread_mutex_lock(&pool -> depotLock);
+    }
+
+    for (long int i = 0; i < count; i++)
+    {
+        long int slot;
+        MemoryPoolChunk *chunk = MemPoolFindDataChunk(pool, data[i], &slot);
+        MemoryPoolStatus status = MEMORY_POOL_INVALID_FREE_ERROR;
+
+        if (chunk == NULL)
+        {
+            MEM_POOL_DEBUG_REPORT("Invalid Free", data[i]);
+        }
+        else
+        {
+            status = MemPoolReleaseBitmapSlot(pool, chunk, slot, data[i]);
+        }
+
+        if (status == MEMORY_POOL_OK || status == MEMORY_POOL_CORRUPTION_ERROR)
+        {
+            (*freed)++;
+        }
+
+        if (status != MEMORY_POOL_OK && result == MEMORY_POOL_OK)
+        {
+            result = status;
+        }
+    }
+
+    if (locked)
+    {
+        pthread_mutex_unlock(&pool -> depotLock);
+    }
+
+    return result;
+}
+
+/*
+    Frees "count" blocks given their data pointers. Unlike allocating, one
+    bad pointer doesn't stop the rest of the batch: every valid block is
+    freed, "freed" is set to how many that was, and the status of the first
+    pointer that was rejected (or found corrupted) is returned.
+
+    Blocks of a block list pool are taken back one by one without the lock
+    and chained together in the order they were passed in, then the whole
+    chain is pushed in one go. A thread cached pool fills the calling
+    thread's magazine first and sends the rest of the chain to the depot.
+*/
+static MemoryPoolStatus MemPoolFreeBatchUntracked(MemoryPoolManager *pool, long int count,
+                                                  void **data, long int *freed)
+{
+    *freed = 0;
+
+    if (pool == NULL || data == NULL || count < 0)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    if (pool -> layout == MEMORY_POOL_LAYOUT_BITMAP)
+    {
+        return MemPoolFreeBitmapBatch(pool, count, data, freed);
+    }
+
+    MemoryPoolStatus result = MEMORY_POOL_OK;
+    MemoryPoolMagazine *magazine = NULL;
+    MemoryPoolBlock *first = NULL;
+    MemoryPoolBlock *last = NULL;
+    long int firstIndex = -1;
+    long int lastIndex = -1;
+
+    if (pool -> threading == MEMORY_POOL_THREAD_CACHED)
+    {
+        magazine = MemPoolGetMagazine(pool);
+    }
+
+    for (long int i = 0; i < count; i++)
+    {
+        MemoryPoolBlock *block = MemPoolFindBlock(pool, data[i]);
+        MemoryPoolStatus status = MEMORY_POOL_INVALID_FREE_ERROR;
+        long int index;
+
+        if (block == NULL)
+        {
+            MEM_POOL_DEBUG_REPORT("Invalid Free", data[i]);
+        }
+        else
+        {
+            status = MemPoolTakeBackBlock(pool, block, &index);
+        }
+
+        if (status != MEMORY_POOL_OK && result == MEMORY_POOL_OK)
+        {
+            result = status;
+        }
+
+        if (status != MEMORY_POOL_OK && status != MEMORY_POOL_CORRUPTION_ERROR)
+        {
+            continue;
+        }
+
+        (*freed)++;
+
+        if (magazine != NULL && magazine -> count < pool -> magazineSize * 2)
+        {
+            magazine -> blocks[magazine -> count++] = block;
+        }
+        else if (pool -> threading == MEMORY_POOL_LOCK_FREE)
+        {
+            if (lastIndex >= 0)
+            {
+                atomic_store(&pool -> lockFreeNext[lastIndex], (uint32_t)(index + 1));
+            }
+            else
+            {
+                firstIndex = index;
+            }
+
+            lastIndex = index;
+        }
+        else
+        {
+            if (last != NULL)
+            {
+                last -> next = block;
+            }
+            else
+            {
+                first = block;
+            }
+
+            last = block;
+        }
+    }
+
+    if (firstIndex >= 0)
+    {
+        MemPoolPushFreeRunLockFree(pool, firstIndex, lastIndex);
+    }
+    else if (first != NULL)
+    {
+        bool locked = pool -> threading != MEMORY_POOL_SINGLE_THREADED;
+
+        if (locked)
+        {
+            pthread_mutex_lock(&pool -> depotLock);
+        }
+
+        MemPoolPushFreeRun(pool, first, last);
+
+        if (locked)
+        {
+            pthread_mutex_unlock(&pool -> depotLock);
+        }
+    }
+
+    return result;
+}
+
+/*
+    Counts how many blocks are currently allocated. For a bitmap pool, this
+    is just a population count over each bitmap word (minus the padding bits
+    at the end, which are always set). For a block list pool, we have to
+    visit every MemoryPoolBlock and check its "isAlloc" flag.
+
+    This takes no locks, so on a pool that is in use by other threads the
+    count is only a snapshot.
+*/
+long int MemPoolCountAllocated(MemoryPoolManager *pool)
+{
+    if (pool == NULL)
+    {
+        return 0;
+    }
+
+    long int allocated = 0;
+
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL; chunk = chunk -> nextChunk)
+    {
+        if (pool -> layout == MEMORY_POOL_LAYOUT_BITMAP)
+        {
+            long int words = MemPoolBitmapWords(chunk -> blockCount);
+
+            for (long int w = 0; w < words; w++)
+            {
+                allocated += MemPoolPopCount(chunk -> occupancy[w]);
+            }
+
+            allocated -= words * 64 - chunk -> blockCount;
+        }
+        else
+        {
+            for (long int i = 0; i < chunk -> blockCount; i++)
+            {
+                allocated += chunk -> blocks[i].isAlloc;
+            }
+        }
+    }
+
+    return allocated;
+}
+
+/*
+    How many bytes the pool spends keeping track of its blocks, as opposed to
+    the bytes handed out to callers: the manager itself, every chunk, either
+    the MemoryPoolBlock arrays or the occupancy bitmaps, and the chunk map.
+*/
+size_t MemPoolMetadataSize(MemoryPoolManager *pool)
+{
+    if (pool == NULL)
+    {
+        return 0;
+    }
+
+    size_t size = sizeof(MemoryPoolManager);
+
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL; chunk = chunk -> nextChunk)
+    {
+        size += sizeof(MemoryPoolChunk);
+
+        if (pool -> layout == MEMORY_POOL_LAYOUT_BITMAP)
+        {
+            size += MemPoolBitmapWords(chunk -> blockCount) * sizeof(uint64_t);
+
+            if (chunk -> dirty != NULL)
+            {
+                size += MemPoolBitmapWords(chunk -> blockCount) * sizeof(uint64_t);
+            }
+        }
+        else
+        {
+            size += chunk -> blockCount * sizeof(MemoryPoolBlock);
+        }
+
+        size += chunk -> blockCount * sizeof(uint8_t);
+    }
+
+    if (pool -> lockFreeNext != NULL)
+    {
+        size += pool -> memoryBlockCount * sizeof(uint32_t);
+    }
+
+    for (MemoryPoolChunkMap *map = pool -> chunkMap; map != NULL; map = map -> retired)
+    {
+        size += sizeof(MemoryPoolChunkMap) + map -> capacity * sizeof(MemoryPoolChunkMapEntry);
+    }
+
+    return size;
+}
+
+/*
+    Pool images (see MEM_POOL_IMAGE_ALIGNMENT in Memory_Pool_Manager.h). An
+    image file is laid out as:
+
+        -   A MemoryPoolImageHeader: the pool's settings, and where
+            everything else sits in the file.
+        -   The occupancy bitmap, one bit per block (set if it is in use).
+        -   The generations, one byte per block.
+        -   Padding up to the next multiple of MEM_POOL_IMAGE_ALIGNMENT.
+        -   The data of every block, chunk after chunk, exactly as it sits in
+            memory (guard bytes and padding included).
+
+    Every position is an offset from the start of the file, and blocks are
+    numbered by their index in the pool as a whole, just like handles.
+*/
+#define MEM_POOL_IMAGE_MAGIC "MEMPOOL"
+#define MEM_POOL_IMAGE_VERSION 1
+
+typedef struct MemoryPoolImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t guardSize;
+
+    uint64_t memoryBlockSize;
+    int64_t memoryBlockCount;
+    uint64_t alignment;
+    uint64_t blockStride;
+    uint64_t dataOffset;
+    uint8_t cacheLinePadding;
+    uint8_t growable;
+    uint8_t hugePages;
+    uint8_t prefault;
+    int32_t threading;
+    int32_t magazineSize;
+    int32_t layout;
+    int32_t zeroing;
+    int32_t backing;
+    double growthFactor;
+    int64_t maxBlockCount;
+
+    uint64_t occupancyStart;
+    uint64_t generationsStart;
+    uint64_t dataStart;
+    uint64_t dataSize;
+} MemoryPoolImageHeader;
+
+/*
+    Writes "pool" to a pool image at "path", replacing whatever was there.
+    Everything goes out front to back in a single pass, and the block data
+    is written straight from the chunks rather than copied first.
+*/
+MemoryPoolStatus MemPoolSave(MemoryPoolManager *pool, const char *path)
+{
+    if (pool == NULL || path == NULL)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    long int count = pool -> memoryBlockCount;
+    long int words = MemPoolBitmapWords(count);
+    size_t stride = MemPoolStride(pool);
+    size_t packedStride = MemPoolRoundUp(pool -> dataOffset + pool -> memoryBlockSize +
+                                         MEM_POOL_GUARD_SIZE,
+                                         pool -> alignment == 0 ? 1 : pool -> alignment);
+
+    MemoryPoolImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MEM_POOL_IMAGE_MAGIC, sizeof(MEM_POOL_IMAGE_MAGIC));
+    header.version = MEM_POOL_IMAGE_VERSION;
+    header.headerSize = sizeof(MemoryPoolImageHeader);
+    header.guardSize = MEM_POOL_GUARD_SIZE;
+    header.memoryBlockSize = pool -> memoryBlockSize;
+    header.memoryBlockCount = count;
+    header.alignment = pool -> alignment;
+    header.blockStride = stride;
+    header.dataOffset = pool -> dataOffset;
+    header.cacheLinePadding = stride != packedStride;
+    header.growable = pool -> growable;
+    header.hugePages = pool -> hugePages;
+    header.prefault = pool -> prefault;
+    header.threading = pool -> threading;
+    header.magazineSize = pool -> magazineSize;
+    header.layout = pool -> layout;
+    header.zeroing = pool -> zeroing;
+    header.backing = pool -> backing;
+    header.growthFactor = pool -> growthFactor;
+    header.maxBlockCount = pool -> maxBlockCount;
+    header.occupancyStart = sizeof(MemoryPoolImageHeader);
+    header.generationsStart = header.occupancyStart + words * sizeof(uint64_t);
+    header.dataStart = MemPoolRoundUp(header.generationsStart + count,
+                                      MEM_POOL_IMAGE_ALIGNMENT);
+    header.dataSize = stride * count;
+
+    uint64_t *occupancy = (uint64_t*) calloc(words, sizeof(uint64_t));
+
+    if (occupancy == NULL)
+    {
+        printf("Unable To Allocate Memory For The Pool Image\n");
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL; chunk = chunk -> nextChunk)
+    {
+        for (long int slot = 0; slot < chunk -> blockCount; slot++)
+        {
+            if (!MemPoolSlotIsFree(pool, chunk, slot))
+            {
+                long int index = chunk -> firstIndex + slot;
+                occupancy[index / 64] |= (uint64_t) 1 << (index % 64);
+            }
+        }
+    }
+
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL)
+    {
+        printf("Unable To Open %s For Writing\n", path);
+        free(occupancy);
+        return MEMORY_POOL_IO_ERROR;
+    }
+
+    static const char padding[MEM_POOL_IMAGE_ALIGNMENT];
+    size_t paddingSize = header.dataStart - header.generationsStart - count;
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(occupancy, sizeof(uint64_t), words, file) == (size_t) words;
+
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL && written;
+         chunk = chunk -> nextChunk)
+    {
+        written = fwrite(chunk -> generations, sizeof(uint8_t), chunk -> blockCount, file) ==
+                  (size_t) chunk -> blockCount;
+    }
+
+    written = written && fwrite(padding, 1, paddingSize, file) == paddingSize;
+
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL && written;
+         chunk = chunk -> nextChunk)
+    {
+        written = fwrite(chunk -> start, stride, chunk -> blockCount, file) ==
+                  (size_t) chunk -> blockCount;
+    }
+
+    if (fclose(file) != 0)
+    {
+        written = false;
+    }
+
+    free(occupancy);
+
+    if (!written)
+    {
+        printf("Unable To Write The Pool Image To %s\n", path);
+        return MEMORY_POOL_IO_ERROR;
+    }
+
+    return MEMORY_POOL_OK;
+}
+
+//  True if "header" describes an image this build of the pool can load.
+static bool MemPoolImageHeaderIsValid(const MemoryPoolImageHeader *header)
+{
+    if (memcmp(header -> magic, MEM_POOL_IMAGE_MAGIC, sizeof(MEM_POOL_IMAGE_MAGIC)) != 0 ||
+        header -> version != MEM_POOL_IMAGE_VERSION ||
+        header -> headerSize != sizeof(MemoryPoolImageHeader) ||
+        header -> guardSize != MEM_POOL_GUARD_SIZE ||
+        header -> memoryBlockCount <= 0 || header -> memoryBlockSize == 0 ||
+        header -> blockStride == 0 || header -> memoryBlockCount > LONG_MAX)
+    {
+        return false;
+    }
+
+    uint64_t count = (uint64_t) header -> memoryBlockCount;
+    uint64_t words = (uint64_t) MemPoolBitmapWords((long int) count);
+
+    return header -> dataSize / header -> blockStride == count &&
+           header -> dataSize % header -> blockStride == 0 &&
+           header -> occupancyStart == sizeof(MemoryPoolImageHeader) &&
+           header -> generationsStart == header -> occupancyStart + words * sizeof(uint64_t) &&
+           header -> dataStart >= header -> generationsStart + count &&
+           header -> dataStart % MEM_POOL_IMAGE_ALIGNMENT == 0;
+}
+
+/*
+    Maps the block data of the image straight from the file. The mapping is
+    private, so writes to it are copy-on-write and never reach the file.
+    If it can't be mapped, "start" is left NULL and the data is read in
+    when the pool is restored instead.
+*/
+static void MemPoolMapImageData(MemoryPoolImage *image, uint64_t dataStart)
+{
+#if defined(_WIN32)
+    (void) image;
+    (void) dataStart;
+#else
+    struct stat info;
+    int descriptor = fileno(image -> file);
+    size_t pageSize = MemPoolPageSize();
+
+    if (dataStart % pageSize != 0 || fstat(descriptor, &info) != 0 ||
+        (uint64_t) info.st_size < dataStart + image -> dataSize)
+    {
+        return;
+    }
+
+    size_t size = MemPoolRoundUp(image -> dataSize, pageSize);
+    void *start = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor,
+                       (off_t) dataStart);
+
+    if (start != MAP_FAILED)
+    {
+        image -> start = start;
+        image -> mappedSize = size;
+    }
+#endif
+}
+
+/*
+    Puts a freshly created pool back into the state recorded in "image".
+    The block data is read in if it couldn't be mapped, the blocks that
+    were in use are marked as such, the free list is rebuilt from the rest
+    (in address order, just like a new pool's) and the generations are put
+    back so saved handles still resolve.
+
+    Nothing records which free blocks had been written to, so with the
+    MEMORY_POOL_ZERO_LAZY policy every block is treated as dirty.
+*/
+static MemoryPoolStatus MemPoolRestoreImage(MemoryPoolManager *pool, MemoryPoolImage *image)
+{
+    MemoryPoolChunk *chunk = pool -> chunks;
+    long int count = chunk -> blockCount;
+    long int allocated = 0;
+
+    if (MemPoolStride(pool) != image -> blockStride ||
+        pool -> dataOffset != image -> dataOffset)
+    {
+        printf("The Pool Image Was Saved With A Different Block Layout\n");
+        return MEMORY_POOL_IO_ERROR;
+    }
+
+    if (!chunk -> fromImage &&
+        fread(chunk -> start, 1, image -> dataSize, image -> file) != image -> dataSize)
+    {
+        printf("Unable To Read The Pool Image\n");
+        return MEMORY_POOL_IO_ERROR;
+    }
+
+    if (pool -> layout == MEMORY_POOL_LAYOUT_BITMAP)
+    {
+        long int words = MemPoolBitmapWords(count);
+
+        for (long int w = 0; w < words; w++)
+        {
+            chunk -> occupancy[w] |= image -> occupancy[w];
+            allocated += MemPoolPopCount(image -> occupancy[w]);
+        }
+
+        if (chunk -> dirty != NULL)
+        {
+            memset(chunk -> dirty, 0xFF, words * sizeof(uint64_t));
+        }
+    }
+    else
+    {
+        MemoryPoolBlock *freeList = NULL;
+        uint32_t lockFreeHead = 0;
+
+        for (long int i = count - 1; i >= 0; i--)
+        {
+            MemoryPoolBlock *block = &chunk -> blocks[i];
+
+            block -> isAlloc = (image -> occupancy[i / 64] >> (i % 64)) & 1;
+            block -> isDirty = true;
+            block -> next = NULL;
+
+            if (block -> isAlloc)
+            {
+                allocated++;
+            }
+            else if (pool -> threading == MEMORY_POOL_LOCK_FREE)
+            {
+                atomic_store(&pool -> lockFreeNext[i], lockFreeHead);
+                lockFreeHead = (uint32_t)(i + 1);
+            }
+            else
+            {
+                block -> next = freeList;
+                freeList = block;
+            }
+        }
+
+        pool -> freeList = freeList;
+
+        if (pool -> threading == MEMORY_POOL_LOCK_FREE)
+        {
+            atomic_store(&pool -> lockFreeHead, lockFreeHead);
+        }
+    }
+
+    memcpy(chunk -> generations, image -> generations, count);
+
+#ifdef MEM_POOL_ENABLE_STATS
+    atomic_store(&pool -> stats.currentAllocations, allocated);
+    atomic_store(&pool -> stats.peakAllocations, allocated);
+#else
+    (void) allocated;
+#endif
+
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Creates a pool from a pool image written by MemPoolSave. The new pool
+    has the saved pool's settings, with the same blocks in use holding the
+    same data, all in a single chunk.
+
+    The image is checked before anything is built from it, and a file that
+    isn't an image this build of the pool can load is rejected with
+    MEMORY_POOL_IO_ERROR.
+*/
+MemoryPoolStatus MemPoolLoad(MemoryPoolManager **pool, const char *path)
+{
+    if (pool == NULL || path == NULL)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    *pool = NULL;
+
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        printf("Unable To Open %s For Reading\n", path);
+        return MEMORY_POOL_IO_ERROR;
+    }
+
+    MemoryPoolImageHeader header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || !MemPoolImageHeaderIsValid(&header))
+    {
+        printf("%s Isn't A Pool Image That Can Be Loaded\n", path);
+        fclose(file);
+        return MEMORY_POOL_IO_ERROR;
+    }
+
+    long int count = (long int) header.memoryBlockCount;
+    size_t words = (size_t) MemPoolBitmapWords(count);
+
+    MemoryPoolImage image;
+    image.file = file;
+    image.start = NULL;
+    image.mappedSize = 0;
+    image.dataSize = header.dataSize;
+    image.blockStride = header.blockStride;
+    image.dataOffset = header.dataOffset;
+    image.occupancy = (uint64_t*) calloc(words, sizeof(uint64_t));
+    image.generations = (uint8_t*) malloc(count);
+
+    MemoryPoolStatus status = MEMORY_POOL_IO_ERROR;
+
+    if (image.occupancy == NULL || image.generations == NULL)
+    {
+        printf("Unable To Allocate Memory For The Pool Image\n");
+        status = MEMORY_POOL_ALLOC_ERROR;
+    }
+    else if (fread(image.occupancy, sizeof(uint64_t), words, file) != words ||
+             fread(image.generations, sizeof(uint8_t), count, file) != (size_t) count)
+    {
+        printf("Unable To Read The Pool Image\n");
+    }
+    else
+    {
+        MemPoolMapImageData(&image, header.dataStart);
+
+        //  Without a mapping, skip the padding so the data can be read next.
+        long int paddingSize = (long int)(header.dataStart - header.generationsStart - count);
+
+        if (image.start != NULL || fseek(file, paddingSize, SEEK_CUR) == 0)
+        {
+            MemoryPoolConfig config;
+            MemPoolDefaultConfig(&config, header.memoryBlockSize, count);
+            config.threading = (MemoryPoolThreading) header.threading;
+            config.magazineSize = header.magazineSize;
+            config.growable = header.growable;
+            config.growthFactor = header.growthFactor;
+            config.maxBlockCount = (long int) header.maxBlockCount;
+            config.layout = (MemoryPoolLayout) header.layout;
+            config.zeroing = (MemoryPoolZeroing) header.zeroing;
+            config.backing = (MemoryPoolBacking) header.backing;
+            config.hugePages = header.hugePages;
+            config.prefault = header.prefault;
+            config.alignment = header.alignment;
+            config.cacheLinePadding = header.cacheLinePadding;
+
+            status = MemPoolCreate(pool, &config, &image);
+        }
+    }
+
+#if !defined(_WIN32)
+    //  MemPoolCreate takes the mapping over, unless it was never called.
+    if (image.start != NULL)
+    {
+        munmap(image.start, image.mappedSize);
+    }
+#endif
+
+    fclose(file);
+    free(image.occupancy);
+    free(image.generations);
+
+    return status;
+}
+
+/*
+    The statistics layer. Each public alloc/free function is a thin wrapper
+    around its "Untracked" version that does the real work. With
+    MEM_POOL_ENABLE_STATS defined, the wrapper counts the call, times it if
+    it is one of the sampled calls, and records how it went. Without it,
+    the wrapper just calls straight through, and the compiler is free to
+    inline it away completely.
+*/
+#ifdef MEM_POOL_ENABLE_STATS
+/*
+    The time in nanoseconds. This is kept as a whole number: a double only
+    has 53 bits of precision, which today's time in nanoseconds overflows,
+    so it could only tell times apart to the nearest 256 nanoseconds.
+*/
+static int64_t MemPoolStatsNow(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (int64_t) now.tv_sec * 1000000000 + (int64_t) now.tv_nsec;
+}
+
+/*
+    Counts a call and, if it is a sampled one, returns the time it started.
+    Returns a negative time for calls that aren't being timed.
+*/
+static int64_t MemPoolStatsBegin(_Atomic long int *calls)
+{
+    long int call = atomic_fetch_add_explicit(calls, 1, memory_order_relaxed);
+    return call % MEM_POOL_STATS_SAMPLE_RATE == 0 ? MemPoolStatsNow() : -1;
+}
+
+//  Adds the time since "begin" to a latency histogram.
+static void MemPoolStatsRecordLatency(_Atomic long int *histogram, int64_t begin)
+{
+    if (begin < 0)
+    {
+        return;
+    }
+
+    int64_t elapsed = MemPoolStatsNow() - begin;
+    int bucket = 0;
+
+    while (elapsed >= 2 && bucket < MEM_POOL_LATENCY_BUCKETS - 1)
+    {
+        elapsed /= 2;
+        bucket++;
+    }
+
+    atomic_fetch_add_explicit(&histogram[bucket], 1, memory_order_relaxed);
+}
+
+//  Records a call that allocated "allocated" blocks and failed to allocate
+//  "failed" more.
+static void MemPoolStatsRecordAlloc(MemoryPoolManager *pool, long int allocated,
+                                    long int failed, int64_t begin)
+{
+    MemoryPoolStatsCounters *stats = &pool -> stats;
+
+    if (failed > 0)
+    {
+        atomic_fetch_add_explicit(&stats -> failedAllocations, failed, memory_order_relaxed);
+    }
+
+    if (allocated > 0)
+    {
+        atomic_fetch_add_explicit(&stats -> totalAllocations, allocated, memory_order_relaxed);
+
+        long int current = atomic_fetch_add_explicit(&stats -> currentAllocations, allocated,
+                                                     memory_order_relaxed) + allocated;
+        long int peak = atomic_load_explicit(&stats -> peakAllocations, memory_order_relaxed);
+
+        while (current > peak &&
+               !atomic_compare_exchange_weak(&stats -> peakAllocations, &peak, current))
+        {
+        }
+    }
+
+    MemPoolStatsRecordLatency(stats -> allocLatency, begin);
+}
+
+static void MemPoolStatsRecordFree(MemoryPoolManager *pool, long int freed, long int failed,
+                                   int64_t begin)
+{
+    MemoryPoolStatsCounters *stats = &pool -> stats;
+
+    if (failed > 0)
+    {
+        atomic_fetch_add_explicit(&stats -> failedFrees, failed, memory_order_relaxed);
+    }
+
+    if (freed > 0)
+    {
+        atomic_fetch_sub_explicit(&stats -> currentAllocations, freed, memory_order_relaxed);
+    }
+
+    MemPoolStatsRecordLatency(stats -> freeLatency, begin);
+}
+
+//  A corrupted block is still freed, it just had its guards overwritten.
+static long int MemPoolStatsFreed(MemoryPoolStatus status)
+{
+    return status == MEMORY_POOL_OK || status == MEMORY_POOL_CORRUPTION_ERROR;
+}
+#endif
+
+/*
+    Memory pressure (see MemoryPoolPressure in Memory_Pool_Manager.h). The
+    public alloc and free functions call MemPoolPressureAlloc and
+    MemPoolPressureFree with the number of blocks they moved. Without a
+    registered callback, that's a single check of "watchPressure".
+
+    A single threaded pool can count with a plain load and store, while
+    every other mode needs an atomic add. The add and the trigger load that
+    follows it are sequentially consistent, which costs nothing more than
+    the add itself on x86. Together with MemPoolPressureChange re-reading
+    the count after it stores the triggers, that means a thread can't slip
+    past a trigger that is being moved: either it sees the new trigger, or
+    the thread moving it sees its count.
+*/
+static long int MemPoolPressureCount(MemoryPoolManager *pool, long int change)
+{
+    if (pool -> threading == MEMORY_POOL_SINGLE_THREADED)
+    {
+        long int count = atomic_load_explicit(&pool -> blocksInUse, memory_order_relaxed);
+        atomic_store_explicit(&pool -> blocksInUse, count + change, memory_order_relaxed);
+        return count + change;
+    }
+
+    return atomic_fetch_add(&pool -> blocksInUse, change) + change;
+}
+
+/*
+    Called when a trigger fires. Moves the pool into (or out of) pressure,
+    parking the trigger that just fired and arming the other one, then tells
+    the callback.
+
+    Transitions are rare, so they are serialised by "pressureLock" rather
+    than raced. Under the lock, the decision is made from the live count
+    and state, not from whatever the caller saw, so a thread that arrives
+    late (its threshold already dealt with) simply finds nothing to do.
+    The state and both triggers change together, and after moving the
+    triggers we look at the count again, in case another thread crossed the
+    newly armed one before it was in place.
+
+    The callback itself runs after the lock is released, so other threads
+    are never held up by it. Only one thread at a time delivers callbacks
+    ("pressureNotifying"). A transition made whilst a callback is running,
+    on any thread (including from inside the callback), is left for that
+    thread to deliver once its callback returns. It keeps going until the
+    callback has been told about the pool's current state, so callbacks
+    never overlap and always alternate between HIGH and RELIEVED. If the
+    pool went there and back again during one callback, the round trip is
+    never reported.
+*/
+static void MemPoolPressureChange(MemoryPoolManager *pool)
+{
+    pthread_mutex_lock(&pool -> pressureLock);
+
+    for (;;)
+    {
+        long int blocksInUse = atomic_load(&pool -> blocksInUse);
+        bool underPressure = atomic_load_explicit(&pool -> underPressure,
+                                                  memory_order_relaxed);
+
+        if (!underPressure && blocksInUse >= pool -> highWatermark)
+        {
+            underPressure = true;
+        }
+        else if (underPressure && blocksInUse <= pool -> lowWatermark)
+        {
+            underPressure = false;
+        }
+        else
+        {
+            break;
+        }
+
+        atomic_store_explicit(&pool -> underPressure, underPressure, memory_order_relaxed);
+        atomic_store(&pool -> highTrigger, underPressure ? LONG_MAX : pool -> highWatermark);
+        atomic_store(&pool -> lowTrigger, underPressure ? pool -> lowWatermark : LONG_MIN);
+        pool -> pressureBlocksInUse = blocksInUse;
+    }
+
+    if (pool -> pressureNotifying)
+    {
+        pthread_mutex_unlock(&pool -> pressureLock);
+        return;
+    }
+
+    pool -> pressureNotifying = true;
+
+    while (pool -> pressureReported !=
+           atomic_load_explicit(&pool -> underPressure, memory_order_relaxed))
+    {
+        bool underPressure = !pool -> pressureReported;
+        long int blocksInUse = pool -> pressureBlocksInUse;
+
+        pool -> pressureReported = underPressure;
+        pthread_mutex_unlock(&pool -> pressureLock);
+
+        pool -> pressureCallback(pool, underPressure ? MEMORY_POOL_PRESSURE_HIGH :
+                                                       MEMORY_POOL_PRESSURE_RELIEVED,
+                                 blocksInUse, pool -> pressureContext);
+
+        pthread_mutex_lock(&pool -> pressureLock);
+    }
+
+    pool -> pressureNotifying = false;
+    pthread_mutex_unlock(&pool -> pressureLock);
+}
+
+static void MemPoolPressureAlloc(MemoryPoolManager *pool, long int allocated)
+{
+    if (!pool -> watchPressure || allocated == 0)
+    {
+        return;
+    }
+
+    long int blocksInUse = MemPoolPressureCount(pool, allocated);
+
+    if (blocksInUse >= atomic_load(&pool -> highTrigger))
+    {
+        MemPoolPressureChange(pool);
+    }
+}
+
+static void MemPoolPressureFree(MemoryPoolManager *pool, long int freed)
+{
+    if (!pool -> watchPressure || freed == 0)
+    {
+        return;
+    }
+
+    long int blocksInUse = MemPoolPressureCount(pool, -freed);
+
+    if (blocksInUse <= atomic_load(&pool -> lowTrigger))
+    {
+        MemPoolPressureChange(pool);
+    }
+}
+
+/*
+    Registers "callback" to be told when the number of blocks in use reaches
+    "highWatermark", and when it falls back to "lowWatermark" afterwards
+    (see MemoryPoolPressure). "context" is handed to every call. Passing a
+    NULL callback stops watching the pool.
+
+    Counting starts from the blocks in use right now, and if that is
+    already at the high watermark, the callback is told straight away. Like
+    MemPoolTrim, no other thread may be using the pool at the time.
+*/
+MemoryPoolStatus MemPoolSetWatermarks(MemoryPoolManager *pool, long int lowWatermark,
+                                      long int highWatermark,
+                                      MemoryPoolPressureCallback callback, void *context)
+{
+    if (pool == NULL)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    pool -> watchPressure = false;
+
+    if (callback == NULL)
+    {
+        return MEMORY_POOL_OK;
+    }
+
+    if (lowWatermark < 0 || highWatermark <= lowWatermark)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    long int blocksInUse = MemPoolCountAllocated(pool);
+
+    pool -> lowWatermark = lowWatermark;
+    pool -> highWatermark = highWatermark;
+    pool -> pressureCallback = callback;
+    pool -> pressureContext = context;
+    atomic_store(&pool -> blocksInUse, blocksInUse);
+    atomic_store(&pool -> underPressure, false);
+    pool -> pressureReported = false;
+    pool -> pressureNotifying = false;
+    atomic_store(&pool -> highTrigger, highWatermark);
+    atomic_store(&pool -> lowTrigger, LONG_MIN);
+    pool -> watchPressure = true;
+
+    if (blocksInUse >= highWatermark)
+    {
+        MemPoolPressureChange(pool);
+    }
+
+    return MEMORY_POOL_OK;
+}
+
+//  True from the moment the high watermark is reached until it is relieved.
+bool MemPoolUnderPressure(MemoryPoolManager *pool)
+{
+    return pool != NULL && atomic_load_explicit(&pool -> underPressure, memory_order_relaxed);
+}
+
+MemoryPoolStatus MemPoolAlloc(MemoryPoolManager *pool, MemoryPoolBlock **block)
+{
+#ifdef MEM_POOL_ENABLE_STATS
+    if (pool != NULL)
+    {
+        int64_t begin = MemPoolStatsBegin(&pool -> stats.allocCalls);
+        MemoryPoolStatus status = MemPoolAllocUntracked(pool, block, false);
+        long int allocated = status == MEMORY_POOL_OK ? 1 : 0;
+        MemPoolStatsRecordAlloc(pool, allocated, 1 - allocated, begin);
+        MemPoolPressureAlloc(pool, allocated);
+        return status;
+    }
+#endif
+    MemoryPoolStatus status = MemPoolAllocUntracked(pool, block, false);
+
+    if (status == MEMORY_POOL_OK)
+    {
+        MemPoolPressureAlloc(pool, 1);
+    }
+
+    return status;
+}
+
+MemoryPoolStatus MemPoolFree(MemoryPoolManager *pool, MemoryPoolBlock *block)
+{
+#ifdef MEM_POOL_ENABLE_STATS
+    if (pool != NULL)
+    {
+        int64_t begin = MemPoolStatsBegin(&pool -> stats.freeCalls);
+        MemoryPoolStatus status = MemPoolFreeUntracked(pool, block);
+        long int freed = MemPoolStatsFreed(status);
+        MemPoolStatsRecordFree(pool, freed, 1 - freed, begin);
+        MemPoolPressureFree(pool, freed);
+        return status;
+    }
+#endif
+    MemoryPoolStatus status = MemPoolFreeUntracked(pool, block);
+
+    if (status == MEMORY_POOL_OK || status == MEMORY_POOL_CORRUPTION_ERROR)
+    {
+        MemPoolPressureFree(pool, 1);
+    }
+
+    return status;
+}
+
+MemoryPoolStatus MemPoolAllocData(MemoryPoolManager *pool, void **data)
+{
+#ifdef MEM_POOL_ENABLE_STATS
+    if (pool != NULL)
+    {
+        int64_t begin = MemPoolStatsBegin(&pool -> stats.allocCalls);
+        MemoryPoolStatus status = MemPoolAllocDataUntracked(pool, data, false);
+        long int allocated = status == MEMORY_POOL_OK ? 1 : 0;
+        MemPoolStatsRecordAlloc(pool, allocated, 1 - allocated, begin);
+        MemPoolPressureAlloc(pool, allocated);
+        return status;
+    }
+#endif
+    MemoryPoolStatus status = MemPoolAllocDataUntracked(pool, data, false);
+
+    if (status == MEMORY_POOL_OK)
+    {
+        MemPoolPressureAlloc(pool, 1);
+    }
+
+    return status;
+}
+
+/*
+    The calloc of the pool: allocates a block, in any layout, and makes sure
+    every byte of it is zero before handing back its data. How much work
+    that takes depends on the pool's zeroing policy (see MemoryPoolZeroing).
+*/
+MemoryPoolStatus MemPoolAllocZeroed(MemoryPoolManager *pool, void **data)
+{
+#ifdef MEM_POOL_ENABLE_STATS
+    if (pool != NULL)
+    {
+        int64_t begin = MemPoolStatsBegin(&pool -> stats.allocCalls);
+        MemoryPoolStatus status = MemPoolAllocDataUntracked(pool, data, true);
+        long int allocated = status == MEMORY_POOL_OK ? 1 : 0;
+        MemPoolStatsRecordAlloc(pool, allocated, 1 - allocated, begin);
+        MemPoolPressureAlloc(pool, allocated);
+        return status;
+    }
+#endif
+    MemoryPoolStatus status = MemPoolAllocDataUntracked(pool, data, true);
+
+    if (status == MEMORY_POOL_OK)
+    {
+        MemPoolPressureAlloc(pool, 1);
+    }
+
+    return status;
+}
+
+MemoryPoolStatus MemPoolFreeData(MemoryPoolManager *pool, void *data)
+{
+#ifdef MEM_POOL_ENABLE_STATS
+    if (pool != NULL)
+    {
+        int64_t begin = MemPoolStatsBegin(&pool -> stats.freeCalls);
+        MemoryPoolStatus status = MemPoolFreeDataUntracked(pool, data);
+        long int freed = MemPoolStatsFreed(status);
+        MemPoolStatsRecordFree(pool, freed, 1 - freed, begin);
+        MemPoolPressureFree(pool, freed);
+        return status;
+    }
+#endif
+    MemoryPoolStatus status = MemPoolFreeDataUntracked(pool, data);
+
+    if (status == MEMORY_POOL_OK || status == MEMORY_POOL_CORRUPTION_ERROR)
+    {
+        MemPoolPressureFree(pool, 1);
+    }
+
+    return status;
+}
+
+MemoryPoolStatus MemPoolAllocBatch(MemoryPoolManager *pool, long int count, void **data)
+{
+#ifdef MEM_POOL_ENABLE_STATS
+    if (pool != NULL)
+    {
+        int64_t begin = MemPoolStatsBegin(&pool -> stats.allocCalls);
+        MemoryPoolStatus status = MemPoolAllocBatchUntracked(pool, count, data);
+        long int allocated = status == MEMORY_POOL_OK ? count : 0;
+        MemPoolStatsRecordAlloc(pool, allocated, count - allocated, begin);
+        MemPoolPressureAlloc(pool, allocated);
+        return status;
+    }
+#endif
+    MemoryPoolStatus status = MemPoolAllocBatchUntracked(pool, count, data);
+
+    if (status == MEMORY_POOL_OK)
+    {
+        MemPoolPressureAlloc(pool, count);
+    }
+
+    return status;
+}
+
+MemoryPoolStatus MemPoolFreeBatch(MemoryPoolManager *pool, long int count, void **data)
+{
+    long int freed;
+
+#ifdef MEM_POOL_ENABLE_STATS
+    if (pool != NULL)
+    {
+        int64_t begin = MemPoolStatsBegin(&pool -> stats.freeCalls);
+        MemoryPoolStatus status = MemPoolFreeBatchUntracked(pool, count, data, &freed);
+        MemPoolStatsRecordFree(pool, freed, count - freed, begin);
+        MemPoolPressureFree(pool, freed);
+        return status;
+    }
+#endif
+    MemoryPoolStatus status = MemPoolFreeBatchUntracked(pool, count, data, &freed);
+
+    if (freed > 0)
+    {
+        MemPoolPressureFree(pool, freed);
+    }
+
+    return status;
+}
+
+/*
+    Builds a handle for block "slot" of "chunk" from the block's position in
+    the pool and its current generation.
+*/
+static MemoryPoolHandle MemPoolMakeHandle(MemoryPoolChunk *chunk, long int slot)
+{
+    uint32_t index = (uint32_t)(chunk -> firstIndex + slot + 1);
+    uint32_t generation = chunk -> generations[slot];
+
+    return (generation << MEM_POOL_HANDLE_INDEX_BITS) | index;
+}
+
+/*
+    Finds the chunk and slot a handle's block lives in, through the chunk map
+    (see MemPoolMapChunk) rather than a walk over the chunks, or returns NULL
+    for the null handle and handles from beyond the end of the pool. It is
+    up to the caller to check the handle is still live: its generation must
+    match the block's current generation, which moves on every time the
+    block is freed.
+*/
+static MemoryPoolChunk* MemPoolFindHandleChunk(MemoryPoolManager *pool,
+                                               MemoryPoolHandle handle, long int *slot)
+{
+    long int index = (long int)(handle & MEM_POOL_HANDLE_INDEX_MASK) - 1;
+
+    if (pool == NULL || index < 0)
+    {
+        return NULL;
+    }
+
+    MemoryPoolChunk *chunk = MemPoolLookupChunk(pool, MEM_POOL_MAP_INDEX, (uintptr_t) index);
+
+    if (chunk != NULL)
+    {
+        *slot = index - chunk -> firstIndex;
+    }
+
+    return chunk;
+}
+
+//  Whether a handle still refers to the block it was made for.
+static bool MemPoolHandleIsLive(MemoryPoolChunk *chunk, long int slot, MemoryPoolHandle handle)
+{
+    return chunk -> generations[slot] == (uint8_t)(handle >> MEM_POOL_HANDLE_INDEX_BITS);
+}
+
+/*
+    Allocates a block, in any layout, and hands back a handle to it rather
+    than a pointer (see MemoryPoolHandle). Only the first
+    MEM_POOL_MAX_HANDLE_BLOCKS blocks of a pool can be reached by a handle,
+    so if the block that comes out of the pool is beyond them, it goes back
+    again and the allocation fails.
+*/
+MemoryPoolStatus MemPoolAllocHandle(MemoryPoolManager *pool, MemoryPoolHandle *handle)
+{
+    if (handle == NULL)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    *handle = MEM_POOL_NULL_HANDLE;
+
+    void *data;
+    MemoryPoolStatus status = MemPoolAllocData(pool, &data);
+
+    if (status != MEMORY_POOL_OK)
+    {
+        return status;
+    }
+
+    long int slot;
+    MemoryPoolChunk *chunk = MemPoolFindDataChunk(pool, data, &slot);
+
+    if (chunk -> firstIndex + slot >= MEM_POOL_MAX_HANDLE_BLOCKS)
+    {
+        MemPoolFreeData(pool, data);
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    *handle = MemPoolMakeHandle(chunk, slot);
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Turns a handle back into a pointer to its block's data. This is a couple
+    of bit operations and one comparison (plus a probe of the chunk map for
+    a pool that has grown). If the block has been freed since the handle was
+    made, even if it has since been handed out again, the generations won't
+    match and we return NULL instead of someone else's data.
+*/
+void* MemPoolResolve(MemoryPoolManager *pool, MemoryPoolHandle handle)
+{
+    long int slot;
+    MemoryPoolChunk *chunk = MemPoolFindHandleChunk(pool, handle, &slot);
+
+    if (chunk == NULL || !MemPoolHandleIsLive(chunk, slot, handle))
+    {
+        return NULL;
+    }
+
+    return MemPoolSlotData(pool, chunk -> start, slot);
+}
+
+/*
+    Frees the block a handle refers to. A stale handle means the block was
+    already freed through another copy of the handle, so it is reported as a
+    double free, whilst a handle that never referred to one of the pool's
+    blocks is an invalid free.
+*/
+MemoryPoolStatus MemPoolFreeHandle(MemoryPoolManager *pool, MemoryPoolHandle handle)
+{
+    if (pool == NULL)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    long int slot;
+    MemoryPoolChunk *chunk = MemPoolFindHandleChunk(pool, handle, &slot);
+
+    if (chunk == NULL)
+    {
+        return MEMORY_POOL_INVALID_FREE_ERROR;
+    }
+
+    if (!MemPoolHandleIsLive(chunk, slot, handle))
+    {
+        return MEMORY_POOL_DOUBLE_FREE_ERROR;
+    }
+
+    return MemPoolFreeData(pool, MemPoolSlotData(pool, chunk -> start, slot));
+}
+
+/*
+    Copies the pool's statistics into "stats". The pool's shape (block size,
+    block count and bookkeeping size) is always filled in, the counters only
+    when the stats layer is compiled in. On a pool shared between threads,
+    the counters keep moving whilst we read them, so the snapshot is close
+    to, but not exactly, a single moment in time.
+*/
+MemoryPoolStatus MemPoolGetStats(MemoryPoolManager *pool, MemoryPoolStats *stats)
+{
+    if (pool == NULL || stats == NULL)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    memset(stats, 0, sizeof(MemoryPoolStats));
+    stats -> memoryBlockSize = pool -> memoryBlockSize;
+    stats -> memoryBlockCount = pool -> memoryBlockCount;
+    stats -> metadataSize = MemPoolMetadataSize(pool);
+
+#ifdef MEM_POOL_ENABLE_STATS
+    MemoryPoolStatsCounters *counters = &pool -> stats;
+
+    stats -> enabled = true;
+    stats -> currentAllocations = atomic_load(&counters -> currentAllocations);
+    stats -> peakAllocations = atomic_load(&counters -> peakAllocations);
+    stats -> totalAllocations = atomic_load(&counters -> totalAllocations);
+    stats -> failedAllocations = atomic_load(&counters -> failedAllocations);
+    stats -> highWaterMarkBytes = stats -> peakAllocations * pool -> memoryBlockSize;
+    stats -> allocCalls = atomic_load(&counters -> allocCalls);
+    stats -> freeCalls = atomic_load(&counters -> freeCalls);
+    stats -> failedFrees = atomic_load(&counters -> failedFrees);
+
+    for (int i = 0; i < MEM_POOL_LATENCY_BUCKETS; i++)
+    {
+        stats -> allocLatency[i] = atomic_load(&counters -> allocLatency[i]);
+        stats -> freeLatency[i] = atomic_load(&counters -> freeLatency[i]);
+    }
+#endif
+
+    return MEMORY_POOL_OK;
+}
+
+//  Writes a latency histogram as a JSON array.
+static void MemPoolDumpHistogram(FILE *out, const long int *histogram)
+{
+    fprintf(out, "[");
+
+    for (int i = 0; i < MEM_POOL_LATENCY_BUCKETS; i++)
+    {
+        fprintf(out, "%s%ld", i == 0 ? "" : ", ", histogram[i]);
+    }
+
+    fprintf(out, "]");
+}
+
+/*
+    Writes the pool's statistics to "out" as a single JSON object, so they
+    can be collected and graphed by other tools rather than read by eye.
+    As well as the MemPoolGetStats snapshot, the dump lists each chunk with
+    the number of blocks it holds, which stands in for the block by block
+    output of PrintMemBlocks on pools far too big to print.
+*/
+void MemPoolDumpStats(MemoryPoolManager *pool, FILE *out)
+{
+    MemoryPoolStats stats;
+
+    if (out == NULL || MemPoolGetStats(pool, &stats) != MEMORY_POOL_OK)
+    {
+        return;
+    }
+
+    fprintf(out, "{\"enabled\": %s, ", stats.enabled ? "true" : "false");
+    fprintf(out, "\"blockSize\": %zu, \"blockCount\": %ld, \"metadataBytes\": %zu, ",
+            stats.memoryBlockSize, stats.memoryBlockCount, stats.metadataSize);
+    fprintf(out, "\"allocated\": %ld, ", MemPoolCountAllocated(pool));
+    fprintf(out, "\"currentAllocations\": %ld, \"peakAllocations\": %ld, ",
+            stats.currentAllocations, stats.peakAllocations);
+    fprintf(out, "\"totalAllocations\": %ld, \"failedAllocations\": %ld, ",
+            stats.totalAllocations, stats.failedAllocations);
+    fprintf(out, "\"highWaterMarkBytes\": %zu, ", stats.highWaterMarkBytes);
+    fprintf(out, "\"allocCalls\": %ld, \"freeCalls\": %ld, \"failedFrees\": %ld, ",
+            stats.allocCalls, stats.freeCalls, stats.failedFrees);
+    fprintf(out, "\"sampleRate\": %d, \"allocLatencyLog2Ns\": ", MEM_POOL_STATS_SAMPLE_RATE);
+    MemPoolDumpHistogram(out, stats.allocLatency);
+    fprintf(out, ", \"freeLatencyLog2Ns\": ");
+    MemPoolDumpHistogram(out, stats.freeLatency);
+    fprintf(out, ", \"chunks\": [");
+
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL; chunk = chunk -> nextChunk)
+    {
+        fprintf(out, "%s{\"firstIndex\": %ld, \"blocks\": %ld}", 
+                chunk == pool -> chunks ? "" : ", ", chunk -> firstIndex, chunk -> blockCount);
+    }
+
+    fprintf(out, "]}\n");
+}
+
+/*
+    Prints every block in the pool. Bitmap pools have no MemoryPoolBlocks to
+    hand to PrintBlock, so their blocks are printed straight from the bitmap
+    in the same format.
+*/
+void PrintMemBlocks(MemoryPoolManager *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    for (MemoryPoolChunk *chunk = pool -> chunks; chunk != NULL; chunk = chunk -> nextChunk)
+    {
+        for (long int i = 0; i < chunk -> blockCount; i++)
+        {
+            if (pool -> layout == MEMORY_POOL_LAYOUT_BITMAP)
+            {
+                bool isAlloc = (chunk -> occupancy[i / 64] >> (i % 64)) & 1;
+                printf("[%zu | %d] => ", pool -> memoryBlockSize, isAlloc);
+            }
+            else
+            {
+                PrintBlock(&chunk -> blocks[i]);
+            }
+        }
     }
 
     printf("\n");
@@ -258,6 +3848,5 @@ void PrintMemBlocks(MemoryPoolManager *pool)
 */
 void PrintBlock(MemoryPoolBlock *block)
 {
-    printf("[%td | %d] => ", block -> next && block -> next -> data ? 
-    &(block -> next -> data) - &(block -> data) : block -> size, block -> isAlloc); 
+    printf("[%zu | %d] => ", block -> size, block -> isAlloc);
 }
\ No newline at end of file
@@ -8,32 +8,557 @@
 */
 
 #include <memory.h>
+#include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 //  Prevents multiple header files from being imported.
 #ifndef MEM_POOL_MANAGER_H
 #define MEM_POOL_MANAGER_H
 
+/*
+    A MemoryPoolBlock describes one fixed-size chunk of the pool's memory.
+
+    The "next" member is an intrusive free list link. It is only meaningful
+    whilst the block is NOT allocated, at which point it points to the next
+    free block in the pool (or NULL if this is the last free block). Once a
+    block has been handed out, "next" is set to NULL and should be ignored.
+
+    "isDirty" is only used by pools with the MEMORY_POOL_ZERO_LAZY policy. It
+    is false until the block is first handed out, which tells us the block
+    still holds the zeros it was created with.
+*/
 typedef struct MemoryPoolBlock 
 {
     void *data;
     bool isAlloc;
+    bool isDirty;
     size_t size;
     struct MemoryPoolBlock *next;
 } MemoryPoolBlock;
 
 /*
-    Essentially, our memory pool manager will be a Linked List which tracks
-    nodes of MemoryPoolBlocks. The linked list suits the functionality of
-    a memory pool manager well, and allows us to easilly distribute memory
-    amongst new nodes in a simple manner.
+    A chunk is one contiguous run of blocks: an array of MemoryPoolBlocks
+    and the single allocation holding all of their data. A fixed pool has
+    exactly one chunk, whilst a growable pool adds another whenever it runs
+    out of blocks. "firstIndex" is the position of the chunk's first block
+    in the pool as a whole.
+
+    A bitmap pool's chunks have no "blocks" array. They have an "occupancy"
+    bitmap instead, with one bit per block, and "searchWord" remembers the
+    first word of the bitmap that might still have a free bit in it, so we
+    don't rescan the full words at the front of the bitmap every time.
+    With the MEMORY_POOL_ZERO_LAZY policy it also has a "dirty" bitmap, the
+    bitmap version of each MemoryPoolBlock's "isDirty" flag.
+
+    "mappedSize" is the number of bytes mapped for "start" when the pool is
+    backed by MEMORY_POOL_BACKING_MMAP, or 0 when it came from the heap.
+
+    "generations" holds a counter per block that moves on every time the
+    block is freed, so that stale handles can be spotted (see
+    MemoryPoolHandle).
+
+    "fromImage" is set when "start" is a private mapping of a pool image
+    file (see MemPoolLoad) rather than memory of our own.
+
+    "nextChunk" is written (release) once the chunk is completely set up and
+    read (acquire) by anyone walking the list, so a thread that finds a new
+    chunk through it never sees the chunk half built.
+*/
+typedef struct MemoryPoolChunk
+{
+    MemoryPoolBlock *blocks;
+    void *start;
+    long int blockCount;
+    long int firstIndex;
+    _Atomic(struct MemoryPoolChunk*) nextChunk;
+
+    uint64_t *occupancy;
+    uint64_t *dirty;
+    long int searchWord;
+
+    uint8_t *generations;
+
+    size_t mappedSize;
+    bool fromImage;
+} MemoryPoolChunk;
+
+/*
+    The chunk map, which finds the chunk an address (or a handle's block
+    index) belongs to without checking each chunk in turn (see
+    MemPoolMapChunk). Every chunk after the first is entered under each
+    "window" of its data addresses, MemoryPoolBlock addresses and block
+    indexes, a window being a power of two of them ("shifts" gives the power
+    for each kind). A key holds the window along with its kind in the top
+    two bits, and 0 marks an empty entry.
+
+    Only the thread growing the pool writes to the map, so "used" needs no
+    protection. When the map fills up, it is replaced by a bigger copy and
+    the old one is kept in "retired" until the pool is destroyed, as
+    another thread could still be looking something up in it.
+*/
+typedef struct MemoryPoolChunkMapEntry
+{
+    _Atomic uint64_t key;
+    _Atomic(MemoryPoolChunk*) chunk;
+} MemoryPoolChunkMapEntry;
+
+typedef struct MemoryPoolChunkMap
+{
+    MemoryPoolChunkMapEntry *entries;
+    size_t capacity;
+    size_t used;
+    int shifts[3];
+    struct MemoryPoolChunkMap *retired;
+} MemoryPoolChunkMap;
+
+/*
+    Essentially, our memory pool manager tracks an array of MemoryPoolBlocks
+    that all live in a single contiguous allocation. "head" points to the
+    first block in that array, and "start" to the memory holding their data.
+    (If the pool grows, "head" and "start" describe the first chunk, and
+    the rest are found through "chunks".)
+
+    On top of the array, the free blocks are threaded together into a singly
+    linked "free list" through each block's "next" member. Allocating is then
+    just popping the head of the free list, and freeing is pushing the block
+    back on. Neither operation has to walk the pool, so both take the same
+    amount of time whether the pool holds ten blocks or ten million.
+
+    Because the blocks are stored in an array, the position (index) of a
+    block can be worked out from its address alone with a little pointer
+    arithmetic: index = block - head.
+*/
+
+/*
+    How a pool copes with being used by more than one thread at a time.
+
+        -   MEMORY_POOL_SINGLE_THREADED: No synchronisation at all. The
+            fastest option, but only one thread may ever touch the pool.
+
+        -   MEMORY_POOL_LOCKED: Every alloc and free takes a single global
+            mutex. Simple and safe, but every thread fights over the same
+            lock on every call.
+
+        -   MEMORY_POOL_THREAD_CACHED: Every thread keeps a small private
+            "magazine" of free blocks that it allocates from and frees into
+            without taking any lock. Only when a magazine runs dry (or fills
+            up) does the thread visit the shared free list, the "depot", and
+            it then moves a whole batch of "magazineSize" blocks in one go.
+            The lock is therefore taken roughly once per "magazineSize"
+            calls rather than on every call.
+
+        -   MEMORY_POOL_LOCK_FREE: The free list becomes a lock-free
+            "Treiber stack". Threads pop and push blocks with a single atomic
+            compare-and-swap on the head of the list, so no thread ever waits
+            on a mutex (or the kernel). Like the locked pool, every free
+            block is visible to every thread, but heavily contended pools
+            will see threads retrying their compare-and-swap.
+*/
+typedef enum
+{
+    MEMORY_POOL_SINGLE_THREADED,
+    MEMORY_POOL_LOCKED,
+    MEMORY_POOL_THREAD_CACHED,
+    MEMORY_POOL_LOCK_FREE
+} MemoryPoolThreading;
+
+/*
+    How the pool keeps track of which blocks are in use.
+
+        -   MEMORY_POOL_LAYOUT_BLOCK_LIST: Every block gets a MemoryPoolBlock
+            (its data pointer, "isAlloc" flag, size and free list link), and
+            free blocks are found by popping the free list. That is 32 bytes
+            of bookkeeping per block on a 64-bit machine.
+
+        -   MEMORY_POOL_LAYOUT_BITMAP: No MemoryPoolBlocks at all. Instead,
+            each block is a single bit in an "occupancy" bitmap (1 meaning
+            in use), so the bookkeeping shrinks to 1 bit per block and sits
+            together in a few cache lines. A free block is found by scanning
+            the bitmap 64 blocks (one 64-bit word) at a time and using a
+            "count trailing zeros" instruction to find the first free bit in
+            the first word that isn't full.
+
+    As a bitmap pool has no MemoryPoolBlocks to hand out, it is used through
+    MemPoolAllocData and MemPoolFreeData, which deal in data pointers. The
+    bitmap layout supports the single threaded and locked threading modes.
+*/
+typedef enum
+{
+    MEMORY_POOL_LAYOUT_BLOCK_LIST,
+    MEMORY_POOL_LAYOUT_BITMAP
+} MemoryPoolLayout;
+
+/*
+    What the pool does about the old contents of a freed block.
+
+        -   MEMORY_POOL_ZERO_EAGER: Every block is zeroed as it is freed, so
+            nothing a caller stored can leak to the block's next owner. This
+            is the default, and it makes MemPoolAllocZeroed free of charge,
+            but every free writes the whole block, however little of it was
+            actually used.
+
+        -   MEMORY_POOL_ZERO_LAZY: Freeing leaves the data alone. Blocks are
+            only zeroed when they are handed out by MemPoolAllocZeroed, and
+            only if they have been handed out before: blocks that have never
+            been used still hold the zeros they were created with.
+
+        -   MEMORY_POOL_ZERO_NONE: The pool never zeroes anything on its own
+            and doesn't keep track of which blocks are clean. New blocks
+            hold whatever malloc gave us, and MemPoolAllocZeroed always
+            clears the block it hands out.
+
+    Whatever the policy, MemPoolAllocZeroed always hands back zeroed memory,
+    just like calloc. Debug builds (see MEM_POOL_DEBUG) ignore the policy:
+    they always poison blocks as they are freed and zero them as they are
+    handed out.
+*/
+typedef enum
+{
+    MEMORY_POOL_ZERO_EAGER,
+    MEMORY_POOL_ZERO_LAZY,
+    MEMORY_POOL_ZERO_NONE
+} MemoryPoolZeroing;
+
+/*
+    Where the memory holding the blocks' data comes from.
+
+        -   MEMORY_POOL_BACKING_HEAP: malloc/calloc, as always.
+
+        -   MEMORY_POOL_BACKING_MMAP: Pages mapped straight from the
+            operating system (mmap, or VirtualAlloc on Windows), bypassing
+            the heap. For pools of hundreds of MB this gives us control over
+            how the pages behave:
+
+                -   "hugePages" asks for transparent huge pages (madvise with
+                    MADV_HUGEPAGE). One 2MB page does the work of 512 normal
+                    4KB pages, so touching the pool all over causes far fewer
+                    TLB misses. The chunk is aligned to MEM_POOL_HUGE_PAGE_SIZE
+                    so the whole of it can be covered.
+
+                -   "prefault" touches every page up front (MAP_POPULATE on
+                    Linux), so the page faults are paid for when the pool is
+                    created rather than the first time each block is used on
+                    the hot path.
+
+                -   MemPoolTrim can hand the pages behind free blocks back to
+                    the operating system when the pool has shrunk.
+
+            Huge pages and MAP_POPULATE are Linux features. Elsewhere they are
+            quietly skipped (prefaulting falls back to touching each page).
+*/
+typedef enum
+{
+    MEMORY_POOL_BACKING_HEAP,
+    MEMORY_POOL_BACKING_MMAP
+} MemoryPoolBacking;
+
+#define MEM_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/*
+    Block alignment. By default, blocks are packed back to back, exactly
+    "memoryBlockSize" bytes apart, so a block is only as aligned as its size
+    happens to make it. Setting "alignment" (a power of two, up to
+    MEM_POOL_MAX_ALIGNMENT) starts every block's data on a multiple of that
+    many bytes, padding the gap between blocks where needed:
+
+        -   16 suits SIMD loads and anything malloc would have handed out.
+
+        -   64 (MEM_POOL_CACHE_LINE_SIZE) gives every block its own cache
+            lines. When two threads write to neighbouring blocks that share
+            a cache line, the line bounces between their cores on every
+            write even though they never touch the same bytes, which is
+            called "false sharing". Cache-line aligned blocks can't share.
+
+        -   4096 gives every block its own page(s).
+
+    "cacheLinePadding" rounds the distance between blocks up to a whole
+    number of cache lines without needing the full 64 byte alignment, which
+    is all it takes to stop neighbouring blocks sharing a line.
+*/
+#define MEM_POOL_CACHE_LINE_SIZE 64
+#define MEM_POOL_MAX_ALIGNMENT 4096
+
+//  How many blocks a thread moves between its magazine and the depot at once
+//  if the caller doesn't pick a size.
+#define MEM_POOL_DEFAULT_MAGAZINE_SIZE 32
+
+/*
+    Everything needed to create a pool. Fill one in with MemPoolDefaultConfig,
+    change whatever options you need, then hand it to MemPoolInitWithConfig.
+    Starting from the defaults means new options can be added later without
+    breaking existing callers.
+*/
+typedef struct MemoryPoolConfig
+{
+    size_t memoryBlockSize;
+    long int memoryBlockCount;
+    MemoryPoolThreading threading;
+    int magazineSize;
+
+    /*
+        Growth. A growable pool that runs out of blocks adds another chunk
+        of blocks instead of failing. Each new chunk holds "growthFactor"
+        times as many blocks as the previous one (1.0 adds chunks of the
+        same size again, 2.0 doubles the pool every time). The factor can't
+        be less than 1.0, so chunks never shrink. "maxBlockCount" is a hard
+        cap on the total number of blocks, where 0 means no cap. Lock-free
+        pools can't grow.
+    */
+    bool growable;
+    double growthFactor;
+    long int maxBlockCount;
+
+    MemoryPoolLayout layout;
+    MemoryPoolZeroing zeroing;
+
+    MemoryPoolBacking backing;
+    bool hugePages;
+    bool prefault;
+
+    size_t alignment;
+    bool cacheLinePadding;
+} MemoryPoolConfig;
+
+/*
+    A thread's private stash of free blocks for a MEMORY_POOL_THREAD_CACHED
+    pool. It can hold up to twice "magazineSize" blocks, so that a thread
+    which alternates between allocating and freeing around the batch size
+    doesn't bounce back and forth to the depot on every call.
+
+    Every magazine is also linked into its pool's list of magazines so the
+    pool can clean them all up when it is destroyed.
+*/
+typedef struct MemoryPoolMagazine
+{
+    struct MemoryPoolManager *pool;
+    MemoryPoolBlock **blocks;
+    int count;
+    struct MemoryPoolMagazine *nextMagazine;
+} MemoryPoolMagazine;
+
+/*
+    Debug mode. Build with MEM_POOL_DEBUG defined and the pool hardens itself
+    against the classic memory bugs:
+
+        -   Every block gets MEM_POOL_GUARD_SIZE "canary" bytes on either side
+            of it, filled with MEM_POOL_GUARD_BYTE. When the block is freed
+            the canaries are checked, so writing even one byte past the end
+            (or before the start) of a block is caught and reported.
+
+        -   Freed blocks are filled with MEM_POOL_POISON_BYTE rather than
+            zeroed. Reading freed memory then gives obviously bogus values
+            instead of plausible zeros, and when the block is handed out
+            again we check the poison is untouched, which catches writes
+            through a pointer that was kept after being freed.
+
+        -   Double and invalid frees are printed as they happen, as well as
+            being reported through MemoryPoolStatus.
+
+    The patterns are the same ones the MSVC debug heap uses, so they will
+    look familiar in a debugger. Without MEM_POOL_DEBUG, the guards are zero
+    bytes wide and none of the checks are compiled in, so release builds
+    keep all of their speed.
 */
+#ifdef MEM_POOL_DEBUG
+#define MEM_POOL_GUARD_SIZE 16
+#else
+#define MEM_POOL_GUARD_SIZE 0
+#endif
+
+#define MEM_POOL_GUARD_BYTE 0xFD
+#define MEM_POOL_POISON_BYTE 0xDD
+
+/*
+    Optional statistics. Build with MEM_POOL_ENABLE_STATS defined (e.g.
+    "gcc -DMEM_POOL_ENABLE_STATS ...") and every pool keeps count of what it
+    is doing: how many blocks are in use now, the most that have ever been
+    in use at once, how many calls were made and how many of them failed.
+
+    Every MEM_POOL_STATS_SAMPLE_RATE-th alloc and free call is also timed,
+    and its latency is added to a histogram. Bucket "i" counts calls that
+    took between 2^i and 2^(i+1) - 1 nanoseconds (bucket 0 also takes calls
+    that took under a nanosecond). Timing only a sample keeps the cost of
+    reading the clock off most calls. A batch call (MemPoolAllocBatch or
+    MemPoolFreeBatch) counts and is timed as one call, but every block it
+    moves counts towards the allocation totals.
+
+    When MEM_POOL_ENABLE_STATS isn't defined, none of the counters exist and
+    none of the code that updates them is compiled, so the pool runs exactly
+    as fast as it would without the stats layer. MemPoolGetStats still works
+    but reports "enabled" as false and leaves the counters at zero.
+*/
+#define MEM_POOL_STATS_SAMPLE_RATE 64
+#define MEM_POOL_LATENCY_BUCKETS 32
+
+//  A snapshot of a pool's statistics, filled in by MemPoolGetStats.
+typedef struct MemoryPoolStats
+{
+    bool enabled;
+    size_t memoryBlockSize;
+    long int memoryBlockCount;
+    size_t metadataSize;
+
+    long int currentAllocations;
+    long int peakAllocations;
+    long int totalAllocations;
+    long int failedAllocations;
+    size_t highWaterMarkBytes;
+
+    long int allocCalls;
+    long int freeCalls;
+    long int failedFrees;
+
+    long int allocLatency[MEM_POOL_LATENCY_BUCKETS];
+    long int freeLatency[MEM_POOL_LATENCY_BUCKETS];
+} MemoryPoolStats;
+
+#ifdef MEM_POOL_ENABLE_STATS
+/*
+    The live counters behind MemoryPoolStats. They are atomic so that pools
+    shared between threads still count correctly, at the cost of every call
+    touching these shared counters.
+*/
+typedef struct MemoryPoolStatsCounters
+{
+    _Atomic long int currentAllocations;
+    _Atomic long int peakAllocations;
+    _Atomic long int totalAllocations;
+    _Atomic long int failedAllocations;
+    _Atomic long int allocCalls;
+    _Atomic long int freeCalls;
+    _Atomic long int failedFrees;
+    _Atomic long int allocLatency[MEM_POOL_LATENCY_BUCKETS];
+    _Atomic long int freeLatency[MEM_POOL_LATENCY_BUCKETS];
+} MemoryPoolStatsCounters;
+#endif
+
+/*
+    Memory pressure. Rather than finding out that a pool is exhausted when
+    an allocation fails, a producer can ask to be told when it is getting
+    close, and shed load (say, by sending its metrics early) in good time.
+
+    MemPoolSetWatermarks registers a callback along with a high and a low
+    watermark, both counted in blocks in use:
+
+        -   MEMORY_POOL_PRESSURE_HIGH is reported when an allocation takes
+            the number of blocks in use up to the high watermark.
+
+        -   MEMORY_POOL_PRESSURE_RELIEVED is reported when frees take it
+            back down to the low watermark.
+
+    The gap between the two stops a pool that hovers around one threshold
+    from firing the callback on every other call. Each alloc and free only
+    compares the count with the one threshold that can fire next.
+
+    The callback runs on a thread that crossed a threshold, outside of any
+    lock the pool holds, so it may allocate from and free to the pool
+    itself and never holds up other threads. Callbacks for one pool never
+    overlap: a threshold crossed whilst one is running (even by the
+    callback itself) is reported after it returns, so HIGH and RELIEVED
+    always alternate. A crossing there and back again during a single
+    callback isn't reported at all. MemPoolUnderPressure reports whether
+    the high watermark has been reached and not yet relieved, for
+    producers that would rather poll.
+
+    Counting blocks in use costs an atomic add per call on a shared pool,
+    so it only happens whilst a callback is registered. A thread cached
+    pool counts the blocks its callers hold, not those sitting in thread
+    caches.
+*/
+typedef enum
+{
+    MEMORY_POOL_PRESSURE_HIGH,
+    MEMORY_POOL_PRESSURE_RELIEVED
+} MemoryPoolPressure;
+
+typedef void (*MemoryPoolPressureCallback)(struct MemoryPoolManager *pool,
+                                           MemoryPoolPressure pressure, long int blocksInUse,
+                                           void *context);
+
 typedef struct MemoryPoolManager 
 {
     size_t poolSize;
     size_t memoryBlockSize;
     long int memoryBlockCount;
     MemoryPoolBlock *head;
+    MemoryPoolBlock *freeList;
+    void *start;
+
+    //  Every chunk of blocks the pool owns, oldest first, the map that finds
+    //  them by address once there is more than one, and how to grow.
+    MemoryPoolChunk *chunks;
+    MemoryPoolChunk *lastChunk;
+    _Atomic(MemoryPoolChunkMap*) chunkMap;
+    bool growable;
+    double growthFactor;
+    long int maxBlockCount;
+    MemoryPoolLayout layout;
+    MemoryPoolZeroing zeroing;
+    MemoryPoolBacking backing;
+    bool hugePages;
+    bool prefault;
+
+    //  How blocks are laid out in a chunk (see MemPoolStride).
+    size_t alignment;
+    size_t blockStride;
+    size_t dataOffset;
+
+    //  Thread safety. "depotLock" guards "freeList" (and "magazines") in the
+    //  locked and thread cached modes. "magazineKey" finds the calling
+    //  thread's magazine.
+    MemoryPoolThreading threading;
+    int magazineSize;
+    pthread_mutex_t depotLock;
+    pthread_key_t magazineKey;
+    MemoryPoolMagazine *magazines;
+
+    /*
+        The lock-free free list. Rather than linking blocks by pointer, it
+        links them by their index in "head" (plus one, so that zero can mean
+        "no block"). "lockFreeNext[i]" holds the link for block "i".
+
+        The top 32 bits of "lockFreeHead" hold a tag that is bumped on every
+        change to the list. Without it, a thread could read the head, be
+        paused whilst other threads pop that block, pop the next one and
+        push the first back again, then wake up and wrongly succeed in
+        swapping in a "next" block that is now in use: the "ABA" problem.
+        With the tag, the head no longer compares equal and the swap fails.
+    */
+    _Atomic uint64_t lockFreeHead;
+    _Atomic uint32_t *lockFreeNext;
+
+    /*
+        Memory pressure (see MemoryPoolPressure). "blocksInUse" is only
+        counted whilst "watchPressure" is set. "highTrigger" is the count at
+        which an alloc fires the callback next, and "lowTrigger" the count at
+        which a free does. Whichever can't fire is parked out of reach
+        (LONG_MAX or LONG_MIN), so each call needs just one compare.
+        "pressureLock" serialises changes to "underPressure" and the
+        triggers, along with the three fields after it. "pressureNotifying"
+        is set whilst a thread is delivering callbacks, "pressureReported"
+        is the state the callback was last told about, and
+        "pressureBlocksInUse" the count at the latest transition.
+    */
+    bool watchPressure;
+    _Atomic long int blocksInUse;
+    _Atomic long int highTrigger;
+    _Atomic long int lowTrigger;
+    _Atomic bool underPressure;
+    pthread_mutex_t pressureLock;
+    bool pressureNotifying;
+    bool pressureReported;
+    long int pressureBlocksInUse;
+    long int lowWatermark;
+    long int highWatermark;
+    MemoryPoolPressureCallback pressureCallback;
+    void *pressureContext;
+
+#ifdef MEM_POOL_ENABLE_STATS
+    MemoryPoolStatsCounters stats;
+#endif
 } MemoryPoolManager;
 
 /*
@@ -45,15 +570,91 @@ typedef struct MemoryPoolManager
     Instead, enums provide discrete values that are easier to understand, 
     less prone to mutation, typos and a much stricter enforcement of constant
     values.
+
+    Freeing can go wrong in a few different ways, and each one points to a
+    different bug in the caller, so each gets its own status:
+
+        -   MEMORY_POOL_DOUBLE_FREE_ERROR: The block belongs to the pool but
+            is already free.
+
+        -   MEMORY_POOL_INVALID_FREE_ERROR: The pointer isn't the start of
+            one of the pool's blocks at all.
+
+        -   MEMORY_POOL_CORRUPTION_ERROR: Only reported by debug builds (see
+            MEM_POOL_DEBUG). The block was freed, but something wrote past
+            either end of it on the way.
+
+    MEMORY_POOL_IO_ERROR is reported when a pool image can't be written or
+    read back (see MemPoolSave).
 */
 typedef enum 
 {
     MEMORY_POOL_INIT_ERROR,
     MEMORY_POOL_DESTROY_ERROR,
     MEMORY_POOL_ALLOC_ERROR,
+    MEMORY_POOL_DOUBLE_FREE_ERROR,
+    MEMORY_POOL_INVALID_FREE_ERROR,
+    MEMORY_POOL_CORRUPTION_ERROR,
+    MEMORY_POOL_IO_ERROR,
     MEMORY_POOL_OK
 } MemoryPoolStatus;
 
+/*
+    A handle is a safer, smaller alternative to holding on to a block
+    pointer. Keep a pointer to a block after freeing it and it silently
+    points at whatever the block's next owner stores there. A handle knows
+    which "generation" of the block it was made for, and every free moves
+    the block on to a new generation, so MemPoolResolve spots a stale handle
+    and returns NULL rather than somebody else's data.
+
+    A handle packs the block's position in the pool (plus one, so that zero
+    can be MEM_POOL_NULL_HANDLE) into its low MEM_POOL_HANDLE_INDEX_BITS
+    bits and the generation into the 8 bits above them. At 32 bits, it is
+    half the size of a pointer on a 64-bit machine, so arrays and lists of
+    handles take half the memory (and half the cache) of the same arrays of
+    pointers. The price is that only the first MEM_POOL_MAX_HANDLE_BLOCKS
+    blocks of a pool can be reached through handles, and that a block freed
+    exactly 256 times (or a multiple of that) while a handle to it was
+    forgotten about brings the old handle back to life.
+*/
+typedef uint32_t MemoryPoolHandle;
+
+#define MEM_POOL_NULL_HANDLE ((MemoryPoolHandle) 0)
+#define MEM_POOL_HANDLE_INDEX_BITS 24
+#define MEM_POOL_HANDLE_INDEX_MASK ((1u << MEM_POOL_HANDLE_INDEX_BITS) - 1)
+#define MEM_POOL_MAX_HANDLE_BLOCKS ((long int) MEM_POOL_HANDLE_INDEX_MASK)
+
+/*
+    Pool images, for warm restarts. Rather than rebuilding its state one
+    allocation at a time, a restarting process can put a pool back exactly
+    as it was: MemPoolSave writes the pool's settings, which blocks are in
+    use, their generations and then all of the block data to a file, front
+    to back in one pass. MemPoolLoad creates a pool from that file.
+
+    The block data is placed MEM_POOL_IMAGE_ALIGNMENT bytes into the file,
+    so that MemPoolLoad can map it straight into memory (a private,
+    copy-on-write mapping) instead of reading it, and each page is only
+    read from disk the first time it is touched. A bitmap pool then loads
+    in about the same time whatever its size, whilst a block list pool
+    still has to rebuild a MemoryPoolBlock for every block. Changes made
+    after loading never reach the file. Where mapping isn't possible
+    (including on Windows) the data is read in instead.
+
+    The image holds no pointers at all: blocks are recorded by their index
+    in the pool and the data by its offset in the file, so the pool can be
+    loaded anywhere in memory. That goes for the caller's data too. A block
+    that refers to another block by pointer will point into the old process
+    after a reload, so keep MemoryPoolHandles in blocks instead: they are
+    indexes, and as the generations are saved, they still resolve after a
+    reload. The loaded pool has every block in a single chunk.
+
+    An image can only be loaded by a build of the pool for the same kind of
+    machine, with MEM_POOL_DEBUG set the same way. Like MemPoolTrim, no
+    other thread may be using the pool while it is saved, and blocks sitting
+    in thread caches are saved as free.
+*/
+#define MEM_POOL_IMAGE_ALIGNMENT 65536
+
 /*
     Function prototypes to define the behaviour of out memory pool manager and 
     how to handle the blocks of memory managed by it.
@@ -61,12 +662,58 @@ typedef enum
 MemoryPoolStatus MemPoolInit(MemoryPoolManager **pool, size_t memBlockSize, 
                              long int memBlockCount);
 
+void MemPoolDefaultConfig(MemoryPoolConfig *config, size_t memBlockSize,
+                          long int memBlockCount);
+
+MemoryPoolStatus MemPoolInitWithConfig(MemoryPoolManager **pool,
+                                       const MemoryPoolConfig *config);
+
 MemoryPoolStatus MemPoolDestroy(MemoryPoolManager *pool);
 
+MemoryPoolStatus MemPoolTrim(MemoryPoolManager *pool, size_t *releasedBytes);
+
 MemoryPoolStatus MemPoolAlloc(MemoryPoolManager *pool, MemoryPoolBlock **block);
 
 MemoryPoolStatus MemPoolFree(MemoryPoolManager *pool, MemoryPoolBlock *block);
 
+MemoryPoolBlock* MemPoolFindBlock(MemoryPoolManager *pool, void *data);
+
+MemoryPoolStatus MemPoolAllocData(MemoryPoolManager *pool, void **data);
+
+MemoryPoolStatus MemPoolAllocZeroed(MemoryPoolManager *pool, void **data);
+
+MemoryPoolStatus MemPoolFreeData(MemoryPoolManager *pool, void *data);
+
+MemoryPoolStatus MemPoolAllocBatch(MemoryPoolManager *pool, long int count, void **data);
+
+MemoryPoolStatus MemPoolFreeBatch(MemoryPoolManager *pool, long int count, void **data);
+
+MemoryPoolStatus MemPoolAllocHandle(MemoryPoolManager *pool, MemoryPoolHandle *handle);
+
+void* MemPoolResolve(MemoryPoolManager *pool, MemoryPoolHandle handle);
+
+MemoryPoolStatus MemPoolFreeHandle(MemoryPoolManager *pool, MemoryPoolHandle handle);
+
+bool MemPoolContains(MemoryPoolManager *pool, void *data);
+
+long int MemPoolCountAllocated(MemoryPoolManager *pool);
+
+size_t MemPoolMetadataSize(MemoryPoolManager *pool);
+
+MemoryPoolStatus MemPoolSave(MemoryPoolManager *pool, const char *path);
+
+MemoryPoolStatus MemPoolLoad(MemoryPoolManager **pool, const char *path);
+
+MemoryPoolStatus MemPoolSetWatermarks(MemoryPoolManager *pool, long int lowWatermark,
+                                      long int highWatermark,
+                                      MemoryPoolPressureCallback callback, void *context);
+
+bool MemPoolUnderPressure(MemoryPoolManager *pool);
+
+MemoryPoolStatus MemPoolGetStats(MemoryPoolManager *pool, MemoryPoolStats *stats);
+
+void MemPoolDumpStats(MemoryPoolManager *pool, FILE *out);
+
 void PrintMemBlocks(MemoryPoolManager *pool);
 
 void PrintBlock(MemoryPoolBlock *block);
@@ -0,0 +1,526 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include "Slab_Allocator.h"
+
+/*
+    Pool benefits for programs that were never written with a pool in mind.
+
+    This file builds into a shared library that replaces malloc, free,
+    calloc and realloc. Small requests (up to SHIM_MAX_SIZE bytes) are
+    served from a slab of MemoryPoolManager size classes (see
+    Slab_Allocator.h), and everything else is forwarded to the system's own
+    allocator. Nothing in the program needs to change or even be rebuilt.
+    On Linux, the dynamic linker loads any library named in LD_PRELOAD
+    before the C library, so its malloc is the one every call finds:
+
+        gcc -std=c11 -O2 -shared -fPIC -o libpoolshim.so Pool_Malloc_Shim.c \
+            Slab_Allocator.c Memory_Pool_Manager.c -ldl -pthread
+
+        LD_PRELOAD=./libpoolshim.so ./Demo_Slab_Allocator
+
+    When the program exits, a report of how many allocations the pools
+    absorbed is written to stderr (set POOL_SHIM_QUIET to turn it off). Set
+    POOL_SHIM_BLOCKS to change how many blocks each class holds (defaults to
+    SHIM_DEFAULT_BLOCKS). Each class reserves room for all of its blocks up
+    front, in one range of pages mapped straight from the kernel, but a page
+    only takes up memory once a block on it is first used. Once a class is
+    full its requests simply go to the system allocator instead.
+
+    Replacing malloc has a few traps, as the pool needs memory too:
+
+        -   Recursion. Setting up the slab, and growing its pools, calls
+            malloc. A per-thread flag ("insideShim") marks that we are
+            already inside the shim, and any allocation made while it is set
+            goes straight to the system allocator.
+
+        -   Finding the real malloc. dlsym(RTLD_NEXT, ...) looks up the next
+            definition of a symbol after ours, the C library's. But dlsym
+            can itself call calloc before we have a real one to give it, so
+            the first few bytes come from a small static bootstrap buffer
+            that is never freed.
+
+        -   Telling pointers apart. free only gets a pointer, and most of
+            the pointers it sees in a big program aren't ours. As every
+            class is one fixed range, a pointer outside the span of all of
+            them ("shimLow" to "shimHigh") goes straight to the real free
+            after a single range check. Anything inside it costs at most one
+            more range check per class to find its pool.
+
+        -   fork. Only the thread that calls fork carries on in the child,
+            so if another thread was part way through malloc, holding a
+            class's lock, nobody is left to release it. The child would
+            then hang on its first small allocation. Like the C library's
+            own malloc, we take every class's lock just before the fork and
+            release them again on both sides of it.
+
+    Pointers from the pools are only 16 byte aligned, which is all malloc
+    promises. memalign, posix_memalign and aligned_alloc are handed
+    straight to the system allocator, so their pointers never fall in the
+    pools' span, and malloc_usable_size reports the size of a pool block
+    for pointers that do.
+*/
+
+#define SHIM_MAX_SIZE 256
+#define SHIM_DEFAULT_BLOCKS 262144
+#define SHIM_ALIGNMENT 16
+#define SHIM_BOOTSTRAP_SIZE 65536
+
+typedef void* (*MallocFunction)(size_t size);
+typedef void (*FreeFunction)(void *data);
+typedef void* (*CallocFunction)(size_t count, size_t size);
+typedef void* (*ReallocFunction)(void *data, size_t size);
+typedef void* (*AlignedFunction)(size_t alignment, size_t size);
+typedef int (*PosixMemalignFunction)(void **data, size_t alignment, size_t size);
+typedef size_t (*UsableSizeFunction)(void *data);
+
+static MallocFunction realMalloc;
+static FreeFunction realFree;
+static CallocFunction realCalloc;
+static ReallocFunction realRealloc;
+static AlignedFunction realMemalign;
+static AlignedFunction realAlignedAlloc;
+static PosixMemalignFunction realPosixMemalign;
+static UsableSizeFunction realMallocUsableSize;
+
+static SlabAllocator *shimSlab;
+static pthread_once_t shimOnce = PTHREAD_ONCE_INIT;
+static uintptr_t shimLow;
+static uintptr_t shimHigh;
+
+/*
+    Thread local variables in a shared library are normally found through a
+    function call that can allocate memory, which would send us straight
+    back into malloc. The "initial-exec" model puts them at a fixed offset
+    instead, which works for libraries loaded at startup with LD_PRELOAD.
+*/
+static _Thread_local bool insideShim __attribute__((tls_model("initial-exec")));
+
+static _Atomic long int forwardedAllocs;
+
+static alignas(SHIM_ALIGNMENT) unsigned char bootstrap[SHIM_BOOTSTRAP_SIZE];
+static _Atomic size_t bootstrapUsed;
+
+/*
+    Hands out memory from the bootstrap buffer. Every allocation is
+    prefixed with its size (so realloc can copy it), and none are ever
+    given back.
+*/
+static void* ShimBootstrapAlloc(size_t size)
+{
+    size_t rounded = (size + SHIM_ALIGNMENT - 1) & ~(size_t)(SHIM_ALIGNMENT - 1);
+    size_t needed = SHIM_ALIGNMENT + rounded;
+    size_t offset = atomic_fetch_add(&bootstrapUsed, needed);
+
+    if (offset + needed > SHIM_BOOTSTRAP_SIZE)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    *(size_t*) &bootstrap[offset] = size;
+    return &bootstrap[offset + SHIM_ALIGNMENT];
+}
+
+static bool ShimIsBootstrap(void *data)
+{
+    uintptr_t address = (uintptr_t) data;
+    uintptr_t first = (uintptr_t) bootstrap;
+
+    return address >= first && address < first + SHIM_BOOTSTRAP_SIZE;
+}
+
+/*
+    The fork handlers (see the "fork" trap above). Locking every class in
+    the same order each time means two forking threads can't deadlock on
+    each other. The child is left with only the forking thread, which is the
+    one holding the locks, so it can release them just as the parent does.
+*/
+static void ShimForkPrepare(void)
+{
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        if (shimSlab -> classes[i].pool != NULL)
+        {
+            pthread_mutex_lock(&shimSlab -> classes[i].pool -> depotLock);
+        }
+    }
+}
+
+static void ShimForkRelease(void)
+{
+    for (int i = SLAB_CLASS_COUNT - 1; i >= 0; i--)
+    {
+        if (shimSlab -> classes[i].pool != NULL)
+        {
+            pthread_mutex_unlock(&shimSlab -> classes[i].pool -> depotLock);
+        }
+    }
+}
+
+/*
+    Runs once, on the first call into the shim. Finds the system allocator,
+    then builds a slab with a fixed, locked pool for each class up to
+    SHIM_MAX_SIZE, and notes the span of addresses the pools cover. The
+    pools are bitmaps backed by mapped pages, so nothing is written to a
+    block (or its page) until it is handed out, and they don't zero their
+    blocks (malloc doesn't promise zeroed memory, and calloc clears what it
+    needs). If the slab can't be built, every request is simply forwarded.
+*/
+static void ShimInit(void)
+{
+    insideShim = true;
+
+    realMalloc = (MallocFunction) dlsym(RTLD_NEXT, "malloc");
+    realFree = (FreeFunction) dlsym(RTLD_NEXT, "free");
+    realCalloc = (CallocFunction) dlsym(RTLD_NEXT, "calloc");
+    realRealloc = (ReallocFunction) dlsym(RTLD_NEXT, "realloc");
+    realMemalign = (AlignedFunction) dlsym(RTLD_NEXT, "memalign");
+    realAlignedAlloc = (AlignedFunction) dlsym(RTLD_NEXT, "aligned_alloc");
+    realPosixMemalign = (PosixMemalignFunction) dlsym(RTLD_NEXT, "posix_memalign");
+    realMallocUsableSize = (UsableSizeFunction) dlsym(RTLD_NEXT, "malloc_usable_size");
+
+    const char *blocksSetting = getenv("POOL_SHIM_BLOCKS");
+    long int blocks = blocksSetting != NULL ? strtol(blocksSetting, NULL, 10) : 0;
+
+    if (blocks <= 0)
+    {
+        blocks = SHIM_DEFAULT_BLOCKS;
+    }
+
+    SlabConfig config;
+    SlabDefaultConfig(&config, 0);
+    config.poolConfig.threading = MEMORY_POOL_LOCKED;
+    config.poolConfig.zeroing = MEMORY_POOL_ZERO_NONE;
+    config.poolConfig.alignment = SHIM_ALIGNMENT;
+    config.poolConfig.layout = MEMORY_POOL_LAYOUT_BITMAP;
+    config.poolConfig.backing = MEMORY_POOL_BACKING_MMAP;
+
+    for (int i = 0; (SLAB_MIN_CLASS_SIZE << i) <= SHIM_MAX_SIZE; i++)
+    {
+        config.blockCounts[i] = blocks;
+    }
+
+    if (SlabInit(&shimSlab, &config) != MEMORY_POOL_OK)
+    {
+        shimSlab = NULL;
+    }
+
+    for (int i = 0; shimSlab != NULL && i < SLAB_CLASS_COUNT; i++)
+    {
+        MemoryPoolManager *pool = shimSlab -> classes[i].pool;
+
+        if (pool == NULL)
+        {
+            continue;
+        }
+
+        uintptr_t low = (uintptr_t) pool -> chunks -> start;
+        uintptr_t high = low + pool -> chunks -> mappedSize;
+
+        shimLow = shimLow == 0 || low < shimLow ? low : shimLow;
+        shimHigh = high > shimHigh ? high : shimHigh;
+    }
+
+    if (shimSlab != NULL)
+    {
+        pthread_atfork(ShimForkPrepare, ShimForkRelease, ShimForkRelease);
+    }
+
+    insideShim = false;
+}
+
+//  The allocation used by malloc, calloc and realloc.
+static void* ShimAlloc(size_t size)
+{
+    if (insideShim)
+    {
+        return realMalloc != NULL ? realMalloc(size) : ShimBootstrapAlloc(size);
+    }
+
+    pthread_once(&shimOnce, ShimInit);
+
+    if (size <= SHIM_MAX_SIZE && shimSlab != NULL)
+    {
+        void *data = NULL;
+
+        insideShim = true;
+        SlabAlloc(shimSlab, size == 0 ? 1 : size, &data);
+        insideShim = false;
+
+        if (data != NULL)
+        {
+            return data;
+        }
+    }
+
+    atomic_fetch_add_explicit(&forwardedAllocs, 1, memory_order_relaxed);
+    return realMalloc(size);
+}
+
+//  Whether "data" falls anywhere in the span of the slab's pools.
+static bool ShimMightOwn(void *data)
+{
+    uintptr_t address = (uintptr_t) data;
+
+    return address >= shimLow && address < shimHigh;
+}
+
+/*
+    The size of the block "data" lives in, if it came from the slab, or 0
+    if it didn't.
+*/
+static size_t ShimBlockSize(void *data)
+{
+    if (insideShim)
+    {
+        return 0;
+    }
+
+    pthread_once(&shimOnce, ShimInit);
+
+    if (!ShimMightOwn(data))
+    {
+        return 0;
+    }
+
+    insideShim = true;
+    SlabClass *sizeClass = SlabFindClass(shimSlab, data);
+    insideShim = false;
+
+    return sizeClass != NULL ? sizeClass -> blockSize : 0;
+}
+
+void* malloc(size_t size)
+{
+    return ShimAlloc(size);
+}
+
+void free(void *data)
+{
+    if (data == NULL || ShimIsBootstrap(data))
+    {
+        return;
+    }
+
+    if (!insideShim)
+    {
+        pthread_once(&shimOnce, ShimInit);
+    }
+
+    if (!insideShim && ShimMightOwn(data))
+    {
+        insideShim = true;
+        MemoryPoolStatus status = SlabFree(shimSlab, data);
+        insideShim = false;
+
+        //  Anything other than an invalid free means the slab owned it.
+        if (status != MEMORY_POOL_INVALID_FREE_ERROR)
+        {
+            return;
+        }
+    }
+
+    realFree(data);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    //  Nothing from the pools or the bootstrap buffer is zeroed, but the
+    //  system's calloc can skip clearing pages fresh from the kernel.
+    if (!insideShim && realCalloc != NULL && count * size > SHIM_MAX_SIZE)
+    {
+        atomic_fetch_add_explicit(&forwardedAllocs, 1, memory_order_relaxed);
+        return realCalloc(count, size);
+    }
+
+    void *data = ShimAlloc(count * size);
+
+    if (data != NULL)
+    {
+        memset(data, 0, count * size);
+    }
+
+    return data;
+}
+
+void* realloc(void *data, size_t size)
+{
+    if (data == NULL)
+    {
+        return ShimAlloc(size);
+    }
+
+    size_t oldSize = 0;
+
+    if (ShimIsBootstrap(data))
+    {
+        oldSize = *(size_t*)((unsigned char*) data - SHIM_ALIGNMENT);
+    }
+    else
+    {
+        oldSize = ShimBlockSize(data);
+
+        //  Not one of ours, so the system allocator can resize it in place.
+        if (oldSize == 0)
+        {
+            return realRealloc(data, size);
+        }
+
+        //  Still fits in the block it already has.
+        if (size != 0 && size <= oldSize)
+        {
+            return data;
+        }
+    }
+
+    if (size == 0)
+    {
+        free(data);
+        return NULL;
+    }
+
+    void *moved = ShimAlloc(size);
+
+    if (moved != NULL)
+    {
+        memcpy(moved, data, oldSize < size ? oldSize : size);
+        free(data);
+    }
+
+    return moved;
+}
+
+/*
+    The aligned allocators are left to the system allocator, which keeps
+    their pointers out of the pools' span, so free passes them straight on.
+*/
+void* memalign(size_t alignment, size_t size)
+{
+    pthread_once(&shimOnce, ShimInit);
+
+    if (realMemalign == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    atomic_fetch_add_explicit(&forwardedAllocs, 1, memory_order_relaxed);
+    return realMemalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    pthread_once(&shimOnce, ShimInit);
+
+    if (realAlignedAlloc == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    atomic_fetch_add_explicit(&forwardedAllocs, 1, memory_order_relaxed);
+    return realAlignedAlloc(alignment, size);
+}
+
+int posix_memalign(void **data, size_t alignment, size_t size)
+{
+    pthread_once(&shimOnce, ShimInit);
+
+    if (realPosixMemalign == NULL)
+    {
+        return ENOMEM;
+    }
+
+    atomic_fetch_add_explicit(&forwardedAllocs, 1, memory_order_relaxed);
+    return realPosixMemalign(data, alignment, size);
+}
+
+/*
+    The C library would look for a chunk header in front of "data" that
+    pool blocks and the bootstrap buffer don't have, so answer for those
+    ourselves. A pool block can hold its whole class size.
+*/
+size_t malloc_usable_size(void *data)
+{
+    if (data == NULL)
+    {
+        return 0;
+    }
+
+    if (ShimIsBootstrap(data))
+    {
+        return *(size_t*)((unsigned char*) data - SHIM_ALIGNMENT);
+    }
+
+    size_t blockSize = ShimBlockSize(data);
+
+    if (blockSize != 0)
+    {
+        return blockSize;
+    }
+
+    return realMallocUsableSize != NULL ? realMallocUsableSize(data) : 0;
+}
+
+/*
+    Runs when the program exits (or the library is unloaded), and reports
+    how much of the program's allocating the pools took on. The slab isn't
+    destroyed, as other exit handlers may still free memory that lives in it.
+*/
+__attribute__((destructor))
+static void ShimReport(void)
+{
+    if (shimSlab == NULL || getenv("POOL_SHIM_QUIET") != NULL)
+    {
+        return;
+    }
+
+    insideShim = true;
+
+    long int forwarded = atomic_load(&forwardedAllocs);
+    long int absorbed = 0;
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        absorbed += atomic_load(&shimSlab -> classes[i].totalAllocs);
+    }
+
+    long int total = absorbed + forwarded;
+
+    fprintf(stderr, "Pool Malloc Shim: %ld Of %ld Allocations (%.1f%%) Served By The Pools\n",
+            absorbed, total, total > 0 ? 100.0 * absorbed / total : 0.0);
+    fprintf(stderr, "%8s %12s %10s %10s %10s\n", "Class", "Allocs", "Failed", "Live", "Peak");
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        SlabClass *sizeClass = &shimSlab -> classes[i];
+
+        if (sizeClass -> pool != NULL)
+        {
+            fprintf(stderr, "%8zu %12ld %10ld %10ld %10ld\n", sizeClass -> blockSize,
+                    atomic_load(&sizeClass -> totalAllocs),
+                    atomic_load(&sizeClass -> failedAllocs),
+                    atomic_load(&sizeClass -> liveBlocks),
+                    atomic_load(&sizeClass -> peakBlocks));
+        }
+    }
+
+    fprintf(stderr, "%8s %12ld\n", "system", forwarded);
+
+    insideShim = false;
+}
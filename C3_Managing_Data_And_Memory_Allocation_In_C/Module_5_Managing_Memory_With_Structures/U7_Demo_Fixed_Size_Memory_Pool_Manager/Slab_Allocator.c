@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Slab_Allocator.h"
+
+/*
+    Starts every class off with the same number of blocks and the default
+    (single threaded) pool options.
+*/
+void SlabDefaultConfig(SlabConfig *config, long int blocksPerClass)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    MemPoolDefaultConfig(&config -> poolConfig, SLAB_MIN_CLASS_SIZE, blocksPerClass);
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        config -> blockCounts[i] = blocksPerClass;
+    }
+}
+
+/*
+    Creates one fixed-size pool per size class. Class "i" serves blocks of
+    SLAB_MIN_CLASS_SIZE << i bytes. If any pool can't be created, the ones
+    that were are cleaned up again so a failed init doesn't leak.
+*/
+MemoryPoolStatus SlabInit(SlabAllocator **slab, const SlabConfig *config)
+{
+    if (slab == NULL || config == NULL)
+    {
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    *slab = (SlabAllocator*) calloc(1, sizeof(SlabAllocator));
+
+    if (*slab == NULL)
+    {
+        printf("Unable To Allocate Memory For The Slab\n");
+        return MEMORY_POOL_INIT_ERROR;
+    }
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        SlabClass *sizeClass = &(*slab) -> classes[i];
+        sizeClass -> blockSize = (size_t) SLAB_MIN_CLASS_SIZE << i;
+
+        if (config -> blockCounts[i] <= 0)
+        {
+            continue;
+        }
+
+        MemoryPoolConfig classConfig = config -> poolConfig;
+        classConfig.memoryBlockSize = sizeClass -> blockSize;
+        classConfig.memoryBlockCount = config -> blockCounts[i];
+
+        if (MemPoolInitWithConfig(&sizeClass -> pool, &classConfig) != MEMORY_POOL_OK)
+        {
+            SlabDestroy(*slab);
+            *slab = NULL;
+            return MEMORY_POOL_INIT_ERROR;
+        }
+    }
+
+    return MEMORY_POOL_OK;
+}
+
+MemoryPoolStatus SlabDestroy(SlabAllocator *slab)
+{
+    if (slab == NULL)
+    {
+        return MEMORY_POOL_DESTROY_ERROR;
+    }
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        if (slab -> classes[i].pool != NULL)
+        {
+            MemPoolDestroy(slab -> classes[i].pool);
+        }
+    }
+
+    free(slab);
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Finds the smallest class that "size" fits into, skipping any classes
+    that weren't given a pool, then allocates a block from it. As the class
+    sizes are powers of two, we just keep doubling until the size fits.
+
+    Requests bigger than the largest class (or of zero bytes) can't be
+    served by the slab and are reported as allocation errors.
+*/
+MemoryPoolStatus SlabAlloc(SlabAllocator *slab, size_t size, void **data)
+{
+    if (slab == NULL || data == NULL || size == 0 || size > SLAB_MAX_CLASS_SIZE)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    int i = 0;
+
+    while (i < SLAB_CLASS_COUNT &&
+           (slab -> classes[i].blockSize < size || slab -> classes[i].pool == NULL))
+    {
+        i++;
+    }
+
+    if (i == SLAB_CLASS_COUNT)
+    {
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    SlabClass *sizeClass = &slab -> classes[i];
+
+    if (MemPoolAllocData(sizeClass -> pool, data) != MEMORY_POOL_OK)
+    {
+        atomic_fetch_add_explicit(&sizeClass -> failedAllocs, 1, memory_order_relaxed);
+        *data = NULL;
+        return MEMORY_POOL_ALLOC_ERROR;
+    }
+
+    atomic_fetch_add_explicit(&sizeClass -> totalAllocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&sizeClass -> requestedBytes, size, memory_order_relaxed);
+
+    //  Keep track of the most blocks this class has ever had out at once.
+    long int live = atomic_fetch_add_explicit(&sizeClass -> liveBlocks, 1,
+                                              memory_order_relaxed) + 1;
+    long int peak = atomic_load_explicit(&sizeClass -> peakBlocks, memory_order_relaxed);
+
+    while (live > peak &&
+           !atomic_compare_exchange_weak(&sizeClass -> peakBlocks, &peak, live))
+    {
+    }
+
+    return MEMORY_POOL_OK;
+}
+
+/*
+    Works out which class a pointer came from by asking each class pool if
+    the address is one of its blocks. That is one range check per class for
+    pools that haven't grown, and a probe of the chunk map for each class
+    that has (see MemPoolContains), so callers that free a lot of foreign
+    pointers should rule them out first (Pool_Malloc_Shim.c keeps the span
+    of all its classes for that).
+*/
+SlabClass* SlabFindClass(SlabAllocator *slab, void *data)
+{
+    if (slab == NULL || data == NULL)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        if (slab -> classes[i].pool != NULL &&
+            MemPoolContains(slab -> classes[i].pool, data))
+        {
+            return &slab -> classes[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+    Hands a pointer from SlabAlloc back to the pool of the class it came
+    from. Pointers the slab doesn't own (or that were already freed) are
+    rejected, just like MemPoolFree does.
+*/
+MemoryPoolStatus SlabFree(SlabAllocator *slab, void *data)
+{
+    SlabClass *sizeClass = SlabFindClass(slab, data);
+
+    if (sizeClass == NULL)
+    {
+        return MEMORY_POOL_INVALID_FREE_ERROR;
+    }
+
+    MemoryPoolStatus status = MemPoolFreeData(sizeClass -> pool, data);
+
+    if (status == MEMORY_POOL_OK || status == MEMORY_POOL_CORRUPTION_ERROR)
+    {
+        atomic_fetch_sub_explicit(&sizeClass -> liveBlocks, 1, memory_order_relaxed);
+    }
+
+    return status;
+}
+
+/*
+    Prints a line per size class showing how busy the class has been and
+    how much memory it wastes:
+
+        -   Live/Peak/Capacity: Blocks in use now, the most ever in use at
+            once and the number of blocks the class has room for.
+
+        -   Allocs/Failed: How many requests the class served, and how many
+            it had to turn away because its pool was empty.
+
+        -   Avg Req: The average number of bytes callers actually asked for.
+
+        -   Waste %: Internal fragmentation. The share of the bytes handed
+            out that callers never asked for (a 24 byte request served from
+            the 32 byte class wastes 8 bytes, or 25%).
+
+        -   Idle KB: Memory reserved for the class that isn't in use right
+            now. A consistently high number means the class was sized too
+            generously.
+*/
+void PrintSlabReport(SlabAllocator *slab)
+{
+    if (slab == NULL)
+    {
+        return;
+    }
+
+    printf("%6s %10s %10s %10s %12s %8s %9s %8s %10s\n", "Class", "Live", "Peak",
+           "Capacity", "Allocs", "Failed", "Avg Req", "Waste %", "Idle KB");
+
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++)
+    {
+        SlabClass *sizeClass = &slab -> classes[i];
+
+        if (sizeClass -> pool == NULL)
+        {
+            continue;
+        }
+
+        long int allocs = atomic_load(&sizeClass -> totalAllocs);
+        long int live = atomic_load(&sizeClass -> liveBlocks);
+        long int capacity = sizeClass -> pool -> memoryBlockCount;
+        size_t requested = atomic_load(&sizeClass -> requestedBytes);
+        double served = (double) allocs * (double) sizeClass -> blockSize;
+
+        double averageRequest = allocs > 0 ? (double) requested / allocs : 0;
+        double waste = served > 0 ? 100.0 * (1.0 - (double) requested / served) : 0;
+        double idleKb = (double)(capacity - live) * sizeClass -> blockSize / 1024.0;
+
+        printf("%6zu %10ld %10ld %10ld %12ld %8ld %9.1f %8.1f %10.1f\n",
+               sizeClass -> blockSize, live, (long int) atomic_load(&sizeClass -> peakBlocks),
+               capacity, allocs, (long int) atomic_load(&sizeClass -> failedAllocs),
+               averageRequest, waste, idleKb);
+    }
+}
@@ -0,0 +1,81 @@
+/*
+    A fixed-size memory pool is fantastic when every allocation is the same
+    size, but WiredBrain's metrics, people and list nodes are all different
+    (small) sizes. Giving each of them a hand-sized pool of their own gets
+    messy fast.
+
+    A "slab" allocator solves this by sitting in front of a set of fixed-size
+    pools, one per "size class". Here the classes are the powers of two from
+    16 bytes up to 4096 bytes. A request for "size" bytes is served by the
+    smallest class that it fits in, so a 24 byte metric comes out of the 32
+    byte pool and a 100 byte person out of the 128 byte pool.
+
+    The caller gets malloc-like ergonomics (ask for any size, get a pointer
+    back, hand the pointer back when done) at the speed of a memory pool.
+    The price is "internal fragmentation": the gap between what was asked
+    for and the size of the class that served it. The slab keeps enough
+    statistics to report this waste class by class.
+*/
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "Memory_Pool_Manager.h"
+
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#define SLAB_MIN_CLASS_SIZE 16
+#define SLAB_MAX_CLASS_SIZE 4096
+
+//  16, 32, 64, 128, 256, 512, 1024, 2048, 4096
+#define SLAB_CLASS_COUNT 9
+
+/*
+    One size class: the pool that serves it and the numbers we need for the
+    waste report. The counters are atomic so the report stays accurate when
+    the class pools are shared between threads.
+*/
+typedef struct SlabClass
+{
+    size_t blockSize;
+    MemoryPoolManager *pool;
+
+    _Atomic long int totalAllocs;
+    _Atomic long int failedAllocs;
+    _Atomic long int liveBlocks;
+    _Atomic long int peakBlocks;
+    _Atomic size_t requestedBytes;
+} SlabClass;
+
+/*
+    How to build the slab. "poolConfig" is the template used for every class
+    pool (its threading mode and so on), with the block size and count
+    filled in per class from "blockCounts". A class with a count of zero is
+    left out, and requests that would land in it move up to the next class.
+*/
+typedef struct SlabConfig
+{
+    MemoryPoolConfig poolConfig;
+    long int blockCounts[SLAB_CLASS_COUNT];
+} SlabConfig;
+
+typedef struct SlabAllocator
+{
+    SlabClass classes[SLAB_CLASS_COUNT];
+} SlabAllocator;
+
+void SlabDefaultConfig(SlabConfig *config, long int blocksPerClass);
+
+MemoryPoolStatus SlabInit(SlabAllocator **slab, const SlabConfig *config);
+
+MemoryPoolStatus SlabDestroy(SlabAllocator *slab);
+
+MemoryPoolStatus SlabAlloc(SlabAllocator *slab, size_t size, void **data);
+
+MemoryPoolStatus SlabFree(SlabAllocator *slab, void *data);
+
+SlabClass* SlabFindClass(SlabAllocator *slab, void *data);
+
+void PrintSlabReport(SlabAllocator *slab);
+
+#endif
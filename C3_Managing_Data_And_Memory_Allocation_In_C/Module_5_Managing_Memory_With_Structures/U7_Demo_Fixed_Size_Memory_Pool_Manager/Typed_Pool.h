@@ -0,0 +1,155 @@
+/*
+    MemoryPoolManager works in untyped blocks, so every call site has to
+    dig the data out of a MemoryPoolBlock and cast it by hand:
+
+        TestMetrics *blockOneData = block -> data;
+
+    and every object pays for a MemoryPoolBlock (32 bytes) of bookkeeping
+    somewhere else in memory, which has to be loaded on every alloc and
+    free.
+
+    DECLARE_POOL(T) generates a pool that only ever holds objects of type
+    T, with functions that take and return T pointers:
+
+        DECLARE_POOL(TestMetrics)
+
+        Pool_TestMetrics pool;
+        Pool_TestMetrics_init(&pool, 1000);
+
+        TestMetrics *metric = NULL;
+        Pool_TestMetrics_alloc(&pool, &metric);
+        Pool_TestMetrics_free(&pool, metric);
+
+        Pool_TestMetrics_destroy(&pool);
+
+    Each slot is a union of a T and a free list link. Whilst the slot is in
+    use it holds the object, and once it's freed the same bytes hold the
+    pointer to the next free slot, so there is no metadata per object at
+    all: a slot is exactly as big as T (or a pointer, if T is smaller).
+    Because the size of T is known at compile time and the functions are
+    "static inline" in this header, alloc and free boil down to a handful
+    of instructions that the compiler can put straight into the caller.
+
+    The savings come at a cost. A typed pool:
+
+        -   Can't grow and has no threading modes, so give each thread its
+            own pool (or guard it with a lock).
+        -   Doesn't zero anything. Freeing overwrites the start of the
+            object with the free list link, and objects come back holding
+            whatever they held before.
+        -   Can't spot double frees, as it has nowhere to record which slots
+            are in use. Pointers that aren't a slot of the pool are still
+            rejected with MEMORY_POOL_INVALID_FREE_ERROR.
+
+    T must be a single word, so declare a typedef first for types like
+    "unsigned int" or "struct Person".
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "Memory_Pool_Manager.h"
+
+#ifndef TYPED_POOL_H
+#define TYPED_POOL_H
+
+/*
+    The pool itself. Slots are handed out from the free list first, and
+    then in order from the slots that have never been used ("untouched"),
+    so creating a pool doesn't have to walk every slot to build the list.
+*/
+#define DECLARE_POOL(T)                                                                    \
+                                                                                           \
+typedef union Pool_##T##_Slot                                                              \
+{                                                                                          \
+    T object;                                                                              \
+    union Pool_##T##_Slot *next;                                                           \
+} Pool_##T##_Slot;                                                                         \
+                                                                                           \
+typedef struct Pool_##T                                                                    \
+{                                                                                          \
+    Pool_##T##_Slot *slots;                                                                \
+    Pool_##T##_Slot *freeList;                                                             \
+    long int untouched;                                                                    \
+    long int capacity;                                                                     \
+    long int liveCount;                                                                    \
+} Pool_##T;                                                                                \
+                                                                                           \
+static inline MemoryPoolStatus Pool_##T##_init(Pool_##T *pool, long int capacity)          \
+{                                                                                          \
+    if (pool == NULL || capacity <= 0)                                                     \
+    {                                                                                      \
+        return MEMORY_POOL_INIT_ERROR;                                                     \
+    }                                                                                      \
+                                                                                           \
+    pool -> slots = (Pool_##T##_Slot*) calloc((size_t) capacity, sizeof(Pool_##T##_Slot)); \
+                                                                                           \
+    if (pool -> slots == NULL)                                                             \
+    {                                                                                      \
+        printf("Unable To Allocate Memory For The " #T " Pool\n");                         \
+        return MEMORY_POOL_INIT_ERROR;                                                     \
+    }                                                                                      \
+                                                                                           \
+    pool -> freeList = NULL;                                                               \
+    pool -> untouched = 0;                                                                 \
+    pool -> capacity = capacity;                                                           \
+    pool -> liveCount = 0;                                                                 \
+    return MEMORY_POOL_OK;                                                                 \
+}                                                                                          \
+                                                                                           \
+static inline MemoryPoolStatus Pool_##T##_destroy(Pool_##T *pool)                          \
+{                                                                                          \
+    if (pool == NULL)                                                                      \
+    {                                                                                      \
+        return MEMORY_POOL_DESTROY_ERROR;                                                  \
+    }                                                                                      \
+                                                                                           \
+    free(pool -> slots);                                                                   \
+    pool -> slots = NULL;                                                                  \
+    pool -> freeList = NULL;                                                               \
+    pool -> untouched = 0;                                                                 \
+    pool -> capacity = 0;                                                                  \
+    pool -> liveCount = 0;                                                                 \
+    return MEMORY_POOL_OK;                                                                 \
+}                                                                                          \
+                                                                                           \
+static inline MemoryPoolStatus Pool_##T##_alloc(Pool_##T *pool, T **object)                \
+{                                                                                          \
+    Pool_##T##_Slot *slot = pool -> freeList;                                              \
+                                                                                           \
+    if (slot != NULL)                                                                      \
+    {                                                                                      \
+        pool -> freeList = slot -> next;                                                   \
+    }                                                                                      \
+    else if (pool -> untouched < pool -> capacity)                                         \
+    {                                                                                      \
+        slot = &pool -> slots[pool -> untouched++];                                        \
+    }                                                                                      \
+    else                                                                                   \
+    {                                                                                      \
+        *object = NULL;                                                                    \
+        return MEMORY_POOL_ALLOC_ERROR;                                                    \
+    }                                                                                      \
+                                                                                           \
+    pool -> liveCount++;                                                                   \
+    *object = &slot -> object;                                                             \
+    return MEMORY_POOL_OK;                                                                 \
+}                                                                                          \
+                                                                                           \
+static inline MemoryPoolStatus Pool_##T##_free(Pool_##T *pool, T *object)                  \
+{                                                                                          \
+    uintptr_t offset = (uintptr_t) object - (uintptr_t) pool -> slots;                     \
+                                                                                           \
+    if (offset >= (uintptr_t) pool -> untouched * sizeof(Pool_##T##_Slot) ||               \
+        offset % sizeof(Pool_##T##_Slot) != 0)                                             \
+    {                                                                                      \
+        return MEMORY_POOL_INVALID_FREE_ERROR;                                             \
+    }                                                                                      \
+                                                                                           \
+    Pool_##T##_Slot *slot = (Pool_##T##_Slot*) object;                                     \
+    slot -> next = pool -> freeList;                                                       \
+    pool -> freeList = slot;                                                               \
+    pool -> liveCount--;                                                                   \
+    return MEMORY_POOL_OK;                                                                 \
+}
+
+#endif